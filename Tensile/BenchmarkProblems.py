@@ -131,6 +131,21 @@ def benchmarkProblemType( problemTypeConfig, problemSizeGroupConfig, \
     pushWorkingPath("sourceTmp")
     filesToCopy = [
         "SolutionMapper.h",
+        "SolutionMapperDistance.h",
+        "LookupCache.h",
+        "ShapeCanonicalizer.h",
+        "DeviceContext.cpp",
+        "DeviceContext.h",
+        "LookupStats.cpp",
+        "LookupStats.h",
+        "ModuleRegistry.cpp",
+        "ModuleRegistry.h",
+        "Preloader.cpp",
+        "Preloader.h",
+        "ProgramCache.cpp",
+        "ProgramCache.h",
+        "LoadTrace.cpp",
+        "LoadTrace.h",
         "Client.cpp",
         "Client.h",
         "CMakeLists.txt",
@@ -44,6 +44,15 @@ def main( config ):
   pushWorkingPath("source")
   filesToCopy = [
       "SolutionMapper.h",
+      "SolutionMapperDistance.h",
+      "LookupCache.h",
+      "ShapeCanonicalizer.h",
+      "DeviceContext.h",
+      "LookupStats.h",
+      "ModuleRegistry.h",
+      "Preloader.h",
+      "ProgramCache.h",
+      "LoadTrace.h",
       "Client.cpp",
       "Client.h",
       "DeviceStats.h",
@@ -664,13 +673,17 @@ def writeClientParameters(forBenchmark, solutions, problemSizes, stepName, \
     for i in range(0, len(solutions)):
       solution = solutions[i]
       solutionName = solutionWriter.getSolutionName(solution)
-      h += "  {(void*)%s, \"%s\", {%d, %d, %d, %d, %s} }" % \
+      h += "  {(void*)%s, \"%s\", {%d, %d, %d, %d, %s}, %u, %u, %s, %s }" % \
         (solutionName, solutionName,
           solution["AssertSummationElementMultiple"],
           solution["AssertFree0ElementMultiple"],
           solution["AssertFree1ElementMultiple"],
           solution["AssertMinApproxSize"],
-          "true" if solution["LdcEqualsLdd"] else "false" )
+          "true" if solution["LdcEqualsLdd"] else "false",
+          solution["MacroTile0"],
+          solution["MacroTile1"],
+          solutionWriter.getKernelInfoInitializer(solution),
+          solutionWriter.getPlanInfoInitializer(solution) )
       if i < len(solutions)-1:
         h += ","
       h += "\n"
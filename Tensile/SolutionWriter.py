@@ -65,159 +65,181 @@ class SolutionWriter:
 
 
   ##############################################################################
-  # getSourceString
+  # SolutionInfo initializer for the kernel loaded by the solution:
+  # kernel name and embedded code object, or nullptrs if there is no code object
   ##############################################################################
-  def getProblemSourceString(self, problemType, solution, kernelsWithBuildErrs):
-    gsu = solution["GlobalSplitU"]
-    persistent = solution["PersistentKernel"]
-    kernelLanguage = solution["KernelLanguage"]
-    tt0 = solution["ThreadTile0"]
-    tt1 = solution["ThreadTile1"]
-    sg0 = solution["SubGroup0"]
-    sg1 = solution["SubGroup1"]
-    nt  = solution["NumThreads"]
-    es  = solution["LdcEqualsLdd"]
+  def getKernelInfoInitializer(self, solution):
+    if self.language != "HIP" or solution["KernelLanguage"] != "Assembly":
+      return "nullptr, nullptr"
+    kernelName = self.kernelWriter.getKernelName(solution.getKernels()[0])
+    return "\"%s\", %s" % (kernelName, \
+        "nullptr" if globalParameters["CodeFromFiles"] else kernelName+"_coba")
 
-    kernels = solution.getKernels()
-    kernelNames = []
-    kernelBuildErr = 0
-    for kernel in kernels:
-      kernelName = self.kernelWriter.getKernelName(kernel)
-      if kernelName in kernelsWithBuildErrs:
-        kernelBuildErr = 1
-      kernelNames.append( kernelName )
 
+  ##############################################################################
+  # Launch plans: solutions with a single assembly kernel are also split in a
+  # plan function, which computes the SolutionLaunch of a problem once, and an
+  # execute function which enqueues it with new data pointers and alpha/beta
+  ##############################################################################
+  def hasLaunchPlan(self, solution):
+    return self.language == "HIP" and solution["KernelLanguage"] == "Assembly" \
+        and solution["GlobalSplitU"] == 1 and not globalParameters["DebugKernel"]
 
-    s = ""
-    t = ""
-    # includes
-
-    problemType = solution["ProblemType"] # shortcut
-
-    if not globalParameters["MergeFiles"]:
-      solutionName = self.getSolutionName(solution)
-      s += "#include \"%s.h\"\n" % solutionName
-      s += "\n"
-
-    # problem function signature
-    #argList = self.getArgList(problemType, True, True, True, True)
-    #for i in range(0, len(argList)):
-    #  argString = "%s %s" % argList[i]
-    #  s += "%s%s%s" % (t, argString, ",\n" if i < len(argList)-1 else ")" )
-
-    s += self.getSolutionSignature(solution)
+  def getPlanInfoInitializer(self, solution):
+    if not self.hasLaunchPlan(solution):
+      return "nullptr, nullptr"
+    solutionName = self.getSolutionName(solution)
+    return "(void*)%s_plan, (void*)%s_execute" % (solutionName, solutionName)
 
-    s += " {\n"
-    if kernelBuildErr:
-      s += "%s  return tensileStatusFailure; // One or more kernels had build failures (%s)\n" % (t, kernelNames)
-      s += "%s}\n" % (t)
-      return s
+  def getKernelArgsStructName(self, solution):
+    return "%s_KernelArgs" % self.getSolutionName(solution)
 
+  ########################################
+  # kernel argument struct of an assembly solution
+  def getKernelArgsStructString(self, solution):
+    problemType = solution["ProblemType"]
+    t = ""
+    s = ""
+    s += "/* module function args */\n"
+    s += "%sstruct %s {\n" % (t, self.getKernelArgsStructName(solution))
     t += "  "
-    s += "%sTensileStatus status;\n" % (t)
-
-
-    # hipFunction Struct
-    if kernelLanguage == "Assembly":
-      s += "\n"
-      s += "%s/* module function args */\n" % (t)
-      s += "%sstruct {\n" % t
-      t += "  "
-      if globalParameters["DebugKernel"]:
-        s += "%sunsigned int *debugBuffer;\n" % t
-      # Tensor sizes in elements, including only packed dims,
-      # and accounting for zero or other strides < size
-      # Place these first in the structure since they are 64-bits
-      # and need to avoid any unneeded padding:
-      s += "%s// Size of Tensor's packed dims, in elements\n" % t
-      s += "%suint64_t tensor2dSizeC;\n" % t
-      s += "%suint64_t tensor2dSizeA;\n" % t
-      s += "%suint64_t tensor2dSizeB;\n" % t
-      solutionArgs = self.getArgList(problemType, False, True, False, False)
-      for arg in solutionArgs:
-        if arg[0] == "TensileHalf":
-          s += "%s%s %s[2];\n" % (t, arg[0], arg[1])
-        else:
-          s += "%s%s %s;\n" % (t, arg[0], arg[1])
-      for idxChar in solution["PackedC0Indices"][:-1]:
-        s += "%sunsigned magicNumberSize%s;\n" % (t, idxChar)
-        s += "%sunsigned magicShiftSize%s;\n" % (t, idxChar)
-      for idxChar in solution["PackedC1Indices"][:-1]:
-        s += "%sunsigned magicNumberSize%s;\n" % (t, idxChar)
-        s += "%sunsigned magicShiftSize%s;\n" % (t, idxChar)
-
-      # number of unroll loop iterations to stagger the start in "U" dim.
-      s += "%sint staggerUIter;\n" % t
-
-      # persistent
-      s += "%sunsigned int problemNumGroupTiles0;\n" % t
-      s += "%sunsigned int problemNumGroupTiles1;\n" % t
-      s += "%sunsigned int magicNumberProblemNumGroupTiles0;\n" % t
-      s += "%sunsigned int gridNumWorkGroups0;\n" % t
-      s += "%sunsigned int numFullBlocks;\n" % t
-      s += "%sunsigned int wgmRemainder1;\n" % t
-      s += "%sunsigned int magicNumberWgmRemainder1;\n" % t
-
-      s += "%sunsigned int pad;\n" % t # FIXME can this be removed?
-      t = t[2:]
-      s += "%s} hipFunctionArgs;\n" % t
-      #s += "%sprintf(\"hipFunctionArgsSize: %%lu\\n\", sizeof(hipFunctionArgs));\n" % t
-      s += "%ssize_t hipFunctionArgsSize = sizeof(hipFunctionArgs);\n" % t
-      s += "%svoid *hipLaunchParams[] = {HIP_LAUNCH_PARAM_BUFFER_POINTER, &hipFunctionArgs, HIP_LAUNCH_PARAM_BUFFER_SIZE, &hipFunctionArgsSize, HIP_LAUNCH_PARAM_END};\n" % t
-      #s += "%sprintf(\"size: %%lu\\n\", sizeof(unsigned int));\n" % t
-      #s += "%sprintf(\"hipFunctionArgsSize: %%lu\\n\", sizeof(hipFunctionArgs));\n" % t
-      #for arg in solutionArgs:
-      #  s += "%sprintf(\"%s: %%lu\\n\", static_cast<char*>(static_cast<void*>(&hipFunctionArgs.%s)) - static_cast<char*>(static_cast<void*>(&hipFunctionArgs.%s)));\n" % (t, arg[1], arg[1], solutionArgs[0][1])
-
-    # NOTE: host compiler aligns size of structs to 64-bits (at least) and aligns the offset of pointers to 64-bits, therefore, having pointers which are not at the beginning of the struct may get padded/shifted by the host compiler and, therefore, not coppied correctly to gpu
-
-    if globalParameters["RuntimeLanguage"] == "HIP":
-      s += "%sint deviceId;\n" % (t)
-      s += "%shipGetDevice(&deviceId);\n" % (t)
-
-    # kernels
-    s += "\n%s/* kernels */\n" % (t)
-    s += "%sconst unsigned int numKernels = %u; // 1 or 4\n" % (t, len(kernels))
-
-    if kernelLanguage == "Source" and globalParameters["RuntimeLanguage"] == "OCL":
-      s += "%sconst char *kernelSources[numKernels] = {\n" % (t)
-      t += "  "
-      for kernelIdx in range(0, len(kernelNames)):
-        kernelName = kernelNames[kernelIdx]
-        s += "%s%s_src%s\n" % (t, kernelName, \
-            "," if kernelIdx < len(kernels)-1 else "" )
-      t = t[2:]
-      s += "%s};\n" % (t)
-      s += "%scl_kernel kernels[numKernels];\n" % (t)
-      s += "%sconst char *buildOptions = \"-cl-std=cl2.0\";\n" % (t)
-      s += "%sfor (unsigned int i = 0; i < numKernels; i++) {\n" % (t)
-      s += "%s  tensileGetCompiledOpenCLKernel(\n" % (t)
-      s += "%s      &kernels[i],\n" % (t)
-      s += "%s      kernelSources[i],\n" % (t)
-      s += "%s      stream,\n" % (t)
-      s += "%s      buildOptions);\n" % (t)
-      s += "%s}\n" % (t)
+    if globalParameters["DebugKernel"]:
+      s += "%sunsigned int *debugBuffer;\n" % t
+    # Tensor sizes in elements, including only packed dims,
+    # and accounting for zero or other strides < size
+    # Place these first in the structure since they are 64-bits
+    # and need to avoid any unneeded padding:
+    s += "%s// Size of Tensor's packed dims, in elements\n" % t
+    s += "%suint64_t tensor2dSizeC;\n" % t
+    s += "%suint64_t tensor2dSizeA;\n" % t
+    s += "%suint64_t tensor2dSizeB;\n" % t
+    solutionArgs = self.getArgList(problemType, False, True, False, False)
+    for arg in solutionArgs:
+      if arg[0] == "TensileHalf":
+        s += "%s%s %s[2];\n" % (t, arg[0], arg[1])
+      else:
+        s += "%s%s %s;\n" % (t, arg[0], arg[1])
+    for idxChar in solution["PackedC0Indices"][:-1]:
+      s += "%sunsigned magicNumberSize%s;\n" % (t, idxChar)
+      s += "%sunsigned magicShiftSize%s;\n" % (t, idxChar)
+    for idxChar in solution["PackedC1Indices"][:-1]:
+      s += "%sunsigned magicNumberSize%s;\n" % (t, idxChar)
+      s += "%sunsigned magicShiftSize%s;\n" % (t, idxChar)
+
+    # number of unroll loop iterations to stagger the start in "U" dim.
+    s += "%sint staggerUIter;\n" % t
+
+    # persistent
+    s += "%sunsigned int problemNumGroupTiles0;\n" % t
+    s += "%sunsigned int problemNumGroupTiles1;\n" % t
+    s += "%sunsigned int magicNumberProblemNumGroupTiles0;\n" % t
+    s += "%sunsigned int gridNumWorkGroups0;\n" % t
+    s += "%sunsigned int numFullBlocks;\n" % t
+    s += "%sunsigned int wgmRemainder1;\n" % t
+    s += "%sunsigned int magicNumberWgmRemainder1;\n" % t
+
+    s += "%sunsigned int pad;\n" % t # FIXME can this be removed?
+    t = t[2:]
+    s += "%s};\n" % t
+    return s
 
-      if gsu > 1:
-        for beta in Solution.getKernelsBetaOnlyFromProblem(problemType, gsu):
-          kernelName = self.kernelWriter.getKernelNameBetaOnly(beta)
-          s += "%scl_kernel kernel_%s;\n" % (t, kernelName)
-          s += "%s  tensileGetCompiledOpenCLKernel(\n" % (t)
-          s += "%s      &kernel_%s,\n" % (t, kernelName)
-          s += "%s      %s_src,\n" % (t, kernelName)
-          s += "%s      stream,\n" % (t)
-          s += "%s      buildOptions);\n" % (t)
+  ########################################
+  # set the data pointers and alpha/beta in hipFunctionArgs
+  def getKernelArgsDataString(self, problemType, t):
+    s = ""
+    s += "%shipFunctionArgs.dataD = dataD;\n" % (t)
+    s += "%shipFunctionArgs.dataC = dataC;\n" % (t)
+    s += "%shipFunctionArgs.dataA = dataA;\n" % (t)
+    s += "%shipFunctionArgs.dataB = dataB;\n" % (t)
+
+    if problemType["DataType"].isHalf():
+      s += "%shipFunctionArgs.alpha[0] = alpha;\n" % (t)
+      s += "%shipFunctionArgs.alpha[1] = alpha;\n" % (t)
+    else:
+      s += "%shipFunctionArgs.alpha = alpha;\n" % (t)
+    if problemType["UseBeta"]:
+      if problemType["DataType"].isHalf():
+        s += "%shipFunctionArgs.beta[0] = beta;\n" % (t)
+        s += "%shipFunctionArgs.beta[1] = beta;\n" % (t)
+      else:
+        s += "%shipFunctionArgs.beta = beta;\n" % (t)
+    return s
 
-    elif kernelLanguage == "Assembly":
-      kernel = kernels[0]
-      s += "%shipFunction_t hipFunction;\n" % (t)
-      # if !CodeFromFiles then pass global _coba that points to code object
-      s += "%sstatus = solutionLock->getFunction(&hipFunction, deviceId, \"%s\", %s);;\n" \
-              % (t, kernelName, "nullptr" if globalParameters["CodeFromFiles"] else kernelName+"_coba" )
-      s += "%sif (status) return status;\n" % (t)
+  ########################################
+  # set the arguments depending on the problem dims in hipFunctionArgs
+  def getKernelArgsSizesString(self, solution, t):
+    problemType = solution["ProblemType"]
+    s = ""
+    # strides
+    for stride in self.strideList:
+      s += "%shipFunctionArgs.%s = %s;\n" % (t, stride, stride)
+    # sizes
+    for i in range(0, problemType["TotalIndices"]):
+      lastParam = i == problemType["TotalIndices"]-1
+      s += "%shipFunctionArgs.size%s = sizes[kernelIdx][enqueueIdx][%u];\n" \
+          % (t, globalParameters["IndexChars"][i], i )
+
+    s += "%shipFunctionArgs.tensor2dSizeC = tensor2dSizeC;\n" % (t)
+    s += "%shipFunctionArgs.tensor2dSizeA = tensor2dSizeA;\n" % (t)
+    s += "%shipFunctionArgs.tensor2dSizeB = tensor2dSizeB;\n" % (t)
+
+    s += "%shipFunctionArgs.staggerUIter = staggerUIter;\n" % (t)
+    # persistent - pass in the number of tiles in problem since not available in WG
+    s += "\n"
+    s += "%shipFunctionArgs.problemNumGroupTiles0 = problemNumGroupTiles0;\n" % (t)
+    s += "%shipFunctionArgs.problemNumGroupTiles1 = problemNumGroupTiles1;\n" % (t)
+    s += "%shipFunctionArgs.magicNumberProblemNumGroupTiles0 = magicNumberProblemNumGroupTiles0;\n" % (t)
+    s += "%shipFunctionArgs.gridNumWorkGroups0 = globalWorkSize[kernelIdx][0];\n" % (t) #
+    s += "%shipFunctionArgs.numFullBlocks = numFullBlocks;\n" % (t)
+    s += "%shipFunctionArgs.wgmRemainder1 = wgmRemainder1;\n" % (t)
+    s += "%shipFunctionArgs.magicNumberWgmRemainder1 = magicNumberWgmRemainder1;\n" % (t)
+
+    # Magic numbers for packed indices:
+    for idxChar in solution["PackedC0Indices"][:-1]:
+      s += "%shipFunctionArgs.magicNumberSize%s = magicNumberSize%s;\n" % (t, idxChar, idxChar)
+      s += "%shipFunctionArgs.magicShiftSize%s = magicShiftSize%s;\n" % (t, idxChar, idxChar)
+    for idxChar in solution["PackedC1Indices"][:-1]:
+      s += "%shipFunctionArgs.magicNumberSize%s = magicNumberSize%s;\n" % (t, idxChar, idxChar)
+      s += "%shipFunctionArgs.magicShiftSize%s = magicShiftSize%s;\n" % (t, idxChar, idxChar)
+    return s
 
-    typeName = problemType["DataType"].toCpp()
+  ########################################
+  # hipHccModuleLaunchKernel call, sizes are lists of 3 expressions
+  def getModuleLaunchString(self, t, globalWorkSize, localWorkSize):
+    s = ""
+    s += "%skernelsLaunched++;\n" % (t)
+    s += "%shipHccModuleLaunchKernel(\n" % (t)
+    t += "  "
+    s += "%shipFunction,\n" % (t)
+    for size in globalWorkSize:
+      s += "%s%s,\n" % (t, size)
+    for size in localWorkSize:
+      s += "%s%s,\n" % (t, size)
+    s += "%s0, // groupMemBytes\n" % (t)
+    s += "%sstream,\n" % (t)
+    s += "%sNULL,\n" % (t)
+    s += "%s(void**)hipLaunchParams\n" % (t)
+    if globalParameters["PreciseKernelTime"]:
+      s += "%s,(inputEvents && kernelsLaunched==1) ? inputEvents[enqueueIdx]:nullptr\n" %(t)
+      s += "%s,outputEvent ? outputEvent[enqueueIdx]:nullptr\n" % (t)
+
+    s += "%s);\n" % (t)
+    return s
 
+  ########################################
+  # grid and work-group sizes, index sizes and the values derived from them
+  def getLaunchSizesString(self, solution, t):
+    problemType = solution["ProblemType"]
+    gsu = solution["GlobalSplitU"]
+    persistent = solution["PersistentKernel"]
+    tt0 = solution["ThreadTile0"]
+    tt1 = solution["ThreadTile1"]
+    sg0 = solution["SubGroup0"]
+    sg1 = solution["SubGroup1"]
+    nt  = solution["NumThreads"]
+    kernels = solution.getKernels()
+    kernel = kernels[-1]
+    s = ""
     # num enqueues
     s += "\n%s/* num kernels */\n" % (t)
     s += "%sunsigned int numEnqueues[numKernels] = { 1" % (t)
@@ -295,11 +317,10 @@ class SolutionWriter:
     if gsu> 1:
       s += "%stotalWorkGroups1 *= %u; // GlobalSplitU\n" % (t, gsu)
     if persistent:
-      s += "%shipDeviceProp_t deviceProperties;\n" % (t)
-      # TODO - should cache the device properties - expensive to call on each iteration here:
-      s += "%shipGetDeviceProperties( &deviceProperties, deviceId );\n" % (t)
+      # device properties are queried once per process and shared by all solutions:
+      s += "%sunsigned int multiProcessorCount = TensileDeviceContext::instance().properties(deviceId)._multiProcessorCount;\n" % (t)
       s += "%sunsigned int numGroups = totalWorkGroups0 * totalWorkGroups1;\n" % (t)
-      s += "%sglobalWorkSize[0][0] = (deviceProperties.multiProcessorCount * %u < numGroups) ? (deviceProperties.multiProcessorCount * %u) : numGroups;\n" \
+      s += "%sglobalWorkSize[0][0] = (multiProcessorCount * %u < numGroups) ? (multiProcessorCount * %u) : numGroups;\n" \
               % (t, persistent, persistent)
 
       s += "%sglobalWorkSize[0][1] = 1;\n" % t
@@ -411,6 +432,206 @@ class SolutionWriter:
     s += "    staggerUIter /= 2; // step down to smaller stagger\n"
     s += "  }\n"
     s += "  if (staggerUIter>=1) staggerUIter -= 1;\n" # convert to a mask
+    return s
+
+
+  ########################################
+  # plan and execute functions of a solution, see hasLaunchPlan
+  # buildErrKernels lists the kernels with build failures, if any
+  def getLaunchPlanString(self, solution, buildErrKernels):
+    if not self.hasLaunchPlan(solution):
+      return ""
+    problemType = solution["ProblemType"]
+    kernelName = self.kernelWriter.getKernelName(solution.getKernels()[0])
+    structName = self.getKernelArgsStructName(solution)
+    t = "  "
+    s = ""
+    if buildErrKernels:
+      for signature in [self.getPlanSignature(solution), self.getExecuteSignature(solution)]:
+        s += signature + " {\n"
+        s += "%sreturn tensileStatusFailure; // One or more kernels had build failures (%s)\n" % (t, buildErrKernels)
+        s += "}\n\n"
+      return s
+
+    # plan: everything that only depends on the problem dims
+    s += self.getPlanSignature(solution)
+    s += " {\n"
+    s += "%sint deviceId = TensileDeviceContext::instance().currentDevice();\n" % (t)
+    s += "\n%s/* kernels */\n" % (t)
+    s += "%sconst unsigned int numKernels = 1;\n" % (t)
+    s += self.getLaunchSizesString(solution, t)
+    s += "\n"
+    s += "%s/* kernel args, except the data pointers and alpha/beta set by execute */\n" % (t)
+    s += "%s%s hipFunctionArgs = %s();\n" % (t, structName, structName)
+    s += "%sunsigned int kernelIdx = 0;\n" % (t)
+    s += "%sunsigned int enqueueIdx = 0;\n" % (t)
+    s += self.getKernelArgsSizesString(solution, t)
+    s += "\n"
+    s += "%sstatic_assert(sizeof(hipFunctionArgs) <= sizeof(launch->_args), \"kernel args do not fit in SolutionLaunch\");\n" % (t)
+    s += "%smemcpy(launch->_args, &hipFunctionArgs, sizeof(hipFunctionArgs));\n" % (t)
+    s += "%slaunch->_argsSize = sizeof(hipFunctionArgs);\n" % (t)
+    s += "%slaunch->_deviceId = deviceId;\n" % (t)
+    for i in range(0, 3):
+      s += "%slaunch->_globalWorkSize[%u] = globalWorkSize[0][%u]*localWorkSize[%u];\n" % (t, i, i, i)
+      s += "%slaunch->_localWorkSize[%u] = localWorkSize[%u];\n" % (t, i, i)
+    s += "%sreturn tensileStatusSuccess;\n" % (t)
+    s += "}\n\n"
+
+    # execute: patch the data pointers and alpha/beta, then enqueue
+    s += self.getExecuteSignature(solution)
+    s += " {\n"
+    s += "%sTensileStatus status;\n" % (t)
+    s += "%shipFunction_t hipFunction;\n" % (t)
+    s += "%sTensileModulePin modulePin(stream); // keeps the module loaded until the kernel has run\n" % (t)
+    s += "%sstatus = solutionLock->getFunction(&hipFunction, launch->_deviceId, \"%s\", %s, &modulePin);\n" \
+            % (t, kernelName, "nullptr" if globalParameters["CodeFromFiles"] else kernelName+"_coba" )
+    s += "%sif (status) return status;\n" % (t)
+    s += "\n"
+    s += "%s%s hipFunctionArgs;\n" % (t, structName)
+    s += "%smemcpy(&hipFunctionArgs, launch->_args, sizeof(hipFunctionArgs));\n" % (t)
+    s += self.getKernelArgsDataString(problemType, t)
+    s += "%ssize_t hipFunctionArgsSize = sizeof(hipFunctionArgs);\n" % t
+    s += "%svoid *hipLaunchParams[] = {HIP_LAUNCH_PARAM_BUFFER_POINTER, &hipFunctionArgs, HIP_LAUNCH_PARAM_BUFFER_SIZE, &hipFunctionArgsSize, HIP_LAUNCH_PARAM_END};\n" % t
+    s += "\n"
+    s += "%sint kernelsLaunched=0;\n" % (t)
+    s += "%sunsigned int enqueueIdx = 0;\n" % (t)
+    if not globalParameters["PreciseKernelTime"]:
+      s += "%sif( inputEvents != NULL )\n" % (t)
+      s += "%s  hipEventRecord(inputEvents[enqueueIdx], stream );\n" % (t)
+    s += "%stry {\n" % (t)
+    s += self.getModuleLaunchString(t + "  ", \
+        ["launch->_globalWorkSize[%u]" % i for i in range(0, 3)], \
+        ["launch->_localWorkSize[%u]" % i for i in range(0, 3)])
+    s += "%s} catch (const std::exception& e) {\n" % (t)
+    s += "#ifdef DEBUG\n"
+    s += "%s  std::cerr << e.what() << std::endl;\n" % (t)
+    s += "#endif\n"
+    s += "%s  return tensileStatusFailure;\n" % (t)
+    s += "%s}\n" % (t)
+    if not globalParameters["PreciseKernelTime"]:
+      s += "%sif( outputEvent != NULL )\n" % (t)
+      s += "%s  hipEventRecord(outputEvent[enqueueIdx], stream );\n" % (t)
+    s += "%sreturn tensileStatusSuccess;\n" % (t)
+    s += "}\n\n"
+    return s
+
+
+  ##############################################################################
+  # getSourceString
+  ##############################################################################
+  def getProblemSourceString(self, problemType, solution, kernelsWithBuildErrs):
+    gsu = solution["GlobalSplitU"]
+    kernelLanguage = solution["KernelLanguage"]
+    es  = solution["LdcEqualsLdd"]
+
+    kernels = solution.getKernels()
+    kernelNames = []
+    kernelBuildErr = 0
+    for kernel in kernels:
+      kernelName = self.kernelWriter.getKernelName(kernel)
+      if kernelName in kernelsWithBuildErrs:
+        kernelBuildErr = 1
+      kernelNames.append( kernelName )
+
+
+    s = ""
+    t = ""
+    # includes
+
+    problemType = solution["ProblemType"] # shortcut
+
+    if not globalParameters["MergeFiles"]:
+      solutionName = self.getSolutionName(solution)
+      s += "#include \"%s.h\"\n" % solutionName
+      s += "\n"
+
+    # problem function signature
+    #argList = self.getArgList(problemType, True, True, True, True)
+    #for i in range(0, len(argList)):
+    #  argString = "%s %s" % argList[i]
+    #  s += "%s%s%s" % (t, argString, ",\n" if i < len(argList)-1 else ")" )
+
+    if kernelLanguage == "Assembly" and not kernelBuildErr:
+      s += self.getKernelArgsStructString(solution)
+      s += "\n"
+
+    s += self.getSolutionSignature(solution)
+
+    s += " {\n"
+    if kernelBuildErr:
+      s += "%s  return tensileStatusFailure; // One or more kernels had build failures (%s)\n" % (t, kernelNames)
+      s += "%s}\n" % (t)
+      s += "\n"
+      s += self.getLaunchPlanString(solution, kernelNames)
+      return s
+
+    t += "  "
+    s += "%sTensileStatus status;\n" % (t)
+
+
+    # hipFunction Struct
+    if kernelLanguage == "Assembly":
+      s += "\n"
+      s += "%s/* module function args */\n" % (t)
+      s += "%s%s hipFunctionArgs;\n" % (t, self.getKernelArgsStructName(solution))
+      #s += "%sprintf(\"hipFunctionArgsSize: %%lu\\n\", sizeof(hipFunctionArgs));\n" % t
+      s += "%ssize_t hipFunctionArgsSize = sizeof(hipFunctionArgs);\n" % t
+      s += "%svoid *hipLaunchParams[] = {HIP_LAUNCH_PARAM_BUFFER_POINTER, &hipFunctionArgs, HIP_LAUNCH_PARAM_BUFFER_SIZE, &hipFunctionArgsSize, HIP_LAUNCH_PARAM_END};\n" % t
+      #s += "%sprintf(\"size: %%lu\\n\", sizeof(unsigned int));\n" % t
+      #s += "%sprintf(\"hipFunctionArgsSize: %%lu\\n\", sizeof(hipFunctionArgs));\n" % t
+      #for arg in solutionArgs:
+      #  s += "%sprintf(\"%s: %%lu\\n\", static_cast<char*>(static_cast<void*>(&hipFunctionArgs.%s)) - static_cast<char*>(static_cast<void*>(&hipFunctionArgs.%s)));\n" % (t, arg[1], arg[1], solutionArgs[0][1])
+
+    # NOTE: host compiler aligns size of structs to 64-bits (at least) and aligns the offset of pointers to 64-bits, therefore, having pointers which are not at the beginning of the struct may get padded/shifted by the host compiler and, therefore, not coppied correctly to gpu
+
+    if globalParameters["RuntimeLanguage"] == "HIP":
+      s += "%sint deviceId = TensileDeviceContext::instance().currentDevice();\n" % (t)
+
+    # kernels
+    s += "\n%s/* kernels */\n" % (t)
+    s += "%sconst unsigned int numKernels = %u; // 1 or 4\n" % (t, len(kernels))
+
+    if kernelLanguage == "Source" and globalParameters["RuntimeLanguage"] == "OCL":
+      s += "%sconst char *kernelSources[numKernels] = {\n" % (t)
+      t += "  "
+      for kernelIdx in range(0, len(kernelNames)):
+        kernelName = kernelNames[kernelIdx]
+        s += "%s%s_src%s\n" % (t, kernelName, \
+            "," if kernelIdx < len(kernels)-1 else "" )
+      t = t[2:]
+      s += "%s};\n" % (t)
+      s += "%scl_kernel kernels[numKernels];\n" % (t)
+      s += "%sconst char *buildOptions = \"-cl-std=cl2.0\";\n" % (t)
+      s += "%sfor (unsigned int i = 0; i < numKernels; i++) {\n" % (t)
+      s += "%s  tensileGetCompiledOpenCLKernel(\n" % (t)
+      s += "%s      &kernels[i],\n" % (t)
+      s += "%s      kernelSources[i],\n" % (t)
+      s += "%s      stream,\n" % (t)
+      s += "%s      buildOptions);\n" % (t)
+      s += "%s}\n" % (t)
+
+      if gsu > 1:
+        for beta in Solution.getKernelsBetaOnlyFromProblem(problemType, gsu):
+          kernelName = self.kernelWriter.getKernelNameBetaOnly(beta)
+          s += "%scl_kernel kernel_%s;\n" % (t, kernelName)
+          s += "%s  tensileGetCompiledOpenCLKernel(\n" % (t)
+          s += "%s      &kernel_%s,\n" % (t, kernelName)
+          s += "%s      %s_src,\n" % (t, kernelName)
+          s += "%s      stream,\n" % (t)
+          s += "%s      buildOptions);\n" % (t)
+
+    elif kernelLanguage == "Assembly":
+      kernel = kernels[0]
+      s += "%shipFunction_t hipFunction;\n" % (t)
+      s += "%sTensileModulePin modulePin(stream); // keeps the module loaded until the kernels have run\n" % (t)
+      # if !CodeFromFiles then pass global _coba that points to code object
+      s += "%sstatus = solutionLock->getFunction(&hipFunction, deviceId, \"%s\", %s, &modulePin);\n" \
+              % (t, kernelName, "nullptr" if globalParameters["CodeFromFiles"] else kernelName+"_coba" )
+      s += "%sif (status) return status;\n" % (t)
+
+    typeName = problemType["DataType"].toCpp()
+
+    s += self.getLaunchSizesString(solution, t)
     #s += '  printf ("size%s=%%u StaggerU=%s unrollLoopIters=%%u, staggerUIter=%%d\\n", size%s, unrollLoopIters, staggerUIter);\n' % (unrollChar, solution["StaggerU"], unrollChar)
 
 
@@ -715,78 +936,12 @@ class SolutionWriter:
             s += "%smemset(debugBufferHostPtr,1,debugBufferSize);\n" % (t)
 
           # hip assembly function
-          s += "%shipFunctionArgs.tensor2dSizeC = tensor2dSizeC;\n" % (t)
-          s += "%shipFunctionArgs.tensor2dSizeA = tensor2dSizeA;\n" % (t)
-          s += "%shipFunctionArgs.tensor2dSizeB = tensor2dSizeB;\n" % (t)
-
-          s += "%shipFunctionArgs.dataD = dataD;\n" % (t)
-          s += "%shipFunctionArgs.dataC = dataC;\n" % (t)
-          s += "%shipFunctionArgs.dataA = dataA;\n" % (t)
-          s += "%shipFunctionArgs.dataB = dataB;\n" % (t)
-
-          if problemType["DataType"].isHalf():
-            s += "%shipFunctionArgs.alpha[0] = alpha;\n" % (t)
-            s += "%shipFunctionArgs.alpha[1] = alpha;\n" % (t)
-          else:
-            s += "%shipFunctionArgs.alpha = alpha;\n" % (t)
-          if problemType["UseBeta"]:
-            if problemType["DataType"].isHalf():
-              s += "%shipFunctionArgs.beta[0] = beta;\n" % (t)
-              s += "%shipFunctionArgs.beta[1] = beta;\n" % (t)
-            else:
-              s += "%shipFunctionArgs.beta = beta;\n" % (t)
-          # strides
-          for stride in self.strideList:
-            s += "%shipFunctionArgs.%s = %s;\n" % (t, stride, stride)
-          # sizes
-          for i in range(0, problemType["TotalIndices"]):
-            lastParam = i == problemType["TotalIndices"]-1
-            s += "%shipFunctionArgs.size%s = sizes[kernelIdx][enqueueIdx][%u];\n" \
-                % (t, globalParameters["IndexChars"][i], i )
-
-          s += "%shipFunctionArgs.tensor2dSizeC = tensor2dSizeC;\n" % (t)
-          s += "%shipFunctionArgs.tensor2dSizeA = tensor2dSizeA;\n" % (t)
-          s += "%shipFunctionArgs.tensor2dSizeB = tensor2dSizeB;\n" % (t)
-
-          s += "%shipFunctionArgs.staggerUIter = staggerUIter;\n" % (t)
-          # persistent - pass in the number of tiles in problem since not available in WG
-          s += "\n"
-          s += "%shipFunctionArgs.problemNumGroupTiles0 = problemNumGroupTiles0;\n" % (t)
-          s += "%shipFunctionArgs.problemNumGroupTiles1 = problemNumGroupTiles1;\n" % (t)
-          s += "%shipFunctionArgs.magicNumberProblemNumGroupTiles0 = magicNumberProblemNumGroupTiles0;\n" % (t)
-          s += "%shipFunctionArgs.gridNumWorkGroups0 = globalWorkSize[kernelIdx][0];\n" % (t) #
-          s += "%shipFunctionArgs.numFullBlocks = numFullBlocks;\n" % (t)
-          s += "%shipFunctionArgs.wgmRemainder1 = wgmRemainder1;\n" % (t)
-          s += "%shipFunctionArgs.magicNumberWgmRemainder1 = magicNumberWgmRemainder1;\n" % (t)
-
-          # Magic numbers for packed indices:
-          for idxChar in solution["PackedC0Indices"][:-1]:
-            s += "%shipFunctionArgs.magicNumberSize%s = magicNumberSize%s;\n" % (t, idxChar, idxChar)
-            s += "%shipFunctionArgs.magicShiftSize%s = magicShiftSize%s;\n" % (t, idxChar, idxChar)
-          for idxChar in solution["PackedC1Indices"][:-1]:
-            s += "%shipFunctionArgs.magicNumberSize%s = magicNumberSize%s;\n" % (t, idxChar, idxChar)
-            s += "%shipFunctionArgs.magicShiftSize%s = magicShiftSize%s;\n" % (t, idxChar, idxChar)
+          s += self.getKernelArgsDataString(problemType, t)
+          s += self.getKernelArgsSizesString(solution, t)
 
-          s += "%skernelsLaunched++;\n" % (t)
-          s += "%shipHccModuleLaunchKernel(\n" % (t)
-          t += "  "
-          s += "%shipFunction,\n" % (t)
-          s += "%sglobalWorkSize[kernelIdx][0]*localWorkSize[0],\n" % (t)
-          s += "%sglobalWorkSize[kernelIdx][1]*localWorkSize[1],\n" % (t)
-          s += "%sglobalWorkSize[kernelIdx][2]*localWorkSize[2],\n" % (t)
-          s += "%slocalWorkSize[0],\n" % (t)
-          s += "%slocalWorkSize[1],\n" % (t)
-          s += "%slocalWorkSize[2],\n" % (t)
-          s += "%s0, // groupMemBytes\n" % (t)
-          s += "%sstream,\n" % (t)
-          s += "%sNULL,\n" % (t)
-          s += "%s(void**)hipLaunchParams\n" % (t)
-          if globalParameters["PreciseKernelTime"]:
-            s += "%s,(inputEvents && kernelsLaunched==1) ? inputEvents[enqueueIdx]:nullptr\n" %(t)
-            s += "%s,outputEvent ? outputEvent[enqueueIdx]:nullptr\n" % (t)
-
-          s += "%s);\n" % (t)
-          t = t[2:]
+          s += self.getModuleLaunchString(t, \
+              ["globalWorkSize[kernelIdx][%u]*localWorkSize[%u]" % (i, i) for i in range(0, 3)], \
+              ["localWorkSize[%u]" % i for i in range(0, 3)])
           if globalParameters["DebugKernel"]:
             # copy debug buffer
             s += "%shipMemcpyDtoH(debugBufferHostPtr, hipFunctionArgs.debugBuffer, debugBufferSize);\n" % (t)
@@ -819,6 +974,7 @@ class SolutionWriter:
     s += "  return tensileStatusSuccess;\n"
     s += "}\n"
     s += "\n"
+    s += self.getLaunchPlanString(solution, None)
     s += "/* Solution Parameters\n"
     s += Solution.getParametersIndented(solution.getAttributes(), "  ")
     s += "*/\n"
@@ -854,6 +1010,9 @@ class SolutionWriter:
 
     # function declaration
     s += self.getSolutionSignature(solution) + ";\n"
+    if self.hasLaunchPlan(solution):
+      s += self.getPlanSignature(solution) + ";\n"
+      s += self.getExecuteSignature(solution) + ";\n"
     s += "\n"
     #s += "#endif\n"
     s += "\n"
@@ -927,15 +1086,41 @@ class SolutionWriter:
       argList.append(("%s *"%self.eventName, "outputEvent"))
     return argList
 
+  ########################################
+  # get plan function arguments: the launch to fill and the problem dims
+  def getPlanArgList(self, problemType):
+    argList = self.getArgList(problemType, False, False, False, False)
+    argList.insert(0, ("SolutionLaunch *", "launch"))
+    return argList
+
+  ########################################
+  # get execute function arguments: everything but the problem dims
+  def getExecuteArgList(self, problemType):
+    argList = self.getArgList(problemType, True, True, True, True)
+    dims = self.strideList + self.sizeList
+    argList = [arg for arg in argList if arg[1] not in dims]
+    argList.insert(1, ("const SolutionLaunch *", "launch"))
+    return argList
+
   ########################################
   # get function signature
   def getSolutionSignature(self, solution):
+    argList = self.getArgList(solution["ProblemType"], True, True, True, True)
+    return self.getFunctionSignature(self.getSolutionName(solution), argList)
+
+  def getPlanSignature(self, solution):
+    argList = self.getPlanArgList(solution["ProblemType"])
+    return self.getFunctionSignature(self.getSolutionName(solution) + "_plan", argList)
+
+  def getExecuteSignature(self, solution):
+    argList = self.getExecuteArgList(solution["ProblemType"])
+    return self.getFunctionSignature(self.getSolutionName(solution) + "_execute", argList)
+
+  def getFunctionSignature(self, functionName, argList):
     t = "" # indent
     s = ""
-    solutionName = self.getSolutionName(solution)
-    s += "%s%s %s(\n" % (t, self.statusName, solutionName)
+    s += "%s%s %s(\n" % (t, self.statusName, functionName)
     t += "    "
-    argList = self.getArgList(solution["ProblemType"], True, True, True, True)
     for i in range(0, len(argList)):
       argString = "%s %s" % argList[i]
       s += "%s%s%s" % (t, argString, ",\n" if i < len(argList)-1 else ")" )
@@ -0,0 +1,300 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#include "DeviceContext.h"
+#include "Tools.h"
+#include <cstdlib>
+#include <limits>
+
+namespace {
+// Current device cached by each thread, valid while _generation matches the context
+struct CachedDevice {
+  uint64_t _generation;
+  int      _deviceId;
+};
+
+#ifdef WIN32
+__declspec(thread) CachedDevice cachedDevice = {0, -1};
+#else
+thread_local CachedDevice cachedDevice = {0, -1};
+#endif
+}
+
+/*******************************************************************************
+ * HIP runtime
+ ******************************************************************************/
+#if Tensile_RUNTIME_LANGUAGE_HIP
+int HipDeviceRuntime::deviceCount() {
+  int numDevices = 0;
+  if (hipGetDeviceCount(&numDevices) != hipSuccess)
+    return 0;
+  return numDevices;
+}
+
+int HipDeviceRuntime::currentDevice() {
+  int deviceId = 0;
+  hipGetDevice(&deviceId);
+  return deviceId;
+}
+
+TensileStatus HipDeviceRuntime::setDevice(int deviceId) {
+  return hipSetDevice(deviceId);
+}
+
+TensileStatus HipDeviceRuntime::getProperties(int deviceId, TensileDeviceProperties *props) {
+  hipDeviceProp_t deviceProperties;
+  hipError_t e = hipGetDeviceProperties(&deviceProperties, deviceId);
+  if (e) { return e; };
+  props->_name = deviceProperties.name;
+  props->_multiProcessorCount = deviceProperties.multiProcessorCount;
+  props->_gcnArch = deviceProperties.gcnArch;
+  return hipSuccess;
+}
+
+double HipEventLaunchTimer::time(TensileStream stream, const std::function<TensileStatus()> &launch,
+                                 TensileStatus *status) {
+  double elapsedMs = std::numeric_limits<double>::infinity();
+  hipEvent_t events[2];
+  if (hipEventCreate(&events[0]) != hipSuccess) {
+    *status = launch();
+    return elapsedMs;
+  }
+  if (hipEventCreate(&events[1]) != hipSuccess) {
+    hipEventDestroy(events[0]);
+    *status = launch();
+    return elapsedMs;
+  }
+
+  hipEventRecord(events[0], stream);
+  *status = launch();
+  hipEventRecord(events[1], stream);
+  if (*status == hipSuccess && hipEventSynchronize(events[1]) == hipSuccess) {
+    float ms = 0;
+    if (hipEventElapsedTime(&ms, events[0], events[1]) == hipSuccess)
+      elapsedMs = ms;
+  }
+  hipEventDestroy(events[0]);
+  hipEventDestroy(events[1]);
+  return elapsedMs;
+}
+#endif
+
+/*******************************************************************************
+ * OpenCL runtime
+ ******************************************************************************/
+#if Tensile_RUNTIME_LANGUAGE_OCL
+namespace {
+thread_local int oclCurrentDevice = 0;
+}
+
+void OclDeviceRuntime::enumerate() {
+  cl_platform_id platform;
+  cl_uint numPlatforms = 0;
+  if (clGetPlatformIDs(1, &platform, &numPlatforms) != CL_SUCCESS || numPlatforms == 0)
+    return;
+  cl_uint numDevices = 0;
+  if (clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 0, nullptr, &numDevices) != CL_SUCCESS)
+    return;
+  _devices.resize(numDevices);
+  if (clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, numDevices, _devices.data(), nullptr) != CL_SUCCESS)
+    _devices.clear();
+}
+
+int OclDeviceRuntime::deviceCount() {
+  std::call_once(_enumerateOnce, &OclDeviceRuntime::enumerate, this);
+  return static_cast<int>(_devices.size());
+}
+
+int OclDeviceRuntime::currentDevice() {
+  return oclCurrentDevice;
+}
+
+TensileStatus OclDeviceRuntime::setDevice(int deviceId) {
+  if (deviceId < 0 || deviceId >= deviceCount())
+    return CL_INVALID_DEVICE;
+  oclCurrentDevice = deviceId;
+  return CL_SUCCESS;
+}
+
+TensileStatus OclDeviceRuntime::getProperties(int deviceId, TensileDeviceProperties *props) {
+  if (deviceId < 0 || deviceId >= deviceCount())
+    return CL_INVALID_DEVICE;
+  char name[256];
+  cl_uint computeUnits = 0;
+  cl_int status = clGetDeviceInfo(_devices[deviceId], CL_DEVICE_NAME, sizeof(name), name, nullptr);
+  if (status != CL_SUCCESS) { return status; };
+  status = clGetDeviceInfo(_devices[deviceId], CL_DEVICE_MAX_COMPUTE_UNITS,
+      sizeof(computeUnits), &computeUnits, nullptr);
+  if (status != CL_SUCCESS) { return status; };
+  props->_name = name;
+  props->_multiProcessorCount = computeUnits;
+  props->_gcnArch = 0;
+  return CL_SUCCESS;
+}
+
+double OclFinishLaunchTimer::time(TensileStream stream, const std::function<TensileStatus()> &launch,
+                                  TensileStatus *status) {
+  clFinish(stream);
+  TensileTimer timer;
+  timer.start();
+  *status = launch();
+  if (*status != CL_SUCCESS || clFinish(stream) != CL_SUCCESS)
+    return std::numeric_limits<double>::infinity();
+  return timer.elapsed_ms();
+}
+#endif
+
+/*******************************************************************************
+ * Fake runtime
+ ******************************************************************************/
+namespace {
+thread_local int fakeCurrentDevice = 0;
+}
+
+FakeDeviceRuntime::FakeDeviceRuntime(const std::vector<TensileDeviceProperties> &devices)
+  : _devices(devices), _currentDeviceQueries(0)
+{
+}
+
+int FakeDeviceRuntime::deviceCount() {
+  return static_cast<int>(_devices.size());
+}
+
+int FakeDeviceRuntime::currentDevice() {
+  _currentDeviceQueries++;
+  return fakeCurrentDevice;
+}
+
+TensileStatus FakeDeviceRuntime::setDevice(int deviceId) {
+  if (deviceId < 0 || deviceId >= deviceCount())
+    return tensileStatusFailure;
+  fakeCurrentDevice = deviceId;
+  return tensileStatusSuccess;
+}
+
+TensileStatus FakeDeviceRuntime::getProperties(int deviceId, TensileDeviceProperties *props) {
+  if (deviceId < 0 || deviceId >= deviceCount())
+    return tensileStatusFailure;
+  *props = _devices[deviceId];
+  return tensileStatusSuccess;
+}
+
+/*******************************************************************************
+ * Device context
+ ******************************************************************************/
+TensileDeviceContext &TensileDeviceContext::instance() {
+#if Tensile_RUNTIME_LANGUAGE_OCL
+  static OclDeviceRuntime defaultRuntime;
+  static OclFinishLaunchTimer defaultLaunchTimer;
+#else
+  static HipDeviceRuntime defaultRuntime;
+  static HipEventLaunchTimer defaultLaunchTimer;
+#endif
+  static TensileDeviceContext context(&defaultRuntime, &defaultLaunchTimer);
+  return context;
+}
+
+TensileDeviceContext::TensileDeviceContext(TensileDeviceRuntime *runtime, TensileLaunchTimer *launchTimer)
+  : _runtime(runtime), _launchTimer(launchTimer), _deviceInfo(nullptr), _generation(1),
+    _cacheCurrentDevice(CACHE_CURRENT_DEVICE != 0)
+{
+  const char *cacheCurrentDevice = std::getenv("TENSILE_CACHE_CURRENT_DEVICE");
+  if (cacheCurrentDevice) {
+    _cacheCurrentDevice = strtol(cacheCurrentDevice,nullptr,0) != 0;
+  }
+}
+
+void TensileDeviceContext::setRuntime(TensileDeviceRuntime *runtime) {
+  std::lock_guard<std::mutex> lockGuard(_deviceInfoMutex);
+  _runtime = runtime;
+  // Previous properties are leaked rather than freed since other threads may still reference them
+  _deviceInfo.store(nullptr);
+  _generation++;
+}
+
+const TensileDeviceContext::DeviceInfo *TensileDeviceContext::deviceInfo() {
+  auto info = _deviceInfo.load(std::memory_order_acquire);
+  if (info == nullptr) {
+    std::lock_guard<std::mutex> lockGuard(_deviceInfoMutex);
+    info = _deviceInfo.load(std::memory_order_relaxed);
+    if (info == nullptr) {
+      auto newInfo = new DeviceInfo;
+      int numDevices = _runtime->deviceCount();
+      newInfo->_properties.resize(numDevices);
+      for (int i=0; i<numDevices; i++) {
+        _runtime->getProperties(i, &newInfo->_properties[i]);
+      }
+      _deviceInfo.store(newInfo, std::memory_order_release);
+      info = newInfo;
+    }
+  }
+  return info;
+}
+
+int TensileDeviceContext::deviceCount() {
+  return static_cast<int>(deviceInfo()->_properties.size());
+}
+
+int TensileDeviceContext::currentDevice() {
+  if (!_cacheCurrentDevice.load(std::memory_order_relaxed))
+    return _runtime->currentDevice();
+  uint64_t generation = _generation.load(std::memory_order_relaxed);
+  if (cachedDevice._generation != generation) {
+    cachedDevice._deviceId = _runtime->currentDevice();
+    cachedDevice._generation = generation;
+  }
+  return cachedDevice._deviceId;
+}
+
+TensileStatus TensileDeviceContext::setDevice(int deviceId) {
+  TensileStatus status = _runtime->setDevice(deviceId);
+  if (status == tensileStatusSuccess) {
+    cachedDevice._deviceId = deviceId;
+    cachedDevice._generation = _generation.load(std::memory_order_relaxed);
+  } else {
+    invalidateCurrentDevice();
+  }
+  return status;
+}
+
+void TensileDeviceContext::invalidateCurrentDevice() {
+  cachedDevice._generation = 0;
+}
+
+void TensileDeviceContext::setCacheCurrentDevice(bool cacheCurrentDevice) {
+  _generation++;
+  _cacheCurrentDevice = cacheCurrentDevice;
+}
+
+const TensileDeviceProperties &TensileDeviceContext::properties(int deviceId) {
+  return deviceInfo()->_properties[deviceId];
+}
+
+/*******************************************************************************
+ * Set-device hooks
+ ******************************************************************************/
+TensileStatus tensileSetDevice(int deviceId) {
+  return TensileDeviceContext::instance().setDevice(deviceId);
+}
+
+void tensileDeviceChanged() {
+  TensileDeviceContext::instance().invalidateCurrentDevice();
+}
@@ -0,0 +1,207 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#ifndef DEVICE_CONTEXT_H
+#define DEVICE_CONTEXT_H
+
+#include "TensileTypes.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/*******************************************************************************
+ * Device context - current device and device properties for the library
+ *   - The runtime (HIP, OpenCL, or a fake for CPU-only testing) is reached
+ *     through the TensileDeviceRuntime interface.
+ *   - The current device is queried from the runtime on every call by default.
+ *     Applications that change the device of a thread only through
+ *     tensileSetDevice, or that call tensileDeviceChanged after changing it
+ *     directly, can enable a per-thread cache so the GEMM entry points do not
+ *     query the runtime on every call.
+ *   - Device properties are queried once per device and shared by all
+ *     problem types.
+ *   - Kernel launches timed for runtime autotuning go through the
+ *     TensileLaunchTimer interface, which tests can replace.
+ ******************************************************************************/
+
+// Set to 1 to cache the current device of each thread, see above.
+// Can be overridden with TENSILE_CACHE_CURRENT_DEVICE env var.
+#define CACHE_CURRENT_DEVICE 0
+
+struct TensileDeviceProperties {
+  TensileDeviceProperties() : _multiProcessorCount(0), _gcnArch(0) {};
+
+  std::string _name;
+  int         _multiProcessorCount;
+  int         _gcnArch; // 0 if unknown
+};
+
+#if Tensile_RUNTIME_LANGUAGE_OCL
+typedef cl_command_queue TensileStream;
+#else
+typedef hipStream_t TensileStream;
+#endif
+
+class TensileLaunchTimer {
+public:
+  virtual ~TensileLaunchTimer() {};
+
+  // Runs launch, which enqueues work on stream, and returns the duration of that work
+  // in milliseconds. *status is set to the status returned by launch ; the duration is
+  // +inf if it failed. Waits for the stream to finish.
+  virtual double time(TensileStream stream, const std::function<TensileStatus()> &launch,
+                      TensileStatus *status) = 0;
+};
+
+#if Tensile_RUNTIME_LANGUAGE_HIP
+// Times with events recorded on the stream around the launch
+class HipEventLaunchTimer : public TensileLaunchTimer {
+public:
+  double time(TensileStream stream, const std::function<TensileStatus()> &launch,
+              TensileStatus *status);
+};
+#endif
+
+#if Tensile_RUNTIME_LANGUAGE_OCL
+// Host timer around the launch, with the queue drained before and after
+class OclFinishLaunchTimer : public TensileLaunchTimer {
+public:
+  double time(TensileStream stream, const std::function<TensileStatus()> &launch,
+              TensileStatus *status);
+};
+#endif
+
+class TensileDeviceRuntime {
+public:
+  virtual ~TensileDeviceRuntime() {};
+
+  virtual int deviceCount() = 0;
+  virtual int currentDevice() = 0;
+  virtual TensileStatus setDevice(int deviceId) = 0;
+  virtual TensileStatus getProperties(int deviceId, TensileDeviceProperties *props) = 0;
+};
+
+#if Tensile_RUNTIME_LANGUAGE_HIP
+class HipDeviceRuntime : public TensileDeviceRuntime {
+public:
+  int deviceCount();
+  int currentDevice();
+  TensileStatus setDevice(int deviceId);
+  TensileStatus getProperties(int deviceId, TensileDeviceProperties *props);
+};
+#endif
+
+#if Tensile_RUNTIME_LANGUAGE_OCL
+// OpenCL has no current device - the device selected with setDevice is tracked
+// per thread and indexes the GPU devices of the first platform.
+class OclDeviceRuntime : public TensileDeviceRuntime {
+public:
+  int deviceCount();
+  int currentDevice();
+  TensileStatus setDevice(int deviceId);
+  TensileStatus getProperties(int deviceId, TensileDeviceProperties *props);
+
+private:
+  void enumerate();
+
+  std::once_flag            _enumerateOnce;
+  std::vector<cl_device_id> _devices;
+};
+#endif
+
+// In-process runtime with a fixed list of devices, for testing the library
+// without a GPU.
+class FakeDeviceRuntime : public TensileDeviceRuntime {
+public:
+  FakeDeviceRuntime(const std::vector<TensileDeviceProperties> &devices);
+
+  int deviceCount();
+  int currentDevice();
+  TensileStatus setDevice(int deviceId);
+  TensileStatus getProperties(int deviceId, TensileDeviceProperties *props);
+
+  // Number of currentDevice calls that reached this runtime
+  uint64_t currentDeviceQueries() const { return _currentDeviceQueries.load(); };
+
+private:
+  std::vector<TensileDeviceProperties> _devices;
+  std::atomic<uint64_t>                _currentDeviceQueries;
+};
+
+class TensileDeviceContext {
+public:
+  static TensileDeviceContext &instance();
+
+  // Replace the runtime (not owned). Must be called before any solution is
+  // looked up ; drops cached properties and the per-thread current devices.
+  void setRuntime(TensileDeviceRuntime *runtime);
+  TensileDeviceRuntime *runtime() const { return _runtime; };
+
+  int deviceCount();
+
+  // Current device of the calling thread
+  int currentDevice();
+
+  // Set-device hook: changes the device of the calling thread and updates the cache
+  TensileStatus setDevice(int deviceId);
+
+  // Forget the cached current device of the calling thread
+  void invalidateCurrentDevice();
+
+  // Enable or disable the per-thread current device cache ; changing it drops the
+  // current devices cached by every thread
+  void setCacheCurrentDevice(bool cacheCurrentDevice);
+  bool cacheCurrentDevice() const { return _cacheCurrentDevice.load(std::memory_order_relaxed); };
+
+  // Properties of deviceId, queried once for all devices
+  const TensileDeviceProperties &properties(int deviceId);
+
+  // Timer used for autotuning launches. Replace (not owned) before any launch is timed.
+  void setLaunchTimer(TensileLaunchTimer *launchTimer) { _launchTimer = launchTimer; };
+  TensileLaunchTimer *launchTimer() const { return _launchTimer; };
+
+private:
+  TensileDeviceContext(TensileDeviceRuntime *runtime, TensileLaunchTimer *launchTimer);
+
+  struct DeviceInfo {
+    std::vector<TensileDeviceProperties> _properties;
+  };
+  const DeviceInfo *deviceInfo();
+
+  TensileDeviceRuntime           *_runtime;
+  TensileLaunchTimer             *_launchTimer;
+  std::mutex                      _deviceInfoMutex;
+  std::atomic<const DeviceInfo *> _deviceInfo;
+  // Bumped by setRuntime to invalidate the current device cached by every thread
+  std::atomic<uint64_t>           _generation;
+  std::atomic<bool>               _cacheCurrentDevice;
+};
+
+/*******************************************************************************
+ * Set-device hooks for applications
+ ******************************************************************************/
+TensileStatus tensileSetDevice(int deviceId);
+void tensileDeviceChanged();
+
+#endif
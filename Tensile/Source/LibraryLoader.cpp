@@ -0,0 +1,144 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#include "LibraryLoader.h"
+#include "LoadTrace.h"
+#include <cstdio>
+#include <cstdlib>
+#ifdef WIN32
+#include "Windows.h"
+#else
+#include <dlfcn.h>
+#endif
+
+namespace {
+std::atomic<unsigned> librariesLoaded(0);
+
+void splitPath(const char *path, std::vector<std::string> *directories) {
+  std::string searchPath(path);
+  size_t start = 0;
+  while (start <= searchPath.size()) {
+    size_t end = searchPath.find(':', start);
+    if (end == std::string::npos)
+      end = searchPath.size();
+    if (end > start)
+      directories->push_back(searchPath.substr(start, end - start));
+    start = end + 1;
+  }
+}
+
+#ifdef WIN32
+void *openLibrary(const std::string &path) {
+  return LoadLibraryA(path.c_str());
+}
+
+void *findSymbol(void *handle, const std::string &symbol) {
+  return reinterpret_cast<void *>(GetProcAddress(static_cast<HMODULE>(handle), symbol.c_str()));
+}
+#else
+void *openLibrary(const std::string &path) {
+  return dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+}
+
+void *findSymbol(void *handle, const std::string &symbol) {
+  return dlsym(handle, symbol.c_str());
+}
+#endif
+
+// Directory of the library (or executable) holding the stubs, empty if unknown
+std::string stubDirectory() {
+#ifdef WIN32
+  return "";
+#else
+  Dl_info info;
+  if (!dladdr(reinterpret_cast<void *>(&splitPath), &info) || !info.dli_fname)
+    return "";
+  std::string path(info.dli_fname);
+  size_t slash = path.rfind('/');
+  return slash == std::string::npos ? "" : path.substr(0, slash);
+#endif
+}
+}
+
+std::vector<std::string> TensileLibraryLoader::candidatePaths() const {
+#ifdef WIN32
+  std::string fileName = "Tensile_" + std::string(_problemType) + ".dll";
+#else
+  std::string fileName = "libTensile_" + std::string(_problemType) + ".so";
+#endif
+  std::vector<std::string> directories;
+  const char *libraryPath = std::getenv("TENSILE_LIBRARY_PATH");
+  splitPath(libraryPath ? libraryPath : LIBRARY_PATH, &directories);
+  std::string stubs = stubDirectory();
+  if (!stubs.empty())
+    directories.push_back(stubs);
+
+  std::vector<std::string> candidates;
+  for (auto iter = directories.begin(); iter != directories.end(); iter++) {
+    candidates.push_back(*iter + "/" + fileName);
+  }
+  candidates.push_back(fileName); // default search of the dynamic loader
+  return candidates;
+}
+
+const void *TensileLibraryLoader::load() {
+  const char *traceName = TensileLoadTrace::instance().intern("Tensile_" + std::string(_problemType));
+  TensileLoadTrace::lock(_mutex, traceName, -1);
+  std::lock_guard<std::mutex> lockGuard(_mutex, std::adopt_lock);
+  const void *table = _library.load(std::memory_order_acquire);
+  if (table || _failed)
+    return table; // loaded by another thread, or failed before
+
+  TensileLoadTrace::Scope scope(TensileLoadLibraryLoad, traceName, -1);
+  void *handle = nullptr;
+  std::vector<std::string> candidates = candidatePaths();
+  for (auto iter = candidates.begin(); iter != candidates.end() && !handle; iter++) {
+    handle = openLibrary(*iter);
+  }
+  if (!handle) {
+    printf ("warning: library of problem type %s not found\n", _problemType);
+#ifndef WIN32
+    const char *error = dlerror();
+    if (error)
+      printf ("  last error: %s\n", error);
+#endif
+    _failed = true;
+    return nullptr;
+  }
+
+  // The library is never unloaded: solutions and plans of the application point into it
+  typedef const void *(*EntryPoint)();
+  std::string entryName = "tensileLibrary_" + std::string(_problemType);
+  EntryPoint entry = reinterpret_cast<EntryPoint>(findSymbol(handle, entryName));
+  if (!entry) {
+    printf ("warning: library of problem type %s has no %s\n", _problemType, entryName.c_str());
+    _failed = true;
+    return nullptr;
+  }
+  table = entry();
+  librariesLoaded++;
+  _library.store(table, std::memory_order_release);
+  return table;
+}
+
+unsigned TensileLibraryLoader::numLoaded() {
+  return librariesLoaded.load();
+}
@@ -0,0 +1,92 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#ifndef LIBRARY_LOADER_H
+#define LIBRARY_LOADER_H
+
+#include "TensileTypes.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*******************************************************************************
+ * Lazy loading of problem type libraries
+ *   - With TensileCreateLibrary --split-problem-types, the logic, solutions and
+ *     kernels of each problem type are built into their own shared object,
+ *     libTensile_<ProblemType>.so, and the Tensile library only holds stubs
+ *     for the problem type functions. The first call of a stub loads the
+ *     shared object, so applications only pay load time and memory for the
+ *     problem types they use.
+ *   - A problem type library exports one function, tensileLibrary_<ProblemType>,
+ *     which initializes its solution mappers and returns its table of
+ *     functions (TensileLibrary_<ProblemType>, see TensileInternal.h).
+ *   - Libraries are searched in TENSILE_LIBRARY_PATH (directories separated by
+ *     ':'), then next to the library holding the stubs, then by the dynamic
+ *     loader's default search.
+ ******************************************************************************/
+
+// Exports the entry point of a problem type library, which is otherwise built with hidden symbols
+#ifdef WIN32
+#define TENSILE_LIBRARY_EXPORT extern "C" __declspec(dllexport)
+#else
+#define TENSILE_LIBRARY_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+// Directories searched for problem type libraries before the default ones, separated by ':'.
+// Can be overridden with TENSILE_LIBRARY_PATH env var.
+#define LIBRARY_PATH ""
+
+class TensileLibraryLoader {
+public:
+  // Loader of libTensile_<problemType>.so ; the loader only holds the pointer,
+  // so problemType must outlive it. constexpr so loaders at namespace scope are
+  // usable during static initialization.
+  constexpr explicit TensileLibraryLoader(const char *problemType)
+    : _problemType(problemType), _library(nullptr), _mutex(), _failed(false) {};
+
+  // Function table of the library, loading and initializing it on the first call.
+  // Returns nullptr if the library can not be loaded ; a failed load is not retried.
+  const void *library() {
+    const void *table = _library.load(std::memory_order_acquire);
+    return table ? table : load();
+  };
+
+  // Function table if the library is already loaded, else nullptr
+  const void *loaded() const { return _library.load(std::memory_order_acquire); };
+
+  // Number of problem type libraries loaded by the process
+  static unsigned numLoaded();
+
+private:
+  TensileLibraryLoader(const TensileLibraryLoader &);
+  TensileLibraryLoader &operator=(const TensileLibraryLoader &);
+
+  const void *load();
+  std::vector<std::string> candidatePaths() const;
+
+  const char               *_problemType;
+  std::atomic<const void *> _library;
+  std::mutex                _mutex;
+  bool                      _failed;
+};
+
+#endif
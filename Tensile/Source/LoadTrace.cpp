@@ -0,0 +1,268 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#include "LoadTrace.h"
+#include "LookupStats.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+#ifdef WIN32
+__declspec(thread) unsigned loadTraceThreadId = 0;
+#else
+thread_local unsigned loadTraceThreadId = 0;
+#endif
+
+std::atomic<unsigned> nextLoadTraceThreadId(1);
+
+unsigned threadId() {
+  if (loadTraceThreadId == 0)
+    loadTraceThreadId = nextLoadTraceThreadId.fetch_add(1);
+  return loadTraceThreadId;
+}
+
+// deviceId, phase and threadId packed in one word so a slot has fewer fields to tear
+uint64_t packWhere(int deviceId, int phase, unsigned thread) {
+  return (uint64_t(uint32_t(deviceId)) << 32) | (uint64_t(phase & 0xff) << 24) | (thread & 0xffffff);
+}
+
+void unpackWhere(uint64_t where, TensileLoadEvent *event) {
+  event->_deviceId = int(uint32_t(where >> 32));
+  event->_phase = int((where >> 24) & 0xff);
+  event->_threadId = unsigned(where & 0xffffff);
+}
+
+std::string atExitPath;
+
+void writeChromeAtExit() {
+  tensileLoadTraceWriteChrome(atExitPath.c_str());
+}
+
+void writeJsonString(FILE *f, const char *str) {
+  fputc('"', f);
+  for (; *str; str++) {
+    if (*str == '"' || *str == '\\')
+      fputc('\\', f);
+    fputc(*str, f);
+  }
+  fputc('"', f);
+}
+
+std::vector<TensileLoadEvent> readAll() {
+  std::vector<TensileLoadEvent> events(LOAD_TRACE_CAPACITY);
+  events.resize(TensileLoadTrace::instance().read(events.data(), unsigned(events.size())));
+  return events;
+}
+}
+
+/*******************************************************************************
+ * TensileLoadTrace
+ ******************************************************************************/
+TensileLoadTrace &TensileLoadTrace::instance() {
+  // Leaked: loads may still be traced while static destructors run
+  static TensileLoadTrace *trace = new TensileLoadTrace;
+  return *trace;
+}
+
+TensileLoadTrace::TensileLoadTrace()
+  : _slots(new Slot[LOAD_TRACE_CAPACITY]), _next(0), _resetAt(0)
+{
+  static_assert((LOAD_TRACE_CAPACITY & (LOAD_TRACE_CAPACITY-1)) == 0,
+                "LOAD_TRACE_CAPACITY must be a power of 2");
+  for (size_t i=0; i<LOAD_TRACE_CAPACITY; i++) {
+    _slots[i]._sequence.store(0, std::memory_order_relaxed);
+  }
+  const char *path = getenv("TENSILE_LOAD_TRACE_PATH");
+  if (path && *path) {
+    atExitPath = path;
+    atexit(writeChromeAtExit);
+  }
+}
+
+const char *TensileLoadTrace::intern(const std::string &name) {
+  std::lock_guard<std::mutex> lockGuard(_internMutex);
+  return _names.insert(name).first->c_str();
+}
+
+void TensileLoadTrace::record(TensileLoadPhase phase, const char *internedName, int deviceId,
+                              uint64_t startNs, uint64_t endNs) {
+  uint64_t index = _next.fetch_add(1, std::memory_order_relaxed);
+  Slot &slot = _slots[index & (LOAD_TRACE_CAPACITY-1)];
+  slot._sequence.store(2*index+1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot._name.store(internedName, std::memory_order_relaxed);
+  slot._startNs.store(startNs, std::memory_order_relaxed);
+  slot._durationNs.store(endNs > startNs ? endNs - startNs : 0, std::memory_order_relaxed);
+  slot._where.store(packWhere(deviceId, phase, threadId()), std::memory_order_relaxed);
+  slot._sequence.store(2*index+2, std::memory_order_release);
+}
+
+unsigned TensileLoadTrace::read(TensileLoadEvent *events, unsigned maxEvents) const {
+  uint64_t end = _next.load(std::memory_order_acquire);
+  uint64_t begin = std::max<uint64_t>(_resetAt.load(std::memory_order_relaxed),
+                                      end > LOAD_TRACE_CAPACITY ? end - LOAD_TRACE_CAPACITY : 0);
+  unsigned count = 0;
+  for (uint64_t index=begin; index<end && count<maxEvents; index++) {
+    const Slot &slot = _slots[index & (LOAD_TRACE_CAPACITY-1)];
+    // Skip events still being written, or overwritten since end was read
+    if (slot._sequence.load(std::memory_order_acquire) != 2*index+2)
+      continue;
+    TensileLoadEvent event;
+    event._kernelName = slot._name.load(std::memory_order_relaxed);
+    event._startNs = slot._startNs.load(std::memory_order_relaxed);
+    event._durationNs = slot._durationNs.load(std::memory_order_relaxed);
+    unpackWhere(slot._where.load(std::memory_order_relaxed), &event);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot._sequence.load(std::memory_order_relaxed) != 2*index+2)
+      continue;
+    events[count++] = event;
+  }
+  return count;
+}
+
+void TensileLoadTrace::reset() {
+  _resetAt.store(_next.load());
+}
+
+void TensileLoadTrace::lock(std::mutex &mutex, const char *internedName, int deviceId) {
+  if (mutex.try_lock())
+    return;
+  Scope wait(TensileLoadLockWait, internedName, deviceId);
+  mutex.lock();
+}
+
+const char *TensileLoadTrace::phaseName(int phase) {
+  static const char *names[TensileLoadNumPhases] = {
+    "lockWait", "fileRead", "moduleLoad", "compile", "functionResolve", "libraryLoad"};
+  return phase >= 0 && phase < TensileLoadNumPhases ? names[phase] : "unknown";
+}
+
+TensileLoadTrace::Scope::Scope(TensileLoadPhase phase, const char *internedName, int deviceId)
+  : _phase(phase), _name(internedName), _deviceId(deviceId), _startNs(TensileLookupStats::now())
+{
+}
+
+TensileLoadTrace::Scope::~Scope() {
+  TensileLoadTrace::instance().record(_phase, _name, _deviceId, _startNs, TensileLookupStats::now());
+}
+
+/*******************************************************************************
+ * Load trace API
+ ******************************************************************************/
+unsigned tensileLoadTraceCount() {
+  return unsigned(std::min<uint64_t>(TensileLoadTrace::instance().recorded(), LOAD_TRACE_CAPACITY));
+}
+
+unsigned tensileLoadTraceRead(TensileLoadEvent *events, unsigned maxEvents) {
+  return TensileLoadTrace::instance().read(events, maxEvents);
+}
+
+void tensileLoadTraceReset() {
+  TensileLoadTrace::instance().reset();
+}
+
+// Layout: {"traceEvents": [{"name", "cat": phase, "ph": "X", "ts", "dur", "pid", "tid",
+//                           "args": {"device"}}, ...]} ; times in microseconds
+TensileStatus tensileLoadTraceWriteChrome(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return tensileStatusFailure;
+
+  std::vector<TensileLoadEvent> events = readAll();
+  fprintf(f, "{\"traceEvents\": [");
+  for (size_t i=0; i<events.size(); i++) {
+    const TensileLoadEvent &event = events[i];
+    fprintf(f, "%s\n  {\"name\": ", i ? "," : "");
+    writeJsonString(f, event._kernelName);
+    fprintf(f, ", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 0, \"tid\": %u, "
+               "\"args\": {\"device\": %d}}",
+            TensileLoadTrace::phaseName(event._phase), event._startNs * 1e-3, event._durationNs * 1e-3,
+            event._threadId, event._deviceId);
+  }
+  fprintf(f, "\n], \"displayTimeUnit\": \"ms\"}\n");
+  return fclose(f) == 0 ? tensileStatusSuccess : tensileStatusFailure;
+}
+
+// Layout: {"recorded", "dropped", "kernels": [{"name", "totalNs",
+//          "phases": {phase: {"count", "totalNs", "maxNs"}}}, ...]}
+// Kernels are sorted by decreasing totalNs ; phases never seen are omitted.
+TensileStatus tensileLoadTraceWriteJson(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return tensileStatusFailure;
+
+  struct PhaseTotal {
+    uint64_t count = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+  };
+  struct KernelTotal {
+    const char *name;
+    uint64_t    totalNs = 0;
+    PhaseTotal  phases[TensileLoadNumPhases];
+  };
+
+  std::vector<TensileLoadEvent> events = readAll();
+  std::map<const char *, KernelTotal> byName; // names are interned
+  for (size_t i=0; i<events.size(); i++) {
+    const TensileLoadEvent &event = events[i];
+    if (event._phase < 0 || event._phase >= TensileLoadNumPhases)
+      continue;
+    KernelTotal &kernel = byName[event._kernelName];
+    kernel.name = event._kernelName;
+    kernel.totalNs += event._durationNs;
+    PhaseTotal &phase = kernel.phases[event._phase];
+    phase.count++;
+    phase.totalNs += event._durationNs;
+    phase.maxNs = std::max(phase.maxNs, event._durationNs);
+  }
+  std::vector<const KernelTotal *> kernels;
+  for (auto &entry : byName) {
+    kernels.push_back(&entry.second);
+  }
+  std::stable_sort(kernels.begin(), kernels.end(),
+                   [](const KernelTotal *a, const KernelTotal *b) { return a->totalNs > b->totalNs; });
+
+  uint64_t recorded = TensileLoadTrace::instance().recorded();
+  fprintf(f, "{\"recorded\": %llu, \"dropped\": %llu, \"kernels\": [",
+          (unsigned long long)recorded, (unsigned long long)(recorded - events.size()));
+  for (size_t k=0; k<kernels.size(); k++) {
+    fprintf(f, "%s\n  {\"name\": ", k ? "," : "");
+    writeJsonString(f, kernels[k]->name);
+    fprintf(f, ", \"totalNs\": %llu, \"phases\": {", (unsigned long long)kernels[k]->totalNs);
+    bool firstPhase = true;
+    for (int p=0; p<TensileLoadNumPhases; p++) {
+      const PhaseTotal &phase = kernels[k]->phases[p];
+      if (!phase.count)
+        continue;
+      fprintf(f, "%s\"%s\": {\"count\": %llu, \"totalNs\": %llu, \"maxNs\": %llu}",
+              firstPhase ? "" : ", ", TensileLoadTrace::phaseName(p), (unsigned long long)phase.count,
+              (unsigned long long)phase.totalNs, (unsigned long long)phase.maxNs);
+      firstPhase = false;
+    }
+    fprintf(f, "}}");
+  }
+  fprintf(f, "\n]}\n");
+  return fclose(f) == 0 ? tensileStatusSuccess : tensileStatusFailure;
+}
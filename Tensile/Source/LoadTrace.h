@@ -0,0 +1,137 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+
+#ifndef LOAD_TRACE_H
+#define LOAD_TRACE_H
+
+#include "TensileTypes.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <stdint.h>
+
+/*******************************************************************************
+ * Kernel load tracing
+ *   - Loading a kernel on first use is timed phase by phase (lock waits, code
+ *     object file reads, module loads or program builds, function resolution)
+ *     by SolutionLock::getFunction, the module registry and the OpenCL
+ *     program cache, so cold start cost can be attributed to kernels.
+ *   - Loads of problem type libraries (see LibraryLoader.h) are recorded the
+ *     same way, with the library name in place of a kernel name.
+ *   - Events go to a fixed size ring buffer written without locks ; the
+ *     oldest events are overwritten once it is full. Kernel names are
+ *     interned once per load.
+ *   - Applications read the events through tensileLoadTrace*, as events or
+ *     as Chrome trace / per-kernel JSON files ; setting TENSILE_LOAD_TRACE_PATH
+ *     writes the Chrome trace at exit.
+ ******************************************************************************/
+
+// Events kept by the ring buffer, a power of 2
+#define LOAD_TRACE_CAPACITY 4096
+
+enum TensileLoadPhase {
+  TensileLoadLockWait,        // waiting for a load of the same kernel or module by another thread
+  TensileLoadFileRead,        // finding and mapping a code object file, or a cached program binary
+  TensileLoadModuleLoad,      // hipModuleLoadData, or building a program from its cached binary
+  TensileLoadCompile,         // building an OpenCL program from source
+  TensileLoadFunctionResolve, // hipModuleGetFunction, or creating the OpenCL kernel
+  TensileLoadLibraryLoad,     // loading a problem type library, see LibraryLoader.h
+  TensileLoadNumPhases
+};
+
+struct TensileLoadEvent {
+  const char *_kernelName; // valid for the life of the process
+  uint64_t    _startNs;    // steady clock, as TensileLookupStats::now
+  uint64_t    _durationNs;
+  int         _deviceId;   // -1 for OpenCL loads
+  int         _phase;      // TensileLoadPhase
+  unsigned    _threadId;   // small number identifying the host thread
+};
+
+class TensileLoadTrace {
+public:
+  static TensileLoadTrace &instance();
+
+  // Name stored in events: a copy that lives as long as the process
+  const char *intern(const std::string &name);
+
+  void record(TensileLoadPhase phase, const char *internedName, int deviceId,
+              uint64_t startNs, uint64_t endNs);
+
+  // Times its lifetime as one event
+  class Scope {
+  public:
+    Scope(TensileLoadPhase phase, const char *internedName, int deviceId);
+    ~Scope();
+  private:
+    TensileLoadPhase _phase;
+    const char      *_name;
+    int              _deviceId;
+    uint64_t         _startNs;
+  };
+
+  // Locks mutex ; a wait for another thread is recorded as a TensileLoadLockWait event
+  static void lock(std::mutex &mutex, const char *internedName, int deviceId);
+
+  // Copies the events still in the buffer, oldest first ; returns the number copied
+  unsigned read(TensileLoadEvent *events, unsigned maxEvents) const;
+  // Events recorded since the last reset, including overwritten ones
+  uint64_t recorded() const { return _next.load() - _resetAt.load(); };
+  void reset();
+
+  static const char *phaseName(int phase);
+
+private:
+  TensileLoadTrace();
+
+  // One event, written under a sequence number so readers can detect slots being
+  // rewritten. _sequence is 2*index+2 once event index is complete, odd while written.
+  struct Slot {
+    std::atomic<uint64_t>     _sequence;
+    std::atomic<const char *> _name;
+    std::atomic<uint64_t>     _startNs;
+    std::atomic<uint64_t>     _durationNs;
+    std::atomic<uint64_t>     _where; // deviceId, phase and threadId
+  };
+
+  std::unique_ptr<Slot[]>          _slots;
+  std::atomic<uint64_t>            _next;    // index of the next event
+  std::atomic<uint64_t>            _resetAt; // events before this index were reset
+
+  std::mutex                       _internMutex;
+  std::unordered_set<std::string>  _names;
+};
+
+/*******************************************************************************
+ * Load trace API
+ ******************************************************************************/
+unsigned tensileLoadTraceCount(); // events in the buffer
+unsigned tensileLoadTraceRead(TensileLoadEvent *events, unsigned maxEvents);
+void tensileLoadTraceReset();
+// Chrome trace event format (chrome://tracing, Perfetto): one complete event per phase
+TensileStatus tensileLoadTraceWriteChrome(const char *path);
+// Per-kernel totals of each phase, most expensive kernels first
+TensileStatus tensileLoadTraceWriteJson(const char *path);
+
+#endif
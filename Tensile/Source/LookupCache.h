@@ -0,0 +1,271 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+/*******************************************************************************
+ * Bounded cache for problem->solution lookups
+ *   - Keys are spread over independent shards, each with its own lock, so
+ *     concurrent hits on different shapes do not serialize on one mutex.
+ *   - Each shard holds at most capacity/NumShards entries and evicts with the
+ *     CLOCK policy: a hit only sets a reference bit (no list reordering), the
+ *     clock hand clears bits and evicts the first unreferenced entry.
+ *   - capacity==0 means unbounded (no eviction).
+ *   - Each entry has a Retention: Preferred entries get PreferredChances turns
+ *     of the clock hand after a hit instead of one, Pinned entries are never
+ *     evicted. An insert does not replace an entry of higher retention; a
+ *     shard whose entries are all pinned grows past its capacity.
+ * KeyType must provide hash() and operator==.
+ ******************************************************************************/
+template <class KeyType, class ValueType>
+class LookupCache {
+public:
+  enum Retention {Normal, Preferred, Pinned};
+
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t   size;
+    size_t   preferred;
+    size_t   pinned;
+    size_t   capacity;
+  };
+
+  LookupCache(size_t capacity=0)
+    : _hits(0), _misses(0), _evictions(0)
+  {
+    setCapacity(capacity);
+  }
+
+  // Must be called before the cache is shared between threads
+  void setCapacity(size_t capacity) {
+    _capacity = capacity;
+    size_t perShard = (capacity + NumShards - 1) / NumShards;
+    for (int i=0; i<NumShards; i++) {
+      _shards[i]._capacity = perShard;
+    }
+  }
+
+  // Returns true and sets *value if key is present
+  bool find(const KeyType &key, ValueType *value) {
+    Shard &shard = shardFor(key);
+    std::lock_guard<std::mutex> lockGuard(shard._mutex);
+    auto fiter = shard._index.find(key);
+    if (fiter == shard._index.end()) {
+      _misses.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    fiter->second.reference();
+    *value = fiter->second._value;
+    _hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Looks up keys[0,n): sets found[i] and, if found, values[i]. Each shard is locked
+  // at most once for the whole batch. Returns the number of keys found.
+  size_t findBatch(const KeyType *keys, size_t n, ValueType *values, bool *found) {
+    std::vector<unsigned char> shardIdx(n);
+    unsigned int usedShards = 0; // bit per shard with at least one key
+    for (size_t i=0; i<n; i++) {
+      shardIdx[i] = static_cast<unsigned char>(shardIndex(keys[i]));
+      usedShards |= 1u << shardIdx[i];
+      found[i] = false;
+    }
+
+    size_t hits = 0;
+    for (int si=0; si<NumShards; si++) {
+      if (!(usedShards & (1u << si)))
+        continue;
+      Shard &shard = _shards[si];
+      std::lock_guard<std::mutex> lockGuard(shard._mutex);
+      for (size_t i=0; i<n; i++) {
+        if (shardIdx[i] != si)
+          continue;
+        auto fiter = shard._index.find(keys[i]);
+        if (fiter != shard._index.end()) {
+          fiter->second.reference();
+          values[i] = fiter->second._value;
+          found[i] = true;
+          hits++;
+        }
+      }
+    }
+    _hits.fetch_add(hits, std::memory_order_relaxed);
+    _misses.fetch_add(n - hits, std::memory_order_relaxed);
+    return hits;
+  }
+
+  // Insert or overwrite key. May evict another entry from the same shard.
+  // An entry is only overwritten by an insert of the same or a higher retention.
+  void insert(const KeyType &key, const ValueType &value, Retention retention=Normal) {
+    Shard &shard = shardFor(key);
+    std::lock_guard<std::mutex> lockGuard(shard._mutex);
+    auto fiter = shard._index.find(key);
+    if (fiter != shard._index.end()) {
+      if (retention >= fiter->second._retention) {
+        fiter->second._value = value;
+        fiter->second._retention = retention;
+      }
+      fiter->second.reference();
+      return;
+    }
+
+    if (shard._capacity == 0) {
+      shard._index.insert({key, Entry(value, retention)});
+    } else {
+      size_t slot = NoSlot;
+      if (shard._clock.size() >= shard._capacity)
+        slot = evict(shard);
+      auto iiter = shard._index.insert({key, Entry(value, retention)}).first;
+      if (slot == NoSlot)
+        shard._clock.push_back(&*iiter);
+      else
+        shard._clock[slot] = &*iiter;
+    }
+  }
+
+  // Removes every entry, or only the unpinned ones if keepPinned
+  void clear(bool keepPinned=false) {
+    for (int i=0; i<NumShards; i++) {
+      Shard &shard = _shards[i];
+      std::lock_guard<std::mutex> lockGuard(shard._mutex);
+      for (auto iter = shard._index.begin(); iter != shard._index.end(); ) {
+        if (keepPinned && iter->second._retention == Pinned)
+          iter++;
+        else
+          iter = shard._index.erase(iter);
+      }
+      shard._clock.clear();
+      shard._hand = 0;
+      if (shard._capacity != 0) {
+        for (auto iter = shard._index.begin(); iter != shard._index.end(); iter++) {
+          shard._clock.push_back(&*iter);
+        }
+      }
+    }
+  }
+
+  // Calls f(key, value, retention) for every cached entry, taking each shard lock in turn
+  template <class Function>
+  void forEach(Function f) const {
+    for (int i=0; i<NumShards; i++) {
+      std::lock_guard<std::mutex> lockGuard(_shards[i]._mutex);
+      for (auto iter = _shards[i]._index.begin(); iter != _shards[i]._index.end(); iter++) {
+        f(iter->first, iter->second._value, iter->second._retention);
+      }
+    }
+  }
+
+  Stats stats() const {
+    Stats s;
+    s.hits      = _hits.load(std::memory_order_relaxed);
+    s.misses    = _misses.load(std::memory_order_relaxed);
+    s.evictions = _evictions.load(std::memory_order_relaxed);
+    s.capacity  = _capacity;
+    s.size      = 0;
+    s.preferred = 0;
+    s.pinned    = 0;
+    for (int i=0; i<NumShards; i++) {
+      std::lock_guard<std::mutex> lockGuard(_shards[i]._mutex);
+      s.size += _shards[i]._index.size();
+      for (auto iter = _shards[i]._index.begin(); iter != _shards[i]._index.end(); iter++) {
+        s.preferred += iter->second._retention == Preferred;
+        s.pinned    += iter->second._retention == Pinned;
+      }
+    }
+    return s;
+  }
+
+private:
+  static const int NumShards = 16;
+  static const size_t NoSlot = ~size_t(0);
+  static const unsigned char PreferredChances = 4;
+
+  struct Entry {
+    Entry(const ValueType &value, Retention retention)
+      : _value(value), _chances(retention == Preferred ? PreferredChances : 0),
+        _retention(retention) {};
+    void reference() { _chances = _retention == Preferred ? PreferredChances : 1; };
+    ValueType     _value;
+    unsigned char _chances; // CLOCK reference count, reset on every hit
+    Retention     _retention;
+  };
+
+  struct KeyHash {
+    size_t operator() (const KeyType &key) const { return key.hash(); }
+  };
+
+  typedef std::unordered_map<KeyType, Entry, KeyHash> IndexMap;
+
+  struct Shard {
+    Shard() : _capacity(0), _hand(0) {};
+    mutable std::mutex _mutex;
+    IndexMap           _index;
+    // Clock ring - unordered_map nodes are stable so we can point at them directly
+    std::vector<typename IndexMap::value_type *> _clock;
+    size_t             _capacity;
+    size_t             _hand;
+  };
+
+  static int shardIndex(const KeyType &key) {
+    size_t h = key.hash();
+    return static_cast<int>((h ^ (h >> 17)) % NumShards);
+  }
+
+  Shard &shardFor(const KeyType &key) {
+    return _shards[shardIndex(key)];
+  }
+
+  // Advance the clock hand until an unreferenced, unpinned entry is found, erase it and
+  // return its now-free slot. Called with the shard lock held and the shard full.
+  // Returns NoSlot if every entry is pinned.
+  size_t evict(Shard &shard) {
+    // Enough turns to use up the chances of a preferred entry
+    for (size_t step=0; step<(PreferredChances+1)*shard._clock.size(); step++) {
+      auto victim = shard._clock[shard._hand];
+      size_t slot = shard._hand;
+      shard._hand = (shard._hand + 1) % shard._clock.size();
+      if (victim->second._retention == Pinned) {
+        continue;
+      } else if (victim->second._chances) {
+        victim->second._chances--; // second chance
+      } else {
+        shard._index.erase(shard._index.find(victim->first));
+        _evictions.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+      }
+    }
+    return NoSlot;
+  }
+
+  size_t                _capacity;
+  Shard                 _shards[NumShards];
+  std::atomic<uint64_t> _hits;
+  std::atomic<uint64_t> _misses;
+  std::atomic<uint64_t> _evictions;
+};
@@ -0,0 +1,277 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#include "LookupStats.h"
+#include "SolutionHelper.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+#ifdef WIN32
+__declspec(thread) int lookupStatsShard = -1;
+#else
+thread_local int lookupStatsShard = -1;
+#endif
+
+std::atomic<unsigned> nextLookupStatsShard(0);
+
+void writeJsonAtExit();
+
+// Registered statistics of every materialized mapper. Never destroyed, so mappers
+// that are destroyed after the atexit dump can still unregister.
+struct LookupStatsRegistry {
+  static LookupStatsRegistry &instance() {
+    static LookupStatsRegistry *registry = new LookupStatsRegistry;
+    return *registry;
+  }
+
+  void add(TensileLookupStats *stats) {
+    std::lock_guard<std::mutex> lockGuard(_mutex);
+    if (!_atExitRegistered) {
+      _atExitRegistered = true;
+      const char *path = getenv("TENSILE_LOOKUP_STATS_PATH");
+      if (path) {
+        _atExitPath = path;
+        atexit(writeJsonAtExit);
+      }
+    }
+    _stats.push_back(stats);
+  }
+
+  void remove(TensileLookupStats *stats) {
+    std::lock_guard<std::mutex> lockGuard(_mutex);
+    _stats.erase(std::remove(_stats.begin(), _stats.end(), stats), _stats.end());
+  }
+
+  std::mutex                        _mutex;
+  std::vector<TensileLookupStats *> _stats;
+  bool                              _atExitRegistered = false;
+  std::string                       _atExitPath;
+};
+
+const char *counterName(int counter) {
+  static const char *names[TensileLookupNumCounters] = {
+    "cacheHits", "cacheMisses", "exactHits", "canonicalHits", "nearestMatches", "notFound"};
+  return names[counter];
+}
+
+const char *pathName(int path) {
+  static const char *names[TensileLookupNumPaths] = {
+    "exact", "canonical", "fixedSolution", "pickNone", "random", "ratio",
+    "euclidean", "manhattan", "rangeLogic", "performanceModel"};
+  return names[path];
+}
+
+void writeJsonString(FILE *f, const char *str) {
+  fputc('"', f);
+  for (; *str; str++) {
+    if (*str == '"' || *str == '\\')
+      fputc('\\', f);
+    fputc(*str, f);
+  }
+  fputc('"', f);
+}
+
+void writeJsonAtExit() {
+  LookupStatsRegistry &registry = LookupStatsRegistry::instance();
+  tensileLookupStatsWriteJson(registry._atExitPath.c_str());
+}
+}
+
+/*******************************************************************************
+ * TensileLookupStats
+ ******************************************************************************/
+TensileLookupStats::TensileLookupStats(const char *name, const SolutionInfo *solutionInfo, size_t numSolutions)
+  : _name(name), _solutionInfo(solutionInfo), _numSolutions(numSolutions)
+{
+  for (int s=0; s<NumShards; s++) {
+    _shards[s]._selections.reset(new std::atomic<uint64_t>[numSolutions]);
+  }
+  reset();
+  LookupStatsRegistry::instance().add(this);
+}
+
+TensileLookupStats::~TensileLookupStats() {
+  LookupStatsRegistry::instance().remove(this);
+}
+
+int TensileLookupStats::threadShard() {
+  if (lookupStatsShard < 0)
+    lookupStatsShard = nextLookupStatsShard.fetch_add(1) % NumShards;
+  return lookupStatsShard;
+}
+
+TensileLookupPath TensileLookupStats::pathForAlgo(int algo) {
+  if (algo >= 0)
+    return TensileLookupPathFixedSolution;
+  int path = TensileLookupPathPickNone + (-1 - algo);
+  // Unknown algorithms fall back to the ratio distance, see findNearestMatchWithAlg
+  return path < TensileLookupNumPaths ? TensileLookupPath(path) : TensileLookupPathRatio;
+}
+
+uint64_t TensileLookupStats::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TensileLookupStats::snapshot(TensileLookupStatsSnapshot *snapshot,
+                                  uint64_t *solutionSelections, unsigned maxSolutions) const {
+  snapshot->_name = _name;
+  snapshot->_numSolutions = unsigned(_numSolutions);
+  for (int c=0; c<TensileLookupNumCounters; c++) {
+    snapshot->_counters[c] = 0;
+  }
+  for (int p=0; p<TensileLookupNumPaths; p++) {
+    for (int b=0; b<TENSILE_LOOKUP_LATENCY_BUCKETS; b++) {
+      snapshot->_latency[p][b] = 0;
+    }
+  }
+  size_t numSelections = solutionSelections ? std::min<size_t>(maxSolutions, _numSolutions) : 0;
+  for (size_t i=0; i<numSelections; i++) {
+    solutionSelections[i] = 0;
+  }
+
+  for (int s=0; s<NumShards; s++) {
+    const Shard &shard = _shards[s];
+    for (int c=0; c<TensileLookupNumCounters; c++) {
+      snapshot->_counters[c] += shard._counters[c].load(std::memory_order_relaxed);
+    }
+    for (int p=0; p<TensileLookupNumPaths; p++) {
+      for (int b=0; b<TENSILE_LOOKUP_LATENCY_BUCKETS; b++) {
+        snapshot->_latency[p][b] += shard._latency[p][b].load(std::memory_order_relaxed);
+      }
+    }
+    for (size_t i=0; i<numSelections; i++) {
+      solutionSelections[i] += shard._selections[i].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void TensileLookupStats::reset() {
+  for (int s=0; s<NumShards; s++) {
+    Shard &shard = _shards[s];
+    for (int c=0; c<TensileLookupNumCounters; c++) {
+      shard._counters[c].store(0, std::memory_order_relaxed);
+    }
+    for (int p=0; p<TensileLookupNumPaths; p++) {
+      for (int b=0; b<TENSILE_LOOKUP_LATENCY_BUCKETS; b++) {
+        shard._latency[p][b].store(0, std::memory_order_relaxed);
+      }
+    }
+    for (size_t i=0; i<_numSolutions; i++) {
+      shard._selections[i].store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+/*******************************************************************************
+ * Lookup statistics API
+ ******************************************************************************/
+unsigned tensileLookupStatsCount() {
+  LookupStatsRegistry &registry = LookupStatsRegistry::instance();
+  std::lock_guard<std::mutex> lockGuard(registry._mutex);
+  return unsigned(registry._stats.size());
+}
+
+TensileStatus tensileLookupStatsSnapshot(unsigned mapperIdx, TensileLookupStatsSnapshot *snapshot,
+                                         uint64_t *solutionSelections, unsigned maxSolutions) {
+  LookupStatsRegistry &registry = LookupStatsRegistry::instance();
+  std::lock_guard<std::mutex> lockGuard(registry._mutex);
+  if (mapperIdx >= registry._stats.size())
+    return tensileStatusFailure;
+  registry._stats[mapperIdx]->snapshot(snapshot, solutionSelections, maxSolutions);
+  return tensileStatusSuccess;
+}
+
+void tensileLookupStatsReset() {
+  LookupStatsRegistry &registry = LookupStatsRegistry::instance();
+  std::lock_guard<std::mutex> lockGuard(registry._mutex);
+  for (size_t i=0; i<registry._stats.size(); i++) {
+    registry._stats[i]->reset();
+  }
+}
+
+// Layout: {"mappers": [{"name", "counters": {...}, "latencyNs": {path: [[bucketStartNs, count], ...]},
+//                      "selections": [{"solutionIdx", "name", "count"}, ...]}]}
+// Paths and solutions that were never used are omitted.
+TensileStatus tensileLookupStatsWriteJson(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return tensileStatusFailure;
+
+  LookupStatsRegistry &registry = LookupStatsRegistry::instance();
+  std::lock_guard<std::mutex> lockGuard(registry._mutex);
+  fprintf(f, "{\"mappers\": [");
+  for (size_t m=0; m<registry._stats.size(); m++) {
+    const TensileLookupStats &stats = *registry._stats[m];
+    TensileLookupStatsSnapshot snapshot;
+    std::vector<uint64_t> selections(stats.numSolutions());
+    stats.snapshot(&snapshot, selections.data(), unsigned(selections.size()));
+
+    fprintf(f, "%s\n  {\"name\": ", m ? "," : "");
+    writeJsonString(f, snapshot._name);
+    fprintf(f, ",\n   \"counters\": {");
+    for (int c=0; c<TensileLookupNumCounters; c++) {
+      fprintf(f, "%s\"%s\": %llu", c ? ", " : "", counterName(c),
+              (unsigned long long)snapshot._counters[c]);
+    }
+
+    fprintf(f, "},\n   \"latencyNs\": {");
+    bool firstPath = true;
+    for (int p=0; p<TensileLookupNumPaths; p++) {
+      bool used = false;
+      for (int b=0; b<TENSILE_LOOKUP_LATENCY_BUCKETS; b++) {
+        used |= snapshot._latency[p][b] != 0;
+      }
+      if (!used)
+        continue;
+      fprintf(f, "%s\"%s\": [", firstPath ? "" : ", ", pathName(p));
+      bool firstBucket = true;
+      for (int b=0; b<TENSILE_LOOKUP_LATENCY_BUCKETS; b++) {
+        if (snapshot._latency[p][b]) {
+          fprintf(f, "%s[%llu, %llu]", firstBucket ? "" : ", ", 1ull << b,
+                  (unsigned long long)snapshot._latency[p][b]);
+          firstBucket = false;
+        }
+      }
+      fprintf(f, "]");
+      firstPath = false;
+    }
+
+    fprintf(f, "},\n   \"selections\": [");
+    bool firstSolution = true;
+    for (size_t i=0; i<selections.size(); i++) {
+      if (selections[i]) {
+        fprintf(f, "%s{\"solutionIdx\": %zu, \"name\": ", firstSolution ? "" : ", ", i);
+        writeJsonString(f, stats.solutionInfo()[i]._name);
+        fprintf(f, ", \"count\": %llu}", (unsigned long long)selections[i]);
+        firstSolution = false;
+      }
+    }
+    fprintf(f, "]}");
+  }
+  fprintf(f, "\n]}\n");
+  return fclose(f) == 0 ? tensileStatusSuccess : tensileStatusFailure;
+}
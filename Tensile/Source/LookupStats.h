@@ -0,0 +1,148 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#ifndef LOOKUP_STATS_H
+#define LOOKUP_STATS_H
+
+#include "TensileTypes.h"
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+/*******************************************************************************
+ * Lookup instrumentation for the SolutionMapper
+ *   - Every materialized mapper counts cache hits and misses, exact-table hits,
+ *     nearest-match searches and the solutions it selects, and keeps a latency
+ *     histogram of its cache misses for each lookup path.
+ *   - Counters are relaxed atomics spread over per-thread shards, so they are
+ *     cheap enough to stay enabled and threads do not share cache lines.
+ *   - Applications read the counters through tensileLookupStats*; setting
+ *     TENSILE_LOOKUP_STATS_PATH writes all of them as JSON at exit.
+ ******************************************************************************/
+
+enum TensileLookupCounter {
+  TensileLookupCacheHits,
+  TensileLookupCacheMisses,
+  TensileLookupExactHits,      // cache misses found in the exact table
+  TensileLookupCanonicalHits,  // cache misses served by a canonical bucket entry
+  TensileLookupNearestMatches, // cache misses resolved by the find algorithm
+  TensileLookupNotFound,       // lookups without a valid solution
+  TensileLookupNumCounters
+};
+
+// Path that resolved a cache miss. The find algorithm paths follow the order of
+// SolutionMapperRuntime::Algo (PickNone=-1 ... PerformanceModel=-7).
+enum TensileLookupPath {
+  TensileLookupPathExact,
+  TensileLookupPathCanonical,
+  TensileLookupPathFixedSolution, // TENSILE_FIND_ALG names one solution
+  TensileLookupPathPickNone,
+  TensileLookupPathRandom,
+  TensileLookupPathRatio,
+  TensileLookupPathEuclidean,
+  TensileLookupPathManhattan,
+  TensileLookupPathRangeLogic,
+  TensileLookupPathPerformanceModel,
+  TensileLookupNumPaths
+};
+
+// Latency bucket b counts cache misses that took [2^b, 2^(b+1)) ns
+#define TENSILE_LOOKUP_LATENCY_BUCKETS 32
+
+struct TensileLookupStatsSnapshot {
+  const char *_name; // mapper name, valid while the library is loaded
+  uint64_t    _counters[TensileLookupNumCounters];
+  uint64_t    _latency[TensileLookupNumPaths][TENSILE_LOOKUP_LATENCY_BUCKETS];
+  unsigned    _numSolutions;
+};
+
+struct SolutionInfo;
+
+class TensileLookupStats {
+public:
+  // Registers the statistics for tensileLookupStats* until destroyed
+  TensileLookupStats(const char *name, const SolutionInfo *solutionInfo, size_t numSolutions);
+  ~TensileLookupStats();
+
+  void count(TensileLookupCounter counter, uint64_t n=1) {
+    shard()._counters[counter].fetch_add(n, std::memory_order_relaxed);
+  }
+
+  void countSelection(int solutionIdx) {
+    if (solutionIdx >= 0)
+      shard()._selections[solutionIdx].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void recordLatency(TensileLookupPath path, uint64_t ns) {
+    int bucket = 0;
+    while (bucket < TENSILE_LOOKUP_LATENCY_BUCKETS-1 && (ns >> (bucket+1)))
+      bucket++;
+    shard()._latency[path][bucket].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static TensileLookupPath pathForAlgo(int algo);
+
+  // Monotonic time in ns for recordLatency
+  static uint64_t now();
+
+  // Sums the shards ; solutionSelections (if not null) receives the first maxSolutions counts
+  void snapshot(TensileLookupStatsSnapshot *snapshot, uint64_t *solutionSelections, unsigned maxSolutions) const;
+  void reset();
+
+  const char *name() const { return _name; };
+  const SolutionInfo *solutionInfo() const { return _solutionInfo; };
+  size_t numSolutions() const { return _numSolutions; };
+
+private:
+  TensileLookupStats(const TensileLookupStats &);
+  TensileLookupStats &operator=(const TensileLookupStats &);
+
+  static const int NumShards = 8;
+
+  struct Shard {
+    std::atomic<uint64_t> _counters[TensileLookupNumCounters];
+    std::atomic<uint64_t> _latency[TensileLookupNumPaths][TENSILE_LOOKUP_LATENCY_BUCKETS];
+    std::unique_ptr<std::atomic<uint64_t>[]> _selections;
+    char                  _pad[64]; // keep neighbouring shards off each other's cache lines
+  };
+
+  // Shard of the calling thread, threads are assigned round-robin
+  Shard &shard() { return _shards[threadShard()]; };
+  static int threadShard();
+
+  const char         *_name;
+  const SolutionInfo *_solutionInfo;
+  size_t              _numSolutions;
+  Shard               _shards[NumShards];
+};
+
+/*******************************************************************************
+ * Lookup statistics API
+ *   - Mappers are numbered [0, tensileLookupStatsCount()) in materialization
+ *     order ; the numbering only changes if a library is unloaded.
+ ******************************************************************************/
+unsigned tensileLookupStatsCount();
+TensileStatus tensileLookupStatsSnapshot(unsigned mapperIdx, TensileLookupStatsSnapshot *snapshot,
+                                         uint64_t *solutionSelections, unsigned maxSolutions);
+void tensileLookupStatsReset();
+TensileStatus tensileLookupStatsWriteJson(const char *path);
+
+#endif
@@ -0,0 +1,667 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#include "ModuleRegistry.h"
+#include "DeviceContext.h"
+#include "LoadTrace.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#if Tensile_RUNTIME_LANGUAGE_HIP
+
+/*******************************************************************************
+ * HIP loader
+ ******************************************************************************/
+TensileStatus HipModuleLoader::load(int deviceId, const std::string &path,
+                                    const unsigned char *code, hipModule_t *module) {
+  return hipModuleLoadData(module, code);
+}
+
+TensileStatus HipModuleLoader::unload(int deviceId, hipModule_t module) {
+  return hipModuleUnload(module);
+}
+
+TensileStatus HipModuleLoader::getFunction(hipModule_t module, const char *kernelName,
+                                           hipFunction_t *function) {
+  return hipModuleGetFunction(function, module, kernelName);
+}
+
+TensileStatus HipModuleLoader::recordEvent(int deviceId, hipStream_t stream, hipEvent_t *event) {
+  if (*event == nullptr) {
+    hipError_t status = hipEventCreateWithFlags(event, hipEventDisableTiming);
+    if (status != hipSuccess) {
+      *event = nullptr;
+      return status;
+    }
+  }
+  return hipEventRecord(*event, stream);
+}
+
+bool HipModuleLoader::eventComplete(hipEvent_t event) {
+  return hipEventQuery(event) == hipSuccess;
+}
+
+TensileStatus HipModuleLoader::destroyEvent(hipEvent_t event) {
+  return hipEventDestroy(event);
+}
+
+/*******************************************************************************
+ * Fake loader
+ ******************************************************************************/
+TensileStatus FakeModuleLoader::load(int deviceId, const std::string &path,
+                                     const unsigned char *code, hipModule_t *module) {
+  if (_loadDelayUs)
+    std::this_thread::sleep_for(std::chrono::microseconds(_loadDelayUs));
+  if (!path.empty()) {
+    std::lock_guard<std::mutex> lockGuard(_mutex);
+    auto fiter = _failures.find(path);
+    if (fiter != _failures.end())
+      return fiter->second;
+  }
+  // Aligned like real handles so the low bits can tag the functions
+  *module = reinterpret_cast<hipModule_t>(_nextHandle.fetch_add(1) << 8);
+  _loads++;
+  return tensileStatusSuccess;
+}
+
+TensileStatus FakeModuleLoader::unload(int deviceId, hipModule_t module) {
+  _unloads++;
+  return tensileStatusSuccess;
+}
+
+TensileStatus FakeModuleLoader::getFunction(hipModule_t module, const char *kernelName,
+                                            hipFunction_t *function) {
+  _getFunctions++;
+  uintptr_t tag = std::hash<std::string>()(kernelName) & 0xff;
+  *function = reinterpret_cast<hipFunction_t>(reinterpret_cast<uintptr_t>(module) | tag);
+  return tensileStatusSuccess;
+}
+
+TensileStatus FakeModuleLoader::recordEvent(int deviceId, hipStream_t stream, hipEvent_t *event) {
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  if (*event == nullptr)
+    *event = reinterpret_cast<hipEvent_t>(_nextHandle.fetch_add(1) << 8);
+  _events[*event] = false;
+  _eventsRecorded++;
+  return tensileStatusSuccess;
+}
+
+bool FakeModuleLoader::eventComplete(hipEvent_t event) {
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  auto fiter = _events.find(event);
+  return fiter != _events.end() && fiter->second;
+}
+
+TensileStatus FakeModuleLoader::destroyEvent(hipEvent_t event) {
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  return _events.erase(event) ? tensileStatusSuccess : tensileStatusFailure;
+}
+
+void FakeModuleLoader::completeEvents() {
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  for (auto iter = _events.begin(); iter != _events.end(); iter++)
+    iter->second = true;
+}
+
+size_t FakeModuleLoader::events() {
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  return _events.size();
+}
+
+void FakeModuleLoader::setFailure(const std::string &path, TensileStatus status) {
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  if (status == tensileStatusSuccess)
+    _failures.erase(path);
+  else
+    _failures[path] = status;
+}
+
+/*******************************************************************************
+ * Module registry
+ ******************************************************************************/
+namespace {
+// Byte count with an optional K, M or G suffix, ie 512M
+size_t parseBytes(const char *value) {
+  char *end = nullptr;
+  size_t bytes = strtoull(value, &end, 0);
+  switch (end ? *end : 0) {
+    case 'G': case 'g': bytes <<= 10; // fall through
+    case 'M': case 'm': bytes <<= 10; // fall through
+    case 'K': case 'k': bytes <<= 10;
+  }
+  return bytes;
+}
+
+// Size of a code object embedded in the library, which only has its address: the end of
+// the ELF section or program header table, whichever is last (the linker writes the
+// section headers last). 0 if the code is not a 64-bit ELF file.
+size_t embeddedCodeObjectBytes(const unsigned char *code) {
+  if (memcmp(code, "\x7f" "ELF", 4) != 0 || code[4] != 2)
+    return 0;
+  uint64_t phoff, shoff;
+  uint16_t phentsize, phnum, shentsize, shnum;
+  memcpy(&phoff, code + 0x20, sizeof(phoff));
+  memcpy(&shoff, code + 0x28, sizeof(shoff));
+  memcpy(&phentsize, code + 0x36, sizeof(phentsize));
+  memcpy(&phnum, code + 0x38, sizeof(phnum));
+  memcpy(&shentsize, code + 0x3a, sizeof(shentsize));
+  memcpy(&shnum, code + 0x3c, sizeof(shnum));
+  return size_t(std::max(phoff + uint64_t(phnum) * phentsize, shoff + uint64_t(shnum) * shentsize));
+}
+}
+
+TensileModuleRegistry &TensileModuleRegistry::instance() {
+  static HipModuleLoader defaultLoader;
+  // Leaked: modules must stay valid for solutions running in static destructors
+  static TensileModuleRegistry *registry = new TensileModuleRegistry(&defaultLoader);
+  return *registry;
+}
+
+TensileModuleRegistry::TensileModuleRegistry(TensileModuleLoader *loader)
+  : _loader(loader), _loads(0), _unloads(0), _shared(0), _budget(MODULE_MEMORY_BUDGET), _clock(0),
+    _evictions(0), _fileOpens(0), _filesMapped(0), _archiveProbed(false), _archived(0)
+{
+  const char *budget = std::getenv("TENSILE_MODULE_BUDGET");
+  if (budget)
+    _budget = parseBytes(budget);
+  const char *searchPath = std::getenv("TENSILE_CODE_OBJECT_PATH");
+  setSearchPath(searchPath ? searchPath : CODE_OBJECT_PATH);
+  const char *archive = std::getenv("TENSILE_CODE_OBJECT_ARCHIVE");
+  setArchive(archive ? archive : CODE_OBJECT_ARCHIVE);
+}
+
+void TensileModuleRegistry::setSearchPath(const std::string &searchPath) {
+  std::lock_guard<std::mutex> lockGuard(_fileMutex);
+  _searchPath.clear();
+  size_t start = 0;
+  while (start <= searchPath.size()) {
+    size_t end = searchPath.find(':', start);
+    if (end == std::string::npos)
+      end = searchPath.size();
+    if (end > start)
+      _searchPath.push_back(searchPath.substr(start, end - start));
+    start = end + 1;
+  }
+  _resolvedPaths.clear();
+  _archiveProbed = false;
+  _archive.reset();
+}
+
+void TensileModuleRegistry::setArchive(const std::string &fileName) {
+  std::lock_guard<std::mutex> lockGuard(_fileMutex);
+  _archiveName = fileName;
+  _archiveProbed = false;
+  _archive.reset();
+}
+
+std::vector<std::string> TensileModuleRegistry::candidatePaths(const std::string &fileName) const {
+  std::vector<std::string> candidates;
+  if (!fileName.empty() && fileName[0] == '/') {
+    candidates.push_back(fileName);
+  } else {
+    for (auto iter = _searchPath.begin(); iter != _searchPath.end(); iter++) {
+      candidates.push_back(*iter + "/" + fileName);
+    }
+  }
+  return candidates;
+}
+
+TensileStatus TensileModuleRegistry::mapFile(const std::string &fileName,
+                                             std::shared_ptr<CodeObjectFile> *file) {
+  std::lock_guard<std::mutex> lockGuard(_fileMutex);
+
+  // Already found: share the mapping if another module still holds it, else reopen there
+  std::vector<std::string> candidates;
+  auto riter = _resolvedPaths.find(fileName);
+  if (riter != _resolvedPaths.end()) {
+    auto fiter = _files.find(riter->second);
+    if (fiter != _files.end()) {
+      *file = fiter->second.lock();
+      if (*file)
+        return tensileStatusSuccess;
+    }
+    candidates.push_back(riter->second);
+  }
+  std::vector<std::string> searched = candidatePaths(fileName);
+  candidates.insert(candidates.end(), searched.begin(), searched.end());
+
+  // Opening is the probe - no separate access() before the open
+  for (auto iter = candidates.begin(); iter != candidates.end(); iter++) {
+    std::shared_ptr<CodeObjectFile> mapped(new CodeObjectFile);
+    _fileOpens++;
+    if (mapped->_mapping.open(*iter)) {
+      mapped->_path = *iter;
+      _resolvedPaths[fileName] = *iter;
+      _files[*iter] = mapped;
+      _filesMapped++;
+      *file = mapped;
+      return tensileStatusSuccess;
+    }
+  }
+  _resolvedPaths.erase(fileName);
+  return hipErrorFileNotFound;
+}
+
+namespace {
+// True if the mapped file is a code object archive whose index and names are in bounds
+bool validArchive(const TensileMappedFile &mapping) {
+  typedef TensileModuleRegistry::CodeObjectArchiveHeader Header;
+  typedef TensileModuleRegistry::CodeObjectArchiveEntry Entry;
+  const uint64_t size = mapping.size();
+  Header header;
+  if (size < sizeof(header))
+    return false;
+  memcpy(&header, mapping.data(), sizeof(header));
+  if (memcmp(header.magic, "TNSLCOBJ", 8) != 0 || header.version != 1 ||
+      header.namesOffset < sizeof(header) + uint64_t(header.numEntries) * sizeof(Entry) ||
+      header.namesOffset > size || header.namesSize > size - header.namesOffset)
+    return false;
+  for (uint32_t i=0; i<header.numEntries; i++) {
+    Entry entry;
+    memcpy(&entry, mapping.data() + sizeof(header) + i * sizeof(entry), sizeof(entry));
+    if (uint64_t(entry.nameOffset) + entry.nameLength > header.namesSize ||
+        entry.offset > size || entry.size > size - entry.offset)
+      return false;
+  }
+  return true;
+}
+}
+
+std::shared_ptr<TensileModuleRegistry::CodeObjectFile> TensileModuleRegistry::mapArchive() {
+  std::lock_guard<std::mutex> lockGuard(_fileMutex);
+  if (_archiveProbed)
+    return _archive;
+  _archiveProbed = true;
+  if (_archiveName.empty())
+    return _archive;
+
+  std::vector<std::string> candidates = candidatePaths(_archiveName);
+  for (auto iter = candidates.begin(); iter != candidates.end(); iter++) {
+    std::shared_ptr<CodeObjectFile> mapped(new CodeObjectFile);
+    _fileOpens++;
+    if (!mapped->_mapping.open(*iter))
+      continue;
+    if (!validArchive(mapped->_mapping)) {
+      printf ("warning: ignoring malformed code object archive %s\n", iter->c_str());
+      break;
+    }
+    mapped->_path = *iter;
+    _archive = mapped;
+    _filesMapped++;
+    break;
+  }
+  return _archive;
+}
+
+bool TensileModuleRegistry::findArchived(int deviceId, const std::string &fileName,
+                                         std::shared_ptr<CodeObjectFile> *file,
+                                         const unsigned char **code, size_t *bytes,
+                                         std::string *path) {
+  std::shared_ptr<CodeObjectFile> archive = mapArchive();
+  if (!archive)
+    return false;
+
+  // Members are named after their kernel
+  std::string name = fileName;
+  if (name.size() > 3 && name.compare(name.size() - 3, 3, ".co") == 0)
+    name.resize(name.size() - 3);
+
+  const unsigned char *data = archive->_mapping.data();
+  CodeObjectArchiveHeader header;
+  memcpy(&header, data, sizeof(header));
+  const char *names = reinterpret_cast<const char *>(data + header.namesOffset);
+  auto readEntry = [&](size_t i, CodeObjectArchiveEntry *entry) {
+    memcpy(entry, data + sizeof(header) + i * sizeof(*entry), sizeof(*entry));
+  };
+
+  // First entry not before name
+  size_t lo = 0, hi = header.numEntries;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    CodeObjectArchiveEntry entry;
+    readEntry(mid, &entry);
+    if (name.compare(0, std::string::npos, names + entry.nameOffset, entry.nameLength) > 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  // Entries of the same kernel differ by ISA ; take the first if the device ISA is unknown
+  const int gcnArch = TensileDeviceContext::instance().properties(deviceId)._gcnArch;
+  for (size_t i = lo; i < header.numEntries; i++) {
+    CodeObjectArchiveEntry entry;
+    readEntry(i, &entry);
+    if (name.compare(0, std::string::npos, names + entry.nameOffset, entry.nameLength) != 0)
+      break;
+    if (gcnArch == 0 || entry.isa == uint32_t(gcnArch)) {
+      *file = archive;
+      *code = data + entry.offset;
+      *bytes = size_t(entry.size);
+      *path = archive->_path + "(" + name + ")";
+      return true;
+    }
+  }
+  return false;
+}
+
+void TensileModuleRegistry::setMemoryBudget(size_t bytes) {
+  _budget = bytes;
+}
+
+std::shared_ptr<TensileModuleRegistry::Module> TensileModuleRegistry::findEntry(const ModuleKey &key,
+                                                                               bool hard) {
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  std::shared_ptr<Module> &slot = _modules[key];
+  if (!slot) {
+    slot.reset(new Module);
+    slot->_deviceId = std::get<0>(key);
+  }
+  if (hard)
+    slot->_references++;
+  else
+    slot->_resident = true;
+  return slot;
+}
+
+TensileStatus TensileModuleRegistry::loadEntry(int deviceId, const std::string &fileName,
+                                               const unsigned char *code, Module *entry,
+                                               const char *traceName) {
+  if (entry->_module) {
+    _shared++;
+    return tensileStatusSuccess;
+  }
+
+  hipModule_t loaded = nullptr;
+  size_t bytes = 0;
+  TensileStatus status = tensileStatusSuccess;
+  if (code != nullptr) {
+    bytes = embeddedCodeObjectBytes(code);
+    TensileLoadTrace::Scope trace(TensileLoadModuleLoad, traceName, deviceId);
+    status = _loader->load(deviceId, std::string(), code, &loaded);
+  } else {
+    const unsigned char *archived = nullptr;
+    std::string path;
+    bool inArchive;
+    {
+      TensileLoadTrace::Scope trace(TensileLoadFileRead, traceName, deviceId);
+      inArchive = findArchived(deviceId, fileName, &entry->_file, &archived, &bytes, &path);
+      if (!inArchive)
+        status = mapFile(fileName, &entry->_file);
+    }
+    if (inArchive) {
+      TensileLoadTrace::Scope trace(TensileLoadModuleLoad, traceName, deviceId);
+      status = _loader->load(deviceId, path, archived, &loaded);
+      if (status == tensileStatusSuccess)
+        _archived++;
+    } else if (status == tensileStatusSuccess) {
+      bytes = entry->_file->_mapping.size();
+      TensileLoadTrace::Scope trace(TensileLoadModuleLoad, traceName, deviceId);
+      status = _loader->load(deviceId, entry->_file->_path, entry->_file->_mapping.data(), &loaded);
+    }
+  }
+  if (status != tensileStatusSuccess) {
+    entry->_file.reset();
+    return status;
+  }
+
+  entry->_module = loaded;
+  entry->_bytes = bytes;
+  _loads++;
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  _deviceBytes[deviceId] += bytes;
+  entry->_lastUse.store(++_clock, std::memory_order_relaxed);
+  return tensileStatusSuccess;
+}
+
+void TensileModuleRegistry::dropReference(const ModuleKey &key, const std::shared_ptr<Module> &entry) {
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  if (--entry->_references == 0 && !entry->_resident) {
+    auto fiter = _modules.find(key);
+    if (fiter != _modules.end() && fiter->second == entry)
+      _modules.erase(fiter);
+  }
+}
+
+TensileStatus TensileModuleRegistry::acquire(int deviceId, const std::string &fileName,
+                                             const unsigned char *code, hipModule_t *module) {
+  *module = nullptr;
+  ModuleKey key = makeKey(deviceId, fileName, code);
+  std::shared_ptr<Module> entry = findEntry(key, true);
+
+  // Only the first acquirer loads ; the others wait here for it, without blocking
+  // acquires of other code objects
+  const char *traceName = TensileLoadTrace::instance().intern(code ? std::string("(embedded)") : fileName);
+  TensileStatus status;
+  {
+    TensileLoadTrace::lock(entry->_loadMutex, traceName, deviceId);
+    std::lock_guard<std::mutex> loadLock(entry->_loadMutex, std::adopt_lock);
+    status = loadEntry(deviceId, fileName, code, entry.get(), traceName);
+    if (status == tensileStatusSuccess)
+      *module = entry->_module;
+  }
+  if (status != tensileStatusSuccess) {
+    // A later acquire retries the load
+    dropReference(key, entry);
+    return status;
+  }
+  evict(deviceId);
+  return tensileStatusSuccess;
+}
+
+TensileStatus TensileModuleRegistry::release(int deviceId, const std::string &fileName,
+                                             const unsigned char *code) {
+  std::shared_ptr<Module> entry;
+  {
+    std::lock_guard<std::mutex> lockGuard(_mutex);
+    auto fiter = _modules.find(makeKey(deviceId, fileName, code));
+    if (fiter == _modules.end() || fiter->second->_references == 0)
+      return tensileStatusFailure;
+    if (--fiter->second->_references != 0 || fiter->second->_resident)
+      return tensileStatusSuccess; // resident modules stay loaded until evicted
+    entry = fiter->second;
+    _modules.erase(fiter);
+  }
+
+  // Last reference - no acquire can be loading this entry any more
+  std::lock_guard<std::mutex> loadLock(entry->_loadMutex);
+  if (entry->_module == nullptr)
+    return tensileStatusSuccess;
+  _unloads++;
+  TensileStatus status = _loader->unload(deviceId, entry->_module);
+  entry->_file.reset(); // unmapped once no device uses it
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  _deviceBytes[deviceId] -= entry->_bytes;
+  return status;
+}
+
+TensileStatus TensileModuleRegistry::getFunction(int deviceId, const std::string &fileName,
+                                                 const unsigned char *code, const char *kernelName,
+                                                 hipFunction_t *function) {
+  *function = nullptr;
+  hipModule_t module;
+  TensileStatus status = acquire(deviceId, fileName, code, &module);
+  if (status != tensileStatusSuccess)
+    return status;
+  status = _loader->getFunction(module, kernelName, function);
+  if (status != tensileStatusSuccess)
+    release(deviceId, fileName, code);
+  return status;
+}
+
+TensileStatus TensileModuleRegistry::resolveResident(int deviceId, const std::string &fileName,
+                                                     const unsigned char *code, const char *kernelName,
+                                                     TensileResidentFunction *resident,
+                                                     TensileModulePin *pin, hipFunction_t *function) {
+  *function = nullptr;
+  std::shared_ptr<Module> entry = findEntry(makeKey(deviceId, fileName, code), false);
+  const char *traceName = TensileLoadTrace::instance().intern(kernelName);
+  TensileStatus status;
+  {
+    TensileLoadTrace::lock(entry->_loadMutex, traceName, deviceId);
+    std::lock_guard<std::mutex> loadLock(entry->_loadMutex, std::adopt_lock);
+    status = loadEntry(deviceId, fileName, code, entry.get(), traceName);
+    if (status == tensileStatusSuccess) {
+      TensileLoadTrace::Scope trace(TensileLoadFunctionResolve, traceName, deviceId);
+      status = _loader->getFunction(entry->_module, kernelName, function);
+    }
+    if (status == tensileStatusSuccess) {
+      // Pinned before the load mutex is released, which evict needs to unload the module
+      entry->_pins.fetch_add(1);
+      pin->reset();
+      pin->_module = entry.get();
+      pin->_registry = pin->_launches ? this : nullptr;
+      resident->_function.store(*function, std::memory_order_relaxed);
+      resident->_generation.store(entry->_generation.load(), std::memory_order_release);
+      resident->_module.store(entry.get(), std::memory_order_release);
+    }
+  }
+  if (status != tensileStatusSuccess)
+    return status;
+  evict(deviceId);
+  return tensileStatusSuccess;
+}
+
+void TensileModuleRegistry::recordLaunch(Module *module, hipStream_t stream) {
+  std::lock_guard<std::mutex> lockGuard(module->_launchMutex);
+  auto iter = module->_launches.begin();
+  while (iter != module->_launches.end() && iter->first != stream)
+    iter++;
+  if (iter == module->_launches.end())
+    iter = module->_launches.insert(iter, std::make_pair(stream, hipEvent_t(nullptr)));
+  // Recorded again after each launch ; the stream runs in order, so the last one completes last
+  if (_loader->recordEvent(module->_deviceId, stream, &iter->second) != tensileStatusSuccess) {
+    if (iter->second == nullptr)
+      module->_launches.erase(iter);
+    module->_unrecorded = true;
+  }
+}
+
+void TensileModuleRegistry::evict(int deviceId) {
+  collectRetired(deviceId);
+  const size_t budget = _budget.load();
+  if (budget == 0)
+    return;
+
+  bool retired = false;
+  {
+    std::lock_guard<std::mutex> lockGuard(_mutex);
+    size_t &bytes = _deviceBytes[deviceId];
+    if (bytes <= budget)
+      return;
+
+    std::vector<std::pair<uint64_t, Module *> > candidates; // by last use
+    for (auto iter = _modules.begin(); iter != _modules.end(); iter++) {
+      Module *entry = iter->second.get();
+      if (std::get<0>(iter->first) == deviceId && entry->_resident && entry->_references == 0 &&
+          entry->_pins.load() == 0 && !entry->_unrecorded.load())
+        candidates.push_back(std::make_pair(entry->_lastUse.load(std::memory_order_relaxed), entry));
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    for (auto iter = candidates.begin(); iter != candidates.end() && bytes > budget; iter++) {
+      Module *entry = iter->second;
+      // Skip modules being loaded ; waiting here would invert the lock order of loadEntry
+      std::unique_lock<std::mutex> loadLock(entry->_loadMutex, std::try_to_lock);
+      if (!loadLock.owns_lock() || entry->_module == nullptr)
+        continue;
+      // Invalidate the resident functions, then check for pins taken meanwhile (see pin).
+      // A pinned module stays loaded ; its users resolve it again.
+      entry->_generation.fetch_add(1);
+      if (entry->_pins.load() != 0)
+        continue;
+      // Unpinned: every launch from the module is recorded in _launches
+      Retired retiree;
+      {
+        std::lock_guard<std::mutex> launchLock(entry->_launchMutex);
+        if (entry->_unrecorded.load())
+          continue;
+        retiree._launches.swap(entry->_launches);
+      }
+      retiree._deviceId = deviceId;
+      retiree._module = entry->_module;
+      retiree._file = entry->_file;
+      {
+        std::lock_guard<std::mutex> retiredLock(_retiredMutex);
+        _retired.push_back(retiree);
+      }
+      entry->_module = nullptr;
+      entry->_file.reset();
+      bytes -= entry->_bytes;
+      entry->_bytes = 0;
+      retired = true;
+    }
+  }
+  // Modules whose launches already completed are unloaded right away
+  if (retired)
+    collectRetired(deviceId);
+}
+
+void TensileModuleRegistry::collectRetired(int deviceId) {
+  std::lock_guard<std::mutex> lockGuard(_retiredMutex);
+  for (size_t i = 0; i < _retired.size(); ) {
+    Retired &retiree = _retired[i];
+    bool complete = retiree._deviceId == deviceId;
+    for (auto iter = retiree._launches.begin(); complete && iter != retiree._launches.end(); iter++)
+      complete = _loader->eventComplete(iter->second);
+    if (!complete) {
+      i++;
+      continue;
+    }
+    for (auto iter = retiree._launches.begin(); iter != retiree._launches.end(); iter++)
+      _loader->destroyEvent(iter->second);
+    _loader->unload(deviceId, retiree._module);
+    _evictions++;
+    _retired.erase(_retired.begin() + i);
+  }
+}
+
+TensileModuleRegistry::Stats TensileModuleRegistry::stats() const {
+  Stats s;
+  s.loads   = _loads.load();
+  s.unloads = _unloads.load();
+  s.shared  = _shared.load();
+  s.resident = size_t(s.loads - s.unloads - _evictions.load());
+  s.fileOpens   = _fileOpens.load();
+  s.filesMapped = _filesMapped.load();
+  s.archived    = _archived.load();
+  s.evictions   = _evictions.load();
+  {
+    std::lock_guard<std::mutex> retiredLock(_retiredMutex);
+    s.retired = _retired.size();
+  }
+  s.hits = 0;
+  s.residentBytes = 0;
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  for (auto iter = _modules.begin(); iter != _modules.end(); iter++) {
+    s.hits += iter->second->_hits.load(std::memory_order_relaxed);
+  }
+  for (auto iter = _deviceBytes.begin(); iter != _deviceBytes.end(); iter++) {
+    s.residentBytes += iter->second;
+  }
+  return s;
+}
+
+#endif
@@ -0,0 +1,435 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#ifndef MODULE_REGISTRY_H
+#define MODULE_REGISTRY_H
+
+#include "TensileTypes.h"
+#include "Tools.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <stdint.h>
+
+/*******************************************************************************
+ * Module registry - code objects loaded once per device for the whole process
+ *   - A code object is identified by its file name, or by the address of the
+ *     code embedded in the library. Every solution whose kernel lives in the
+ *     same code object shares one module per device.
+ *   - File names are looked up in the directories of the code object search
+ *     path, once per file: the resolved path is cached and the file is mapped
+ *     once and shared by the modules of all devices, which load from the
+ *     mapped bytes. Cold start reads each file once, without probing.
+ *   - Kernels bundled in the code object archive by TensileCreateLibrary
+ *     (--code-object-archive) are loaded from it instead: the archive is
+ *     found in the search path and mapped once, and each module loads from
+ *     its slice of the mapping, so startup opens one file for all kernels.
+ *   - Modules are refcounted: acquire loads the module on first use, release
+ *     unloads it when the last reference is dropped.
+ *   - Modules resolved for SolutionLock are resident instead: they hold no
+ *     reference and stay loaded until evicted. Each launch pins the module
+ *     (TensileModulePin) so it can not be unloaded under the launch. When the
+ *     modules loaded on a device exceed the memory budget, the least recently
+ *     used unpinned resident modules of that device are evicted ; their
+ *     users see the eviction when the pin fails and resolve the kernel again.
+ *     Kernels launched from an evicted module may still be queued: releasing
+ *     a pin taken for a launch records an event on its stream, and evicted
+ *     modules are unloaded once the events of their streams have completed,
+ *     by a later load on the device. The device is never synchronized.
+ *   - Loading goes through the TensileModuleLoader interface (the HIP module
+ *     API, or a fake for CPU-only testing). Different code objects load
+ *     concurrently ; threads acquiring a module being loaded wait for it.
+ ******************************************************************************/
+#if Tensile_RUNTIME_LANGUAGE_HIP
+
+// Directories searched for code object files, in order, separated by ':'.
+// Can be overridden with TENSILE_CODE_OBJECT_PATH env var.
+#define CODE_OBJECT_PATH "../source/assembly:assembly"
+
+// Code object archive looked up in the search path before the separate files.
+// Can be overridden with TENSILE_CODE_OBJECT_ARCHIVE env var ; empty disables the archive.
+#define CODE_OBJECT_ARCHIVE "Kernels.coa"
+
+// Bytes of code objects each device keeps loaded before resident modules are evicted,
+// 0 for no limit. Can be overridden with TENSILE_MODULE_BUDGET env var (K, M or G suffix).
+#define MODULE_MEMORY_BUDGET 0
+
+class TensileModuleLoader {
+public:
+  virtual ~TensileModuleLoader() {};
+
+  // Load a code object on deviceId, which is the current device of the calling thread.
+  // code holds the code object ; path is the file it was mapped from, ARCHIVE(KERNEL) for
+  // a member of the code object archive, empty for code embedded in the library.
+  virtual TensileStatus load(int deviceId, const std::string &path, const unsigned char *code,
+                             hipModule_t *module) = 0;
+  virtual TensileStatus unload(int deviceId, hipModule_t module) = 0;
+  virtual TensileStatus getFunction(hipModule_t module, const char *kernelName,
+                                    hipFunction_t *function) = 0;
+  // Record *event on stream of deviceId, the current device, creating it if nullptr
+  virtual TensileStatus recordEvent(int deviceId, hipStream_t stream, hipEvent_t *event) = 0;
+  // Whether the work recorded before event has completed, without waiting for it
+  virtual bool eventComplete(hipEvent_t event) = 0;
+  virtual TensileStatus destroyEvent(hipEvent_t event) = 0;
+};
+
+class HipModuleLoader : public TensileModuleLoader {
+public:
+  TensileStatus load(int deviceId, const std::string &path, const unsigned char *code,
+                     hipModule_t *module);
+  TensileStatus unload(int deviceId, hipModule_t module);
+  TensileStatus getFunction(hipModule_t module, const char *kernelName, hipFunction_t *function);
+  TensileStatus recordEvent(int deviceId, hipStream_t stream, hipEvent_t *event);
+  bool eventComplete(hipEvent_t event);
+  TensileStatus destroyEvent(hipEvent_t event);
+};
+
+// Loader handing out distinct fake handles without touching a device, for testing the
+// module sharing of the library without a GPU. Code objects listed with setFailure fail to load.
+// Events stay pending until completeEvents is called, like kernels still queued on a device.
+class FakeModuleLoader : public TensileModuleLoader {
+public:
+  FakeModuleLoader() : _nextHandle(1), _loads(0), _unloads(0), _getFunctions(0),
+                       _eventsRecorded(0), _loadDelayUs(0) {};
+
+  TensileStatus load(int deviceId, const std::string &path, const unsigned char *code,
+                     hipModule_t *module);
+  TensileStatus unload(int deviceId, hipModule_t module);
+  TensileStatus getFunction(hipModule_t module, const char *kernelName, hipFunction_t *function);
+  TensileStatus recordEvent(int deviceId, hipStream_t stream, hipEvent_t *event);
+  bool eventComplete(hipEvent_t event);
+  TensileStatus destroyEvent(hipEvent_t event);
+
+  // Complete every event recorded so far
+  void completeEvents();
+
+  // Time each load takes, to widen the windows for concurrency tests
+  void setLoadDelayUs(unsigned int us) { _loadDelayUs = us; };
+  // Make loads from the file path fail with status, or succeed again if status is success
+  void setFailure(const std::string &path, TensileStatus status);
+
+  uint64_t loads() const { return _loads.load(); };
+  uint64_t unloads() const { return _unloads.load(); };
+  uint64_t getFunctions() const { return _getFunctions.load(); };
+  uint64_t eventsRecorded() const { return _eventsRecorded.load(); };
+  // Events created and not destroyed yet
+  size_t   events();
+  // Modules loaded and not unloaded yet
+  int64_t  resident() const { return int64_t(_loads.load()) - int64_t(_unloads.load()); };
+
+private:
+  std::mutex                           _mutex;
+  std::map<std::string, TensileStatus> _failures;
+  std::map<hipEvent_t, bool>           _events; // -> completed
+  std::atomic<uintptr_t>               _nextHandle;
+  std::atomic<uint64_t>                _loads;
+  std::atomic<uint64_t>                _unloads;
+  std::atomic<uint64_t>                _getFunctions;
+  std::atomic<uint64_t>                _eventsRecorded;
+  unsigned int                         _loadDelayUs;
+};
+
+class TensileResidentFunction;
+class TensileModulePin;
+
+class TensileModuleRegistry {
+public:
+  static TensileModuleRegistry &instance();
+
+  // Replace the loader (not owned). Must be called before any module is loaded.
+  void setLoader(TensileModuleLoader *loader) { _loader = loader; };
+  TensileModuleLoader *loader() const { return _loader; };
+
+  // Replace the code object search path (directories separated by ':') and forget
+  // the resolved paths. Files already mapped stay mapped.
+  void setSearchPath(const std::string &searchPath);
+
+  // Replace the code object archive (a file name looked up in the search path, empty for
+  // none). Modules already loaded from the previous archive keep it mapped.
+  void setArchive(const std::string &fileName);
+
+  // Take a reference to the module of a code object on deviceId, loading it if this is
+  // the first reference. code identifies the code object if not nullptr, else fileName,
+  // which is looked up in the search path unless it is an absolute path.
+  TensileStatus acquire(int deviceId, const std::string &fileName, const unsigned char *code,
+                        hipModule_t *module);
+
+  // Drop a reference taken by acquire ; the module is unloaded with the last reference.
+  TensileStatus release(int deviceId, const std::string &fileName, const unsigned char *code);
+
+  // acquire the module, then resolve kernelName in it. The reference is kept (the
+  // function is only valid while the module is loaded) unless the lookup fails.
+  TensileStatus getFunction(int deviceId, const std::string &fileName, const unsigned char *code,
+                            const char *kernelName, hipFunction_t *function);
+
+  // Resolve kernelName for deviceId into resident and function, loading its module as a
+  // resident module if it is not loaded, and pin the module with pin. Calls for the same
+  // resident must be serialized by the caller.
+  TensileStatus resolveResident(int deviceId, const std::string &fileName, const unsigned char *code,
+                                const char *kernelName, TensileResidentFunction *resident,
+                                TensileModulePin *pin, hipFunction_t *function);
+
+  // Pin the module of a function resolved earlier and return the function. Returns false
+  // if resident is not resolved yet or its module was evicted since: resolve it again.
+  inline bool pin(const TensileResidentFunction &resident, TensileModulePin *pin,
+                  hipFunction_t *function);
+
+  // Replace the memory budget of each device (0 for no limit) ; applies from the next load.
+  // Launches are recorded without a budget too, so modules loaded before can be evicted.
+  void setMemoryBudget(size_t bytes);
+  size_t memoryBudget() const { return _budget.load(); };
+
+  struct Stats {
+    uint64_t loads;       // modules loaded
+    uint64_t unloads;     // modules unloaded by the last release
+    uint64_t shared;      // acquires served by a module already loaded
+    size_t   resident;    // modules currently loaded
+    uint64_t fileOpens;   // code object files opened, including failed probes
+    uint64_t filesMapped; // code object files mapped, including the archive
+    uint64_t archived;    // modules loaded from the code object archive
+    uint64_t hits;        // launches pinning a resident module already loaded
+    uint64_t evictions;   // resident modules unloaded to fit the budget
+    size_t   retired;     // modules evicted, waiting for their launches to unload
+    size_t   residentBytes; // code object bytes loaded on all devices
+  };
+  Stats stats() const;
+
+  // Unload the modules of deviceId, the current device, evicted since their launches
+  // completed. Every load does it ; call it to free them sooner.
+  void collectRetired(int deviceId);
+
+  //--------------------
+  // Code object archive
+  // Written by TensileCreateLibrary (assembly/Kernels.coa). Little endian layout:
+  //   CodeObjectArchiveHeader
+  //   CodeObjectArchiveEntry entries[numEntries] - sorted by name, then isa
+  //   char names[namesSize] - NUL terminated kernel names, at namesOffset
+  //   code objects, each starting on a 4 KiB boundary
+  struct CodeObjectArchiveHeader {
+    char     magic[8]; // TNSLCOBJ
+    uint32_t version;
+    uint32_t numEntries;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+  };
+
+  struct CodeObjectArchiveEntry {
+    uint64_t offset;     // of the code object, from the start of the archive
+    uint64_t size;
+    uint32_t nameOffset; // into names
+    uint32_t nameLength;
+    uint32_t isa;        // target, as TensileDeviceProperties::_gcnArch (ie 906)
+    uint32_t reserved;
+  };
+
+private:
+  TensileModuleRegistry(TensileModuleLoader *loader);
+
+  typedef std::tuple<int, std::string, const unsigned char *> ModuleKey;
+
+  // A mapped code object file, shared by the modules loaded from it on every device
+  struct CodeObjectFile {
+    std::string       _path;
+    TensileMappedFile _mapping;
+  };
+
+public:
+  // Registry entry of a code object on a device, referenced by resident functions
+  struct Module {
+    Module() : _deviceId(0), _module(nullptr), _references(0), _bytes(0), _resident(false),
+               _pins(0), _generation(0), _lastUse(0), _hits(0), _unrecorded(false) {};
+    int         _deviceId;
+    std::mutex  _loadMutex; // held while loading so concurrent acquirers wait
+    hipModule_t _module;    // nullptr until loaded
+    size_t      _references;
+    size_t      _bytes;     // code object size, while loaded
+    bool        _resident;  // used by resident functions ; the entry is never erased
+    std::shared_ptr<CodeObjectFile> _file; // mapping the module was loaded from, if any
+
+    // Launch side, see pin
+    std::atomic<uint32_t> _pins;
+    std::atomic<uint64_t> _generation; // bumped when the module is evicted
+    std::atomic<uint64_t> _lastUse;    // load clock of the last pin
+    std::atomic<uint64_t> _hits;
+
+    // Event recorded after the last launch on each stream, see recordLaunch
+    std::mutex _launchMutex;
+    std::vector<std::pair<hipStream_t, hipEvent_t> > _launches;
+    std::atomic<bool> _unrecorded; // a launch could not be recorded: never evicted
+  };
+
+private:
+  friend class TensileModulePin;
+
+  // Record an event after the launches queued on stream from module, before their pin is
+  // released, so its eviction can tell when they completed
+  void recordLaunch(Module *module, hipStream_t stream);
+
+  static ModuleKey makeKey(int deviceId, const std::string &fileName, const unsigned char *code) {
+    // The embedded code is identified by its address alone
+    return std::make_tuple(deviceId, code ? std::string() : fileName, code);
+  }
+
+  // Paths to try for fileName: itself if absolute, else in each search path directory
+  std::vector<std::string> candidatePaths(const std::string &fileName) const;
+
+  // Find or create the entry of key and take a reference if hard, else mark it resident
+  std::shared_ptr<Module> findEntry(const ModuleKey &key, bool hard);
+
+  // Load the module of entry unless loaded, with its load mutex held.
+  // traceName is the interned name its load phases are traced under.
+  TensileStatus loadEntry(int deviceId, const std::string &fileName, const unsigned char *code,
+                          Module *entry, const char *traceName);
+
+  // Drop a reference from acquire that did not load the module
+  void dropReference(const ModuleKey &key, const std::shared_ptr<Module> &entry);
+
+  // Retire unpinned resident modules of deviceId, least recently used first, until the
+  // modules loaded on it fit the budget
+  void evict(int deviceId);
+
+  // Find fileName in the search path and map it, or share the mapping of an earlier call
+  TensileStatus mapFile(const std::string &fileName, std::shared_ptr<CodeObjectFile> *file);
+
+  // Map and check the archive on first use ; nullptr if there is none
+  std::shared_ptr<CodeObjectFile> mapArchive();
+
+  // Find the code object of fileName (KERNEL.co) for the ISA of deviceId in the archive.
+  // Returns false if it is not archived.
+  bool findArchived(int deviceId, const std::string &fileName,
+                    std::shared_ptr<CodeObjectFile> *file, const unsigned char **code,
+                    size_t *bytes, std::string *path);
+
+  TensileModuleLoader                          *_loader;
+  mutable std::mutex                            _mutex;
+  std::map<ModuleKey, std::shared_ptr<Module> > _modules;
+  std::atomic<uint64_t>                         _loads;
+  std::atomic<uint64_t>                         _unloads;
+  std::atomic<uint64_t>                         _shared;
+
+  // Residency
+  std::atomic<size_t>                           _budget;
+  std::map<int, size_t>                         _deviceBytes;  // loaded code object bytes, retired excluded
+  std::atomic<uint64_t>                         _clock;        // bumped by every load
+  std::atomic<uint64_t>                         _evictions;
+
+  // Evicted modules, still loaded until the launches recorded on them complete
+  struct Retired {
+    int                             _deviceId;
+    hipModule_t                     _module;
+    std::shared_ptr<CodeObjectFile> _file;
+    std::vector<std::pair<hipStream_t, hipEvent_t> > _launches;
+  };
+  mutable std::mutex                            _retiredMutex;
+  std::vector<Retired>                          _retired;
+
+  // Search path and the files found in it ; mappings are dropped with their last module
+  std::mutex                                    _fileMutex;
+  std::vector<std::string>                      _searchPath;
+  std::map<std::string, std::string>            _resolvedPaths; // fileName -> path
+  std::map<std::string, std::weak_ptr<CodeObjectFile> > _files; // path -> mapping
+  std::atomic<uint64_t>                         _fileOpens;
+  std::atomic<uint64_t>                         _filesMapped;
+
+  std::string                                   _archiveName;
+  bool                                          _archiveProbed; // mapArchive looked for it
+  std::shared_ptr<CodeObjectFile>               _archive;       // nullptr if not found
+  std::atomic<uint64_t>                         _archived;
+};
+
+// Pin on a resident module, released when destroyed or reset. Kernels launched while the
+// pin is held are not unloaded under the launch: a pin for launches on stream records them
+// when released, and their module is only unloaded once they completed.
+class TensileModulePin {
+public:
+  TensileModulePin() : _module(nullptr), _registry(nullptr), _stream(nullptr), _launches(false) {};
+  explicit TensileModulePin(hipStream_t stream)
+    : _module(nullptr), _registry(nullptr), _stream(stream), _launches(true) {};
+  ~TensileModulePin() { reset(); };
+
+  void reset() {
+    if (_module) {
+      if (_registry)
+        _registry->recordLaunch(_module, _stream);
+      _module->_pins.fetch_sub(1);
+      _module = nullptr;
+      _registry = nullptr;
+    }
+  };
+
+private:
+  friend class TensileModuleRegistry;
+  TensileModulePin(const TensileModulePin &);
+  TensileModulePin &operator=(const TensileModulePin &);
+
+  TensileModuleRegistry::Module *_module;
+  TensileModuleRegistry         *_registry; // set if the launches must be recorded
+  hipStream_t                    _stream;
+  bool                           _launches;
+};
+
+// Function of a kernel on one device as cached by its user, valid while its module is
+// pinned. Written by TensileModuleRegistry::resolveResident only.
+class TensileResidentFunction {
+public:
+  TensileResidentFunction() : _function(nullptr), _generation(0), _module(nullptr) {};
+
+private:
+  friend class TensileModuleRegistry;
+  TensileResidentFunction(const TensileResidentFunction &);
+  TensileResidentFunction &operator=(const TensileResidentFunction &);
+
+  std::atomic<hipFunction_t>                   _function;
+  std::atomic<uint64_t>                        _generation; // of the module when resolved
+  std::atomic<TensileModuleRegistry::Module *> _module;
+};
+
+inline bool TensileModuleRegistry::pin(const TensileResidentFunction &resident,
+                                       TensileModulePin *pin, hipFunction_t *function) {
+  Module *module = resident._module.load(std::memory_order_acquire);
+  if (module == nullptr)
+    return false;
+  const uint64_t generation = resident._generation.load(std::memory_order_acquire);
+  *function = resident._function.load(std::memory_order_relaxed);
+
+  // Pin, then check the module was not evicted ; evict bumps the generation, then checks
+  // the pins, so one of the two sides backs off
+  module->_pins.fetch_add(1);
+  if (module->_generation.load() != generation) {
+    module->_pins.fetch_sub(1);
+    return false;
+  }
+  pin->reset();
+  pin->_module = module;
+  // Recorded even without a budget, so a budget set later can evict the module
+  pin->_registry = pin->_launches ? this : nullptr;
+  module->_lastUse.store(_clock.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  module->_hits.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,173 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#include "Preloader.h"
+#include "DeviceContext.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+
+namespace {
+#ifdef WIN32
+__declspec(thread) bool isPreloadThread = false;
+#else
+thread_local bool isPreloadThread = false;
+#endif
+}
+
+TensilePreloader &TensilePreloader::instance() {
+  // Leaked: the preload threads may still be running when static destructors run
+  static TensilePreloader *preloader = new TensilePreloader;
+  return *preloader;
+}
+
+TensilePreloader::TensilePreloader()
+  : _mode(None), _topN(0), _numThreads(PRELOAD_THREADS), _running(0), _demand(0),
+    _queued(0), _loaded(0), _failed(0), _yields(0)
+{
+  const char *selection = std::getenv("TENSILE_PRELOAD");
+  const char *threads = std::getenv("TENSILE_PRELOAD_THREADS");
+  configure(selection ? selection : PRELOAD_CODE_OBJECTS,
+            threads ? strtoul(threads, nullptr, 0) : PRELOAD_THREADS);
+}
+
+void TensilePreloader::configure(const std::string &selection, unsigned int numThreads) {
+  _mode = None;
+  _topN = 0;
+  _listed.clear();
+  _numThreads = numThreads ? numThreads : 1;
+
+  if (selection.empty() || selection == "none") {
+    return;
+  } else if (selection == "all") {
+    _mode = All;
+  } else if (selection.compare(0, 4, "top:") == 0) {
+    _topN = strtoul(selection.c_str() + 4, nullptr, 0);
+    if (_topN)
+      _mode = Top;
+  } else if (selection.compare(0, 5, "file:") == 0) {
+    std::ifstream listFile(selection.substr(5));
+    std::string name;
+    while (listFile >> name) {
+      _listed.insert(name);
+    }
+    if (!_listed.empty())
+      _mode = List;
+    else
+      printf ("warning: no solutions to preload in %s\n", selection.c_str() + 5);
+  } else {
+    printf ("warning: ignoring unknown TENSILE_PRELOAD selection '%s'\n", selection.c_str());
+  }
+}
+
+bool TensilePreloader::listed(const SolutionInfo &info) const {
+  return _listed.count(info._name) ||
+         (info._kernelName && _listed.count(info._kernelName));
+}
+
+void TensilePreloader::add(SolutionLock *lock, const SolutionInfo *info, int deviceId) {
+  if (info->_kernelName == nullptr)
+    return; // no code object to load
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  _queue.push_back(Item{lock, info, deviceId});
+  _queued++;
+}
+
+void TensilePreloader::start() {
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  while (_running < _numThreads && _running < _queue.size()) {
+    _running++;
+    std::thread(&TensilePreloader::run, this).detach();
+  }
+}
+
+void TensilePreloader::wait() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _cond.wait(lock, [this]() { return _running == 0; });
+}
+
+void TensilePreloader::run() {
+  isPreloadThread = true;
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (!_queue.empty()) {
+    if (_demand) {
+      _yields++;
+      _cond.wait(lock, [this]() { return _demand == 0; });
+      continue;
+    }
+    Item item = _queue.front();
+    _queue.pop_front();
+    lock.unlock();
+
+    TensileStatus status = TensileDeviceContext::instance().setDevice(item._deviceId);
+#if Tensile_RUNTIME_LANGUAGE_HIP
+    if (status == tensileStatusSuccess) {
+      DeviceFunctionType function;
+      status = item._lock->getFunction(&function, item._deviceId,
+                                       item._info->_kernelName, item._info->_codeObject);
+    }
+#endif
+    if (status == tensileStatusSuccess) {
+      _loaded++;
+    } else {
+      _failed++;
+      printf ("warning: preloading solution %s on device %d failed with status %d\n",
+              item._info->_name, item._deviceId, int(status));
+    }
+
+    lock.lock();
+  }
+  _running--;
+  _cond.notify_all();
+}
+
+void TensilePreloader::beginDemand() {
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  _demand++;
+}
+
+void TensilePreloader::endDemand() {
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  if (--_demand == 0)
+    _cond.notify_all();
+}
+
+TensilePreloader::DemandScope::DemandScope()
+  : _active(!isPreloadThread)
+{
+  if (_active)
+    TensilePreloader::instance().beginDemand();
+}
+
+TensilePreloader::DemandScope::~DemandScope() {
+  if (_active)
+    TensilePreloader::instance().endDemand();
+}
+
+TensilePreloader::Stats TensilePreloader::stats() const {
+  Stats s;
+  s.queued = _queued.load();
+  s.loaded = _loaded.load();
+  s.failed = _failed.load();
+  s.yields = _yields.load();
+  return s;
+}
@@ -0,0 +1,130 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#ifndef PRELOADER_H
+#define PRELOADER_H
+
+#include "SolutionHelper.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <stdint.h>
+
+/*******************************************************************************
+ * Background preloading of code objects
+ *   - tensileInitialize queues the kernels of the selected solutions for every
+ *     device and a small pool of threads loads them, so the first launch of
+ *     those solutions does not pay for the module load.
+ *   - Solutions are selected by TENSILE_PRELOAD (default PRELOAD_CODE_OBJECTS):
+ *       ""  or "none"  no preloading
+ *       "all"          every solution
+ *       "top:N"        the N solutions winning the most exact table entries,
+ *                      per problem type and device
+ *       "file:PATH"    the solutions (or kernels) named in PATH, one per line
+ *   - Loads needed by a launch take priority: while any on-demand load is in
+ *     progress the preload threads do not start new loads.
+ ******************************************************************************/
+
+// Default selection of the solutions to preload, see above.
+// Can be overridden with TENSILE_PRELOAD env var, ie TENSILE_PRELOAD=top:32
+#define PRELOAD_CODE_OBJECTS ""
+
+// Number of preload threads. Can be overridden with TENSILE_PRELOAD_THREADS env var
+#define PRELOAD_THREADS 2
+
+class TensilePreloader {
+public:
+  enum Mode {None, All, Top, List};
+
+  static TensilePreloader &instance();
+
+  // Parse a selection (see above) ; an invalid selection disables preloading.
+  // Must be called before solutions are added.
+  void configure(const std::string &selection, unsigned int numThreads);
+
+  bool enabled() const { return _mode != None; };
+  Mode mode() const { return _mode; };
+  size_t topN() const { return _topN; };
+  // For mode List: true if the solution or its kernel is listed
+  bool listed(const SolutionInfo &info) const;
+
+  // Queue the kernel of a solution for loading on deviceId. lock is the runtime state
+  // of the solution, which must outlive the preloader.
+  void add(SolutionLock *lock, const SolutionInfo *info, int deviceId);
+
+  // Start the preload threads. They exit when the queue is empty.
+  void start();
+
+  // Block until the queue is drained and every started load has finished
+  void wait();
+
+  // Wrap on-demand loads so the preload threads yield to them.
+  // Does nothing on the preload threads themselves.
+  class DemandScope {
+  public:
+    DemandScope();
+    ~DemandScope();
+  private:
+    bool _active;
+  };
+
+  struct Stats {
+    uint64_t queued;
+    uint64_t loaded;  // loaded by a preload thread, or already loaded when reached
+    uint64_t failed;
+    uint64_t yields;  // times a preload thread waited for on-demand loads
+  };
+  Stats stats() const;
+
+private:
+  TensilePreloader();
+
+  struct Item {
+    SolutionLock       *_lock;
+    const SolutionInfo *_info;
+    int                 _deviceId;
+  };
+
+  void run();
+  void beginDemand();
+  void endDemand();
+
+  Mode                    _mode;
+  size_t                  _topN;
+  std::set<std::string>   _listed;
+  unsigned int            _numThreads;
+
+  std::mutex              _mutex;
+  std::condition_variable _cond;
+  std::deque<Item>        _queue;
+  unsigned int            _running;  // preload threads not finished yet
+  unsigned int            _demand;   // on-demand loads in progress
+
+  std::atomic<uint64_t>   _queued;
+  std::atomic<uint64_t>   _loaded;
+  std::atomic<uint64_t>   _failed;
+  std::atomic<uint64_t>   _yields;
+};
+
+#endif
@@ -0,0 +1,360 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#include "ProgramCache.h"
+#include "LoadTrace.h"
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#if Tensile_RUNTIME_LANGUAGE_OCL
+
+namespace {
+// FNV-1a, stable across runs and platforms so it can name files of the disk cache
+uint64_t hashBytes(const char *data, size_t size, uint64_t hash = 0xcbf29ce484222325ull) {
+  for (size_t i=0; i<size; i++) {
+    hash = (hash ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+// Name of the first kernel of an OpenCL source, declared as "__kernel void NAME(" by the
+// source kernel writer
+std::string kernelNameOf(const char *source) {
+  const char *p = strstr(source, "__kernel");
+  if (p) {
+    p += strlen("__kernel");
+    while (isspace(static_cast<unsigned char>(*p))) p++;
+    if (strncmp(p, "void", 4) == 0) {
+      p += 4;
+      while (isspace(static_cast<unsigned char>(*p))) p++;
+      const char *end = p;
+      while (isalnum(static_cast<unsigned char>(*end)) || *end == '_') end++;
+      if (end != p)
+        return std::string(p, end);
+    }
+  }
+  return "(opencl program)";
+}
+}
+
+/*******************************************************************************
+ * OpenCL builder
+ ******************************************************************************/
+TensileStatus OclProgramBuilder::queueInfo(cl_command_queue queue, cl_context *context,
+                                           cl_device_id *device) {
+  TensileStatus status = clGetCommandQueueInfo(queue, CL_QUEUE_CONTEXT,
+      sizeof(*context), context, NULL);
+  if (status != CL_SUCCESS)
+    return status;
+  return clGetCommandQueueInfo(queue, CL_QUEUE_DEVICE, sizeof(*device), device, NULL);
+}
+
+TensileStatus OclProgramBuilder::deviceSignature(cl_device_id device, std::string *signature) {
+  const cl_device_info infos[] = {CL_DEVICE_NAME, CL_DEVICE_VERSION, CL_DRIVER_VERSION};
+  signature->clear();
+  for (size_t i=0; i<sizeof(infos)/sizeof(infos[0]); i++) {
+    char value[256];
+    TensileStatus status = clGetDeviceInfo(device, infos[i], sizeof(value), value, NULL);
+    if (status != CL_SUCCESS)
+      return status;
+    value[sizeof(value)-1] = '\0';
+    *signature += value;
+    *signature += '\n';
+  }
+  return CL_SUCCESS;
+}
+
+TensileStatus OclProgramBuilder::buildFromSource(cl_context context, cl_device_id device,
+                                                 const char *source, const char *buildOptions,
+                                                 cl_program *program) {
+  cl_int status;
+  *program = clCreateProgramWithSource(context, 1, &source, NULL, &status);
+  if (status != CL_SUCCESS)
+    return status;
+  status = clBuildProgram(*program, 1, &device, buildOptions, NULL, NULL);
+
+  // print build failure
+  if (status != CL_SUCCESS) {
+    printf("clBuildProgram Failed with status = %d\n", status);
+
+    size_t len = 0;
+    clGetProgramBuildInfo(*program, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &len);
+    char* buildLog = new char[len];
+    clGetProgramBuildInfo(*program, device, CL_PROGRAM_BUILD_LOG, len*sizeof(char), buildLog, 0);
+    printf("\n\n\nBuild Log:\n\n");
+    printf("%s\n", buildLog);
+    printf("\n");
+    printf("\nKernel Source:\n\n");
+    printf("%s\n", source);
+    delete[] buildLog;
+    clReleaseProgram(*program);
+    *program = nullptr;
+  }
+  return status;
+}
+
+TensileStatus OclProgramBuilder::buildFromBinary(cl_context context, cl_device_id device,
+                                                 const unsigned char *binary, size_t size,
+                                                 const char *buildOptions, cl_program *program) {
+  cl_int binaryStatus, status;
+  *program = clCreateProgramWithBinary(context, 1, &device, &size, &binary, &binaryStatus, &status);
+  if (status == CL_SUCCESS)
+    status = binaryStatus;
+  if (status == CL_SUCCESS)
+    status = clBuildProgram(*program, 1, &device, buildOptions, NULL, NULL);
+  if (status != CL_SUCCESS && *program) {
+    clReleaseProgram(*program);
+    *program = nullptr;
+  }
+  return status;
+}
+
+TensileStatus OclProgramBuilder::getBinary(cl_program program, std::vector<unsigned char> *binary) {
+  size_t size = 0; // built for one device
+  TensileStatus status = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size), &size, NULL);
+  if (status != CL_SUCCESS)
+    return status;
+  binary->resize(size);
+  unsigned char *data = binary->data();
+  return clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(data), &data, NULL);
+}
+
+TensileStatus OclProgramBuilder::createKernel(cl_program program, cl_kernel *kernel) {
+  return clCreateKernelsInProgram(program, 1, kernel, NULL);
+}
+
+/*******************************************************************************
+ * Fake builder
+ ******************************************************************************/
+TensileStatus FakeProgramBuilder::queueInfo(cl_command_queue queue, cl_context *context,
+                                            cl_device_id *device) {
+  // One context ; each queue is a device
+  *context = reinterpret_cast<cl_context>(1);
+  *device = reinterpret_cast<cl_device_id>(queue);
+  return CL_SUCCESS;
+}
+
+TensileStatus FakeProgramBuilder::deviceSignature(cl_device_id device, std::string *signature) {
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  *signature = _signature;
+  return CL_SUCCESS;
+}
+
+TensileStatus FakeProgramBuilder::buildFromSource(cl_context context, cl_device_id device,
+                                                  const char *source, const char *buildOptions,
+                                                  cl_program *program) {
+  if (_buildDelayUs)
+    std::this_thread::sleep_for(std::chrono::microseconds(_buildDelayUs));
+  *program = reinterpret_cast<cl_program>(_nextHandle.fetch_add(1) << 8);
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  _sources[*program] = std::string("fake binary\n") + _signature + "\n" + source;
+  _sourceBuilds++;
+  return CL_SUCCESS;
+}
+
+TensileStatus FakeProgramBuilder::buildFromBinary(cl_context context, cl_device_id device,
+                                                  const unsigned char *binary, size_t size,
+                                                  const char *buildOptions, cl_program *program) {
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  // Only binaries of the current signature load
+  std::string prefix = std::string("fake binary\n") + _signature + "\n";
+  if (size < prefix.size() || memcmp(binary, prefix.data(), prefix.size()) != 0)
+    return tensileStatusFailure;
+  *program = reinterpret_cast<cl_program>(_nextHandle.fetch_add(1) << 8);
+  _sources[*program] = std::string(reinterpret_cast<const char *>(binary), size);
+  _binaryBuilds++;
+  return CL_SUCCESS;
+}
+
+TensileStatus FakeProgramBuilder::getBinary(cl_program program, std::vector<unsigned char> *binary) {
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  auto iter = _sources.find(program);
+  if (iter == _sources.end())
+    return tensileStatusFailure;
+  binary->assign(iter->second.begin(), iter->second.end());
+  return CL_SUCCESS;
+}
+
+TensileStatus FakeProgramBuilder::createKernel(cl_program program, cl_kernel *kernel) {
+  _kernels++;
+  *kernel = reinterpret_cast<cl_kernel>(reinterpret_cast<uintptr_t>(program) | (_kernels.load() & 0xff));
+  return CL_SUCCESS;
+}
+
+/*******************************************************************************
+ * Program cache
+ ******************************************************************************/
+TensileProgramCache &TensileProgramCache::instance() {
+  static OclProgramBuilder defaultBuilder;
+  // Leaked: kernels created from the programs may be used by static destructors
+  static TensileProgramCache *cache = new TensileProgramCache(&defaultBuilder);
+  return *cache;
+}
+
+TensileProgramCache::TensileProgramCache(TensileProgramBuilder *builder)
+  : _builder(builder), _hits(0), _sourceBuilds(0), _diskHits(0), _diskWrites(0)
+{
+  const char *cachePath = std::getenv("TENSILE_OPENCL_CACHE_PATH");
+  setCachePath(cachePath ? cachePath : OPENCL_CACHE_PATH);
+}
+
+void TensileProgramCache::setCachePath(const std::string &cachePath) {
+  std::string path = cachePath;
+  if (!path.empty() && path[0] == '~') {
+#ifdef WIN32
+    const char *home = std::getenv("USERPROFILE");
+#else
+    const char *home = std::getenv("HOME");
+#endif
+    path = home ? home + path.substr(1) : std::string(); // no home, no disk cache
+  }
+  std::lock_guard<std::mutex> lockGuard(_mutex);
+  _cachePath = path;
+}
+
+TensileStatus TensileProgramCache::getProgram(cl_command_queue queue, const char *source,
+                                              const char *buildOptions, cl_program *program) {
+  const char *traceName;
+  return getProgram(queue, source, buildOptions, program, &traceName);
+}
+
+TensileStatus TensileProgramCache::getProgram(cl_command_queue queue, const char *source,
+                                              const char *buildOptions, cl_program *program,
+                                              const char **traceName) {
+  *program = nullptr;
+  *traceName = nullptr;
+  cl_context context;
+  cl_device_id device;
+  TensileStatus status = _builder->queueInfo(queue, &context, &device);
+  if (status != CL_SUCCESS)
+    return status;
+
+  const uint64_t sourceHash = hashBytes(source, strlen(source));
+  ProgramKey key = std::make_tuple(context, device, sourceHash,
+                                   std::string(buildOptions ? buildOptions : ""));
+  std::shared_ptr<Program> entry;
+  {
+    std::lock_guard<std::mutex> lockGuard(_mutex);
+    std::shared_ptr<Program> &slot = _programs[key];
+    if (!slot) {
+      slot.reset(new Program);
+      slot->_traceName = TensileLoadTrace::instance().intern(kernelNameOf(source));
+    }
+    entry = slot;
+  }
+  *traceName = entry->_traceName;
+
+  // Only the first user builds ; the others wait here for it, without blocking
+  // builds of other programs
+  TensileLoadTrace::lock(entry->_buildMutex, entry->_traceName, -1);
+  std::lock_guard<std::mutex> buildLock(entry->_buildMutex, std::adopt_lock);
+  if (entry->_program) {
+    _hits++;
+    *program = entry->_program;
+    return CL_SUCCESS;
+  }
+  status = build(context, device, source, sourceHash, buildOptions, entry->_traceName,
+                 &entry->_program);
+  *program = entry->_program;
+  return status;
+}
+
+TensileStatus TensileProgramCache::build(cl_context context, cl_device_id device, const char *source,
+                                         uint64_t sourceHash, const char *buildOptions,
+                                         const char *traceName, cl_program *program) {
+  std::string cachePath;
+  {
+    std::lock_guard<std::mutex> lockGuard(_mutex);
+    cachePath = _cachePath;
+  }
+
+  std::string fileName;
+  std::string signature;
+  if (!cachePath.empty() && _builder->deviceSignature(device, &signature) == CL_SUCCESS) {
+    signature += '\0';
+    if (buildOptions)
+      signature += buildOptions;
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx-%016llx.clbin", (unsigned long long)sourceHash,
+             (unsigned long long)hashBytes(signature.data(), signature.size()));
+    fileName = cachePath + "/" + name;
+
+    TensileMappedFile cached;
+    bool opened;
+    {
+      TensileLoadTrace::Scope trace(TensileLoadFileRead, traceName, -1);
+      opened = cached.open(fileName);
+    }
+    if (opened) {
+      TensileLoadTrace::Scope trace(TensileLoadModuleLoad, traceName, -1);
+      if (_builder->buildFromBinary(context, device, cached.data(), cached.size(), buildOptions,
+                                    program) == CL_SUCCESS) {
+        _diskHits++;
+        return CL_SUCCESS;
+      }
+    }
+  }
+
+  TensileStatus status;
+  {
+    TensileLoadTrace::Scope trace(TensileLoadCompile, traceName, -1);
+    status = _builder->buildFromSource(context, device, source, buildOptions, program);
+  }
+  if (status != CL_SUCCESS)
+    return status;
+  _sourceBuilds++;
+
+  // Missing or stale binary: persist the new one for later runs
+  if (!fileName.empty()) {
+    std::vector<unsigned char> binary;
+    if (_builder->getBinary(*program, &binary) == CL_SUCCESS && !binary.empty() &&
+        tensileMakeDirectories(cachePath) &&
+        tensileWriteFileAtomic(fileName, binary.data(), binary.size()))
+      _diskWrites++;
+  }
+  return CL_SUCCESS;
+}
+
+TensileStatus TensileProgramCache::createKernel(cl_command_queue queue, const char *source,
+                                                const char *buildOptions, cl_kernel *kernel) {
+  cl_program program;
+  const char *traceName;
+  TensileStatus status = getProgram(queue, source, buildOptions, &program, &traceName);
+  if (status != CL_SUCCESS)
+    return status;
+  TensileLoadTrace::Scope trace(TensileLoadFunctionResolve, traceName, -1);
+  return _builder->createKernel(program, kernel);
+}
+
+TensileProgramCache::Stats TensileProgramCache::stats() const {
+  Stats s;
+  s.hits         = _hits.load();
+  s.sourceBuilds = _sourceBuilds.load();
+  s.diskHits     = _diskHits.load();
+  s.diskWrites   = _diskWrites.load();
+  return s;
+}
+
+#endif
@@ -0,0 +1,189 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include "TensileTypes.h"
+#include "Tools.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <stdint.h>
+
+/*******************************************************************************
+ * OpenCL program cache - kernels compiled once per device for the whole process
+ *   - Programs are keyed by (context, device, source hash, build options) and
+ *     shared by every host thread ; each thread still creates its own
+ *     cl_kernel objects from them, since kernel arguments are per cl_kernel.
+ *   - If a cache directory is set (opt in, see OPENCL_CACHE_PATH), built
+ *     programs are persisted there as binaries (CL_PROGRAM_BINARIES) and
+ *     reloaded with clCreateProgramWithBinary by later runs. Files are
+ *     named after the source hash and a hash of the device name, driver
+ *     version and build options ; a binary that fails to load is rebuilt
+ *     from source and replaced.
+ *   - Compiling goes through the TensileProgramBuilder interface (OpenCL, or a
+ *     fake for CPU-only testing). Different programs build concurrently ;
+ *     threads needing a program being built wait for it.
+ ******************************************************************************/
+#if Tensile_RUNTIME_LANGUAGE_OCL
+
+// Directory of the compiled program binaries ; a leading ~ is the home directory.
+// Empty disables the disk cache. Can be overridden with TENSILE_OPENCL_CACHE_PATH env var,
+// ie TENSILE_OPENCL_CACHE_PATH=~/.cache/tensile/opencl
+#define OPENCL_CACHE_PATH ""
+
+class TensileProgramBuilder {
+public:
+  virtual ~TensileProgramBuilder() {};
+
+  virtual TensileStatus queueInfo(cl_command_queue queue, cl_context *context, cl_device_id *device) = 0;
+  // Identifies the compiler of device: binaries only load where the signature matches
+  virtual TensileStatus deviceSignature(cl_device_id device, std::string *signature) = 0;
+  virtual TensileStatus buildFromSource(cl_context context, cl_device_id device, const char *source,
+                                        const char *buildOptions, cl_program *program) = 0;
+  virtual TensileStatus buildFromBinary(cl_context context, cl_device_id device,
+                                        const unsigned char *binary, size_t size,
+                                        const char *buildOptions, cl_program *program) = 0;
+  virtual TensileStatus getBinary(cl_program program, std::vector<unsigned char> *binary) = 0;
+  virtual TensileStatus createKernel(cl_program program, cl_kernel *kernel) = 0;
+};
+
+class OclProgramBuilder : public TensileProgramBuilder {
+public:
+  TensileStatus queueInfo(cl_command_queue queue, cl_context *context, cl_device_id *device);
+  TensileStatus deviceSignature(cl_device_id device, std::string *signature);
+  TensileStatus buildFromSource(cl_context context, cl_device_id device, const char *source,
+                                const char *buildOptions, cl_program *program);
+  TensileStatus buildFromBinary(cl_context context, cl_device_id device,
+                                const unsigned char *binary, size_t size,
+                                const char *buildOptions, cl_program *program);
+  TensileStatus getBinary(cl_program program, std::vector<unsigned char> *binary);
+  TensileStatus createKernel(cl_program program, cl_kernel *kernel);
+};
+
+// Builder handing out distinct fake handles without an OpenCL runtime, for testing the
+// program sharing and the disk cache without a GPU. The binary of a program is its source.
+class FakeProgramBuilder : public TensileProgramBuilder {
+public:
+  FakeProgramBuilder() : _nextHandle(1), _sourceBuilds(0), _binaryBuilds(0), _kernels(0),
+                         _buildDelayUs(0) {};
+
+  TensileStatus queueInfo(cl_command_queue queue, cl_context *context, cl_device_id *device);
+  TensileStatus deviceSignature(cl_device_id device, std::string *signature);
+  TensileStatus buildFromSource(cl_context context, cl_device_id device, const char *source,
+                                const char *buildOptions, cl_program *program);
+  TensileStatus buildFromBinary(cl_context context, cl_device_id device,
+                                const unsigned char *binary, size_t size,
+                                const char *buildOptions, cl_program *program);
+  TensileStatus getBinary(cl_program program, std::vector<unsigned char> *binary);
+  TensileStatus createKernel(cl_program program, cl_kernel *kernel);
+
+  // Time each build takes, to widen the windows for concurrency tests
+  void setBuildDelayUs(unsigned int us) { _buildDelayUs = us; };
+  // Signature reported for every device, ie to simulate a driver update
+  void setSignature(const std::string &signature) {
+    std::lock_guard<std::mutex> lockGuard(_mutex);
+    _signature = signature;
+  };
+
+  uint64_t sourceBuilds() const { return _sourceBuilds.load(); };
+  uint64_t binaryBuilds() const { return _binaryBuilds.load(); };
+  uint64_t kernels() const { return _kernels.load(); };
+
+private:
+  std::mutex                            _mutex;
+  std::map<cl_program, std::string>     _sources;
+  std::string                           _signature;
+  std::atomic<uintptr_t>                _nextHandle;
+  std::atomic<uint64_t>                 _sourceBuilds;
+  std::atomic<uint64_t>                 _binaryBuilds;
+  std::atomic<uint64_t>                 _kernels;
+  unsigned int                          _buildDelayUs;
+};
+
+class TensileProgramCache {
+public:
+  static TensileProgramCache &instance();
+
+  // Replace the builder (not owned). Must be called before any program is built.
+  void setBuilder(TensileProgramBuilder *builder) { _builder = builder; };
+  TensileProgramBuilder *builder() const { return _builder; };
+
+  // Replace the disk cache directory, empty to disable it
+  void setCachePath(const std::string &cachePath);
+
+  // Program of source for the device of queue, built on first use (from the disk cache
+  // if possible). The program belongs to the cache and stays valid for the process.
+  TensileStatus getProgram(cl_command_queue queue, const char *source, const char *buildOptions,
+                           cl_program *program);
+
+  // New kernel of the program of source ; the caller owns the kernel
+  TensileStatus createKernel(cl_command_queue queue, const char *source, const char *buildOptions,
+                             cl_kernel *kernel);
+
+  struct Stats {
+    uint64_t hits;         // programs found already built in this process
+    uint64_t sourceBuilds; // programs compiled from source
+    uint64_t diskHits;     // programs loaded from a cached binary
+    uint64_t diskWrites;   // binaries written to the disk cache
+  };
+  Stats stats() const;
+
+private:
+  TensileProgramCache(TensileProgramBuilder *builder);
+
+  typedef std::tuple<cl_context, cl_device_id, uint64_t, std::string> ProgramKey;
+
+  struct Program {
+    Program() : _program(nullptr), _traceName(nullptr) {};
+    std::mutex  _buildMutex; // held while building so concurrent users wait
+    cl_program  _program;    // nullptr until built
+    const char *_traceName;  // interned kernel name for the load trace
+  };
+
+  // getProgram, also returning the name the loads of program are traced under
+  TensileStatus getProgram(cl_command_queue queue, const char *source, const char *buildOptions,
+                           cl_program *program, const char **traceName);
+
+  // Build program from the binary cached on disk, or from source, persisting the binary
+  TensileStatus build(cl_context context, cl_device_id device, const char *source,
+                      uint64_t sourceHash, const char *buildOptions, const char *traceName,
+                      cl_program *program);
+
+  TensileProgramBuilder                          *_builder;
+  mutable std::mutex                              _mutex;
+  std::map<ProgramKey, std::shared_ptr<Program> > _programs;
+  std::string                                     _cachePath;
+  std::atomic<uint64_t>                           _hits;
+  std::atomic<uint64_t>                           _sourceBuilds;
+  std::atomic<uint64_t>                           _diskHits;
+  std::atomic<uint64_t>                           _diskWrites;
+};
+
+#endif
+
+#endif
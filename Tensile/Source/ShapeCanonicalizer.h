@@ -0,0 +1,155 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+/*******************************************************************************
+ * Canonicalization of problem sizes for the lookup cache
+ *   - Sizes are rounded up with a rule per index class (batch, free, summation)
+ *     so problems that differ only in, for example, the batch count share one
+ *     cache entry.
+ *   - Rules are written "<class>:<rule>" separated by commas, where class is
+ *     batch, free or sum and rule is pow2 (round up to a power of two),
+ *     mult<N> (round up to a multiple of N) or none. ie "batch:pow2,sum:mult64"
+ *     N must be a power of two, like the element multiples in the assertion
+ *     requirements of the solutions.
+ *   - The SolutionMapper only uses the canonical entry if its solution meets the
+ *     assertion requirements of the exact problem.
+ ******************************************************************************/
+class ShapeCanonicalizer {
+public:
+  enum IndexClass {BatchIndex, FreeIndex, SummationIndex, NumIndexClasses};
+
+  ShapeCanonicalizer() : _enabled(false) {};
+
+  // Returns false if rules is malformed ; the rules parsed up to the error are kept
+  bool parse(const char *rules) {
+    std::string str(rules);
+    size_t pos = 0;
+    while (pos < str.size()) {
+      size_t end = str.find(',', pos);
+      if (end == std::string::npos)
+        end = str.size();
+      std::string item = str.substr(pos, end-pos);
+      pos = end+1;
+      if (item.empty())
+        continue;
+
+      size_t colon = item.find(':');
+      if (colon == std::string::npos)
+        return false;
+      std::string className = item.substr(0, colon);
+      std::string ruleName = item.substr(colon+1);
+
+      IndexClass indexClass;
+      if (className == "batch") indexClass = BatchIndex;
+      else if (className == "free") indexClass = FreeIndex;
+      else if (className == "sum") indexClass = SummationIndex;
+      else return false;
+
+      Rule rule;
+      if (ruleName == "none") {
+        rule._kind = Rule::None;
+      } else if (ruleName == "pow2") {
+        rule._kind = Rule::Pow2;
+      } else if (ruleName.compare(0, 4, "mult") == 0) {
+        char *numEnd;
+        unsigned long multiple = strtoul(ruleName.c_str()+4, &numEnd, 0);
+        if (*numEnd != 0 || multiple == 0 || (multiple & (multiple-1)) != 0 ||
+            multiple > 0x80000000ul)
+          return false;
+        rule._kind = Rule::Multiple;
+        rule._multiple = static_cast<unsigned int>(multiple);
+      } else {
+        return false;
+      }
+      _classRules[indexClass] = rule;
+    }
+
+    _enabled = false;
+    for (int c=0; c<NumIndexClasses; c++) {
+      _enabled |= (_classRules[c]._kind != Rule::None);
+    }
+    return true;
+  }
+
+  bool enabled() const { return _enabled; };
+
+  // Rules in a normal form, the same for every spelling of the same rules ; ie
+  // "sum:mult64,batch:pow2" gives "batch:pow2,free:none,sum:mult64"
+  std::string rulesString() const {
+    static const char *classNames[NumIndexClasses] = {"batch", "free", "sum"};
+    std::string str;
+    for (int c=0; c<NumIndexClasses; c++) {
+      const Rule &rule = _classRules[c];
+      str += std::string(c ? "," : "") + classNames[c] + ":";
+      if (rule._kind == Rule::Pow2)
+        str += "pow2";
+      else if (rule._kind == Rule::Multiple)
+        str += "mult" + std::to_string(rule._multiple);
+      else
+        str += "none";
+    }
+    return str;
+  }
+
+  void setIndexClass(int sizeIdx, IndexClass indexClass) {
+    if (sizeIdx >= int(_sizeClass.size()))
+      _sizeClass.resize(sizeIdx+1, FreeIndex);
+    _sizeClass[sizeIdx] = indexClass;
+  }
+
+  unsigned int canonicalize(int sizeIdx, unsigned int size) const {
+    const Rule &rule = _classRules[sizeIdx < int(_sizeClass.size()) ? _sizeClass[sizeIdx] : FreeIndex];
+    switch (rule._kind) {
+      case Rule::Pow2: {
+        if (size == 0 || size > 0x80000000u)
+          return size;
+        unsigned int p = 1;
+        while (p < size)
+          p <<= 1;
+        return p;
+      }
+      case Rule::Multiple: {
+        unsigned long long rounded = (size + rule._multiple - 1ull) / rule._multiple * rule._multiple;
+        return rounded > 0xFFFFFFFFull ? size : static_cast<unsigned int>(rounded);
+      }
+      case Rule::None:
+      default:
+        return size;
+    }
+  }
+
+private:
+  struct Rule {
+    Rule() : _kind(None), _multiple(1) {};
+    enum Kind {None, Pow2, Multiple} _kind;
+    unsigned int _multiple;
+  };
+
+  bool                    _enabled;
+  Rule                    _classRules[NumIndexClasses];
+  std::vector<IndexClass> _sizeClass;
+};
@@ -20,9 +20,12 @@
 *******************************************************************************/
 
 #include "SolutionHelper.h"
+#include "LoadTrace.h"
+#include "ModuleRegistry.h"
+#include "Preloader.h"
+#include "ProgramCache.h"
 #include "Tools.h"
 #include <mutex>
-#include <unistd.h>
 
 #ifdef WIN32
 __declspec(thread) KernelMap kernelMap;
@@ -48,52 +51,10 @@ void tensileGetCompiledOpenCLKernel(
     return;
   }
 
-  // need to compile kernel
-  cl_int status;
-  cl_context clContext;
-  cl_device_id clDevice;
-  status = clGetCommandQueueInfo(queue, CL_QUEUE_CONTEXT,
-      sizeof(clContext), &clContext, NULL);
-  tensileStatusCheck(status)
-    status = clGetCommandQueueInfo(queue, CL_QUEUE_DEVICE,
-        sizeof(clDevice), &clDevice, NULL);
-  tensileStatusCheck(status)
-
-  cl_program clProgram;
-  clProgram = clCreateProgramWithSource(
-    clContext,
-    1, &kernelSource,
-    NULL, &status );
-  tensileStatusCheck(status)
-  status = clBuildProgram(
-    clProgram,
-    1, &clDevice,
-    sourceBuildOptions, NULL, NULL );
-  tensileStatusCheck(status)
-
-  // print build failure
-  if (status != CL_SUCCESS) {
-    printf("clBuildProgram Failed with status = %d\n", status);
-
-    size_t len = 0;
-    clGetProgramBuildInfo(clProgram, clDevice, CL_PROGRAM_BUILD_LOG,
-        0, NULL, &len);
-    char* buildLog = new char[len];
-    clGetProgramBuildInfo(clProgram, clDevice, CL_PROGRAM_BUILD_LOG,
-        len*sizeof(char), buildLog, 0);
-    printf("\n\n\nBuild Log:\n\n");
-    printf("%s\n", buildLog);
-    printf("\n");
-    printf("\nKernel Source:\n\n");
-    printf("%s\n", kernelSource);
-    delete[] buildLog;
-  }
-  status = clCreateKernelsInProgram(
-    clProgram,
-    1, kernel,
-    NULL );
-  tensileStatusCheck(status)
-  status = clReleaseProgram(clProgram);
+  // The program is compiled once for all threads (or loaded from the disk cache) ;
+  // each thread creates its own kernel since kernel arguments are set per cl_kernel
+  TensileStatus status = TensileProgramCache::instance().createKernel(
+      queue, kernelSource, sourceBuildOptions, kernel);
   tensileStatusCheck(status)
 
   // put kernel in map
@@ -107,51 +68,42 @@ void tensileGetCompiledOpenCLKernel(
 #if Tensile_RUNTIME_LANGUAGE_HIP
 TensileStatus SolutionLock::getFunction(hipFunction_t *f, int deviceId,
                                      const std::string &kernelName,
-                                     const unsigned char *codeFromExe)
+                                     const unsigned char *codeFromExe,
+                                     TensileModulePin *pin)
 {
-  hipError_t e = hipSuccess;
   *f = nullptr;
+  TensileModulePin localPin; // unpinned on return if the caller does not pin
+  if (pin == nullptr)
+    pin = &localPin;
 
-  auto t = _deviceFunctions.load(std::memory_order_relaxed);
-  std::atomic_thread_fence(std::memory_order_acquire);
+  auto t = _deviceFunctions.load(std::memory_order_acquire);
   if (t == nullptr) {
     std::lock_guard<std::mutex> initFunctionsLock(_initFunctionsMutex);
-    auto t = _deviceFunctions.load(std::memory_order_relaxed);
+    t = _deviceFunctions.load(std::memory_order_relaxed);
     if (t == nullptr) {
-      int numDevices = -1;
-      e = hipGetDeviceCount( &numDevices );
-      if (e) { return e; };
+      int numDevices = TensileDeviceContext::instance().deviceCount();
+      if (numDevices <= 0) { return tensileStatusFailure; };
 
-      t = new hipFunction_t[numDevices];
-      for ( int i = 0; i < numDevices; i++) {
-        t[i] = nullptr;
-      }
-      std::atomic_thread_fence(std::memory_order_release);
-      _deviceFunctions.store(t, std::memory_order_relaxed);
+      t = new TensileResidentFunction[numDevices];
+      _deviceFunctions.store(t, std::memory_order_release);
     }
   }
 
-  if ( !_deviceFunctions[deviceId] ) {
-    std::lock_guard<std::mutex> loadModuleLock(_loadModuleMutex);
-    hipModule_t module = nullptr;
-    if (!_deviceFunctions[deviceId]) {
-      if (codeFromExe == nullptr) {
-        std::string pk1 = "assembly/" + kernelName + ".co";
-        std::string pk2 = "../source/assembly/" + kernelName + ".co";
-        if (access(pk2.c_str(), R_OK) != 0)
-          e = hipModuleLoad(&module, pk1.c_str());
-        else
-          e = hipModuleLoad(&module, pk2.c_str());
-      } else {
-        e = hipModuleLoadData(&module, codeFromExe);
-      }
-      if (e) { return e; };
-      e = hipModuleGetFunction(&_deviceFunctions[deviceId], module, kernelName.c_str());
+  TensileModuleRegistry &registry = TensileModuleRegistry::instance();
+  if ( !registry.pin(t[deviceId], pin, f) ) {
+    TensilePreloader::DemandScope demand; // background preloads yield to this load
+    TensileLoadTrace::lock(_loadModuleMutex, TensileLoadTrace::instance().intern(kernelName), deviceId);
+    std::lock_guard<std::mutex> loadModuleLock(_loadModuleMutex, std::adopt_lock);
+    if (!registry.pin(t[deviceId], pin, f)) {
+      // The module is shared with every other solution using the same code object
+      // and stays loaded until evicted to fit MODULE_MEMORY_BUDGET. Code object files
+      // are found in the search path of the registry (CODE_OBJECT_PATH).
+      hipError_t e = registry.resolveResident(deviceId, kernelName + ".co", codeFromExe,
+                                              kernelName.c_str(), &t[deviceId], pin, f);
       if (e) { return e; };
     }
   }
-  *f = _deviceFunctions[deviceId];
-  return e;
+  return tensileStatusSuccess;
 }
 
 #endif
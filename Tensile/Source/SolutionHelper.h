@@ -23,12 +23,15 @@
 #define SOLUTION_HELPER_H
 
 #include "TensileTypes.h"
+#include "DeviceContext.h"
+#include "ModuleRegistry.h"
 #include <map>
 #include <unordered_map>
 #include <string>
 #include <tuple>
 #include <mutex>
 #include <atomic>
+#include <cstring>
 
 /*******************************************************************************
  * Helper classes for locking, tracking, and getting solutions.
@@ -50,21 +53,37 @@ typedef hipFunction_t DeviceFunctionType;
 
 // Locks and tracker for kernel loading status
 struct SolutionLock {
+#if Tensile_RUNTIME_LANGUAGE_HIP
+  // Function of each device, resolved again when its module is evicted
+  typedef TensileResidentFunction DeviceFunctionSlot;
+#else
+  typedef DeviceFunctionType DeviceFunctionSlot;
+#endif
+
   SolutionLock() : _deviceFunctions(nullptr)
   {
   };
 
-  SolutionLock(const SolutionLock &other) {
-    _deviceFunctions.store(other._deviceFunctions.load());
+  // Copies start without functions ; they are resolved again on first use
+  SolutionLock(const SolutionLock &other) : _deviceFunctions(nullptr)
+  {
   };
 
+  ~SolutionLock() {
+    delete[] _deviceFunctions.load();
+  };
 
-  std::atomic<DeviceFunctionType*> _deviceFunctions;
+  std::atomic<DeviceFunctionSlot*> _deviceFunctions;
   std::mutex _initFunctionsMutex;
   std::mutex _loadModuleMutex;
 
-  // if codeFromExe==nullptr then load code from file using kernelName
-  TensileStatus getFunction(DeviceFunctionType *f, int deviceId, const std::string &kernelName, const unsigned char *codeFromExe);
+#if Tensile_RUNTIME_LANGUAGE_HIP
+  // if codeFromExe==nullptr then load code from file using kernelName.
+  // The module of the function is pinned with pin (if not nullptr) until the pin is
+  // destroyed: hold it across the launch so the module can not be evicted under it.
+  TensileStatus getFunction(DeviceFunctionType *f, int deviceId, const std::string &kernelName,
+                            const unsigned char *codeFromExe, TensileModulePin *pin = nullptr);
+#endif
 };
 
 #ifdef WIN32
@@ -103,6 +122,43 @@ struct SolutionInfo {
   // The structure here captures those requirements - they will be checked before
   // launching the kernel
   ProblemProperties     _assertionRequirements;
+
+  // Macro tile of the solution in the free0 and free1 dimensions, used to
+  // estimate the tile efficiency of a problem. 0 if unknown.
+  unsigned int          _macroTile0;
+  unsigned int          _macroTile1;
+
+  // Kernel loaded by SolutionLock::getFunction and its code object embedded in the
+  // library (nullptr if loaded from file), so the kernel can be loaded before the first
+  // launch. _kernelName is nullptr if the solution has no code object to load.
+  const char *          _kernelName;
+  const unsigned char * _codeObject;
+
+  // Launch of the solution split in two, see SolutionLaunch: _planFunctionPtr computes
+  // the launch of a problem and _executeFunctionPtr enqueues it. nullptr if the solution
+  // can only be launched through _functionPtr.
+  void *                  _planFunctionPtr;
+  void *                  _executeFunctionPtr;
+};
+
+/*******************************************************************************
+ * Precomputed launch of a solution for one problem
+ *   - Holds everything about a launch that only depends on the problem dims:
+ *     the device, grid and work-group sizes, and the kernel argument struct
+ *     with everything but the data pointers and alpha/beta filled in.
+ *   - Filled by the plan function of a solution, then enqueued any number of
+ *     times by its execute function, which patches the data pointers and
+ *     alpha/beta into a copy of the arguments. See TensilePlan.
+ ******************************************************************************/
+// Largest kernel argument struct a launch can hold, in bytes
+#define SOLUTION_LAUNCH_ARGS_BYTES 512
+
+struct SolutionLaunch {
+  int      _deviceId;
+  size_t   _globalWorkSize[3]; // in work-items
+  size_t   _localWorkSize[3];
+  size_t   _argsSize;
+  uint64_t _args[SOLUTION_LAUNCH_ARGS_BYTES/sizeof(uint64_t)];
 };
 
 #endif
@@ -22,6 +22,18 @@
 #pragma once
 
 #include <limits>
+#include "SolutionMapperDistance.h"
+#include "LookupCache.h"
+#include "ShapeCanonicalizer.h"
+#include "LookupStats.h"
+#include "Tools.h"
+#include "DeviceContext.h"
+#include "Preloader.h"
+#include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 /*******************************************************************************
  * Functions to map from ProblemDims to the best available solution
  *   - Provides efficient hash tables for lookup with thread-safe access
@@ -36,6 +48,26 @@
 // DEBUG_SM sets compile-time default - also can use TENSILE_DB env var with same encoding
 #define DEBUG_SM 0
 
+// Nearest-match algorithm (see SolutionMapperRuntime::Algo) used by the range logic algorithm
+// when there is no range logic or its solution is not valid for the problem.
+// Can be overridden with TENSILE_RANGE_FALLBACK_ALG env var.
+#define RANGE_FALLBACK_ALG -4
+
+// Default max number of cached problem->solution lookups per SolutionMapper, 0=unbounded.
+// Can be overridden with TENSILE_LOOKUP_CACHE_SIZE env var.
+#define LOOKUP_CACHE_SIZE 16384
+
+// Runtime autotuning of shapes that are not in the exact table:
+// number of candidate solutions timed for each new shape, 0=autotuning disabled.
+// Can be overridden with TENSILE_AUTOTUNE env var.
+#define AUTOTUNE_CANDIDATES 0
+// Number of timed launches of each candidate, the fastest one counts
+#define AUTOTUNE_TRIALS 2
+
+// Default rules to canonicalize problem sizes before caching lookups, see ShapeCanonicalizer.h.
+// Can be overridden with TENSILE_CANONICALIZE env var, ie TENSILE_CANONICALIZE=batch:pow2
+#define CANONICALIZE_RULES ""
+
 class SolutionMapperRuntime {
 public:
   // Runtime information for the solution:
@@ -48,16 +80,93 @@ public:
     SolutionLock _lock;
     bool isValid() const { return _info != nullptr; };
   };
+
+  // Ranked candidate solution for a problem, see getCandidates
+  struct SolutionCandidate {
+    SolutionRuntime *_solution;
+    double           _distance; // distance to the closest exact entry using the solution
+    bool             _valid;    // solution meets the assertion requirements of the problem
+  };
 protected:
-  enum Algo {PickNoneAlgo= -1, RandomAlgo= -2, RatioDistanceAlgo= -3, EuclideanDistanceAlgo= -4, ManhattanDistanceAlgo= -5};
+  enum Algo {PickNoneAlgo= -1, RandomAlgo= -2, RatioDistanceAlgo= -3, EuclideanDistanceAlgo= -4, ManhattanDistanceAlgo= -5,
+             RangeLogicAlgo= -6, PerformanceModelAlgo= -7};
 };
 
 
+//--------------------
+// Launch plan of one problem, see tensileCreatePlan_<ProblemType>:
+// the solution is looked up once, on the device current when the plan is created,
+// and the launch is precomputed if the solution supports it (see SolutionLaunch).
+template <unsigned int NumDims>
+struct TensilePlan {
+  SolutionMapperRuntime::SolutionRuntime *_solution;
+  unsigned int   _dims[NumDims]; // strides then sizes, as passed to tensileCreatePlan
+  bool           _precomputed;   // _launch is valid, else launch through the solution function
+  SolutionLaunch _launch;
+};
+
+//--------------------
+// Launch order of a grouped call, see tensileGrouped_<ProblemType>: problems sharing a
+// solution are launched back-to-back, groups in order of their first problem and the
+// problems of a group in their original order.
+// order receives numProblems indices into solutions.
+inline void groupBySolution(size_t numProblems,
+                            SolutionMapperRuntime::SolutionRuntime *const *solutions,
+                            unsigned int *order) {
+  std::unordered_map<const SolutionMapperRuntime::SolutionRuntime *, size_t> groupOf;
+  std::vector<size_t> group(numProblems);
+  for (size_t i=0; i<numProblems; i++) {
+    group[i] = groupOf.emplace(solutions[i], groupOf.size()).first->second;
+    order[i] = static_cast<unsigned int>(i);
+  }
+  std::stable_sort(order, order+numProblems,
+                   [&group](unsigned int a, unsigned int b) { return group[a] < group[b]; });
+}
+
 template <class ProblemDimsType>
 class SolutionMapperBase : public SolutionMapperRuntime {
 public:
   
   virtual SolutionMapperRuntime::SolutionRuntime * getSolution(ProblemDimsType &pdims) = 0;
+
+  // Batch version of getSolution: solutions[i] is set for pdims[i], nullptr if none found
+  virtual void getSolutions(const ProblemDimsType *pdims, size_t numProblems,
+                            SolutionMapperRuntime::SolutionRuntime **solutions) = 0;
+
+  // Fills candidates[0,k) with the solutions closest to pdims, best first, and returns
+  // the number written. Each solution appears once. Invalid solutions are only
+  // included if includeInvalid is set.
+  virtual size_t getCandidates(const ProblemDimsType &pdims, size_t k,
+                               SolutionMapperRuntime::SolutionCandidate *candidates,
+                               bool includeInvalid) = 0;
+
+  // Autotuning: when a problem is being tuned, getSolutionForLaunch hands out the
+  // candidates in turn with an active trial. The caller times the launch and passes
+  // the result to reportTrial on the trial's mapper. Once every candidate has been
+  // timed the fastest is cached as a preferred lookup cache entry (see cacheSolution).
+  // Problems sharing a canonical bucket (see findAndCacheAlgorithm) are tuned together.
+  struct AutotuneTrial {
+    AutotuneTrial() : _mapper(nullptr), _solutionIdx(-1) {};
+    bool active() const { return _mapper != nullptr; };
+
+    SolutionMapperBase *_mapper;
+    int                 _solutionIdx;
+  };
+
+  // Same as getSolution, but may return an autotuning candidate (see AutotuneTrial)
+  virtual SolutionMapperRuntime::SolutionRuntime * getSolutionForLaunch(ProblemDimsType &pdims,
+                                                                        AutotuneTrial *trial) = 0;
+
+  // elapsedMs is +inf if the launch failed
+  virtual void reportTrial(const ProblemDimsType &pdims, const AutotuneTrial &trial,
+                           double elapsedMs) = 0;
+
+  // Allocate the runtime state of the mapper. Mappers are constructed as lightweight
+  // descriptors at load time and only materialized once a device is found that uses them.
+  virtual void materialize() = 0;
+
+  // Queue the solutions selected by the preloader for loading on deviceId
+  virtual void addPreloads(int deviceId, TensilePreloader &preloader) = 0;
 };
 
 //--------------------
@@ -73,8 +182,7 @@ public:
   };
 
   void initialize() {
-    int numDevices;
-    hipGetDeviceCount(&numDevices);
+    int numDevices = TensileDeviceContext::instance().deviceCount();
     _mapper.resize(numDevices);
     for (int i=0; i<numDevices; i++) {
       _mapper[i] = nullptr;
@@ -87,9 +195,7 @@ public:
 
     // walk through each device and if name matches then
     for (int i=0; i<_mapper.size(); i++) {
-      hipDeviceProp_t deviceProperties;
-      hipGetDeviceProperties(&deviceProperties, i);
-      std::string deviceName(deviceProperties.name);
+      const std::string &deviceName = TensileDeviceContext::instance().properties(i)._name;
 
       if ((deviceName == mapperName)) { 
         matches++;
@@ -107,14 +213,15 @@ public:
         }
       }
     }
+    if (matches) {
+      mapper->materialize();
+    }
     return matches;
   }
 
   SolutionMapperBase<ProblemDimsType> *mapper()
   {
-    int deviceId;
-    hipGetDevice(&deviceId);
-    return _mapper[deviceId];
+    return _mapper[TensileDeviceContext::instance().currentDevice()];
   }
 
   SolutionMapperBase<ProblemDimsType> *fallbackMapper()
@@ -122,6 +229,15 @@ public:
     return _fallbackMapper;
   }
 
+  // Queue the solutions of the mapper of every device for background loading
+  void addPreloads(TensilePreloader &preloader)
+  {
+    for (int i=0; i<_mapper.size(); i++) {
+      if (_mapper[i] != nullptr)
+        _mapper[i]->addPreloads(i, preloader);
+    }
+  }
+
 private:
   // Index is deviceId, points at the mapper to use for that device.
   std::vector <SolutionMapperBase<ProblemDimsType>*> _mapper;
@@ -135,44 +251,144 @@ private:
 // This provides mappings for a single device type
 template <class ProblemDimsType, class ProblemKeyType>
 class SolutionMapper : public SolutionMapperBase<ProblemDimsType> {
-  // Problem to Solution mapping:
-  typedef std::pair<const ProblemKeyType, int>  PtoS;
+  // An exact table and the search structures derived from it, which are built once on
+  // first use. Never modified otherwise: loading a logic file publishes a new ExactTable
+  // and searches already running keep the one they started with.
+  struct ExactTable {
+    ExactTable(const ExactTableData &data, uint64_t hash)
+      : _data(data), _hash(hash), _derivedBytes(0) {};
 
-public:
-  SolutionMapper(const std::string &name, 
-                 const SolutionInfo *solutionTable, size_t numSolutions,
-                 const PtoS *embeddedExactTable, size_t numExacts,
-                 const ProblemType *problemType)
-     :  _name(name), _problemType(problemType), _numSolutions(numSolutions),
-        _findAlg(SolutionMapperRuntime::EuclideanDistanceAlgo), _db(DEBUG_SM)
-  {
+    size_t numExacts() const { return _data.numExacts; };
+    unsigned int size(size_t exactIdx, int si) const { return _data.sizes[si*_data.numExacts + exactIdx]; };
+    const unsigned int *sizeRow(int si) const { return &_data.sizes[si*_data.numExacts]; };
+    int solutionIdx(size_t exactIdx) const { return _data.solutionIdx[exactIdx]; };
+    float gflops(size_t exactIdx) const { return _data.gflops[exactIdx]; };
 
-    _solutionTable = new SolutionMapperRuntime::SolutionRuntime[numSolutions];
+    // Lexicographic compare of the sizes of an entry with pkey, <0 / 0 / >0
+    int compare(size_t exactIdx, const ProblemKeyType &pkey) const {
+      for (int si=0; si<ProblemKeyType::staticNumSizes(); si++) {
+        unsigned int s = size(exactIdx, si);
+        if (s != pkey.sizes(si))
+          return s < pkey.sizes(si) ? -1 : 1;
+      }
+      return 0;
+    }
 
-    for (size_t i=0; i<numSolutions; i++) {
-      _solutionTable[i]._info = &solutionTable[i];
+    ProblemKeyType key(size_t exactIdx) const {
+      typename ProblemKeyType::SizeType sizes[ProblemKeyType::staticNumSizes()];
+      for (int si=0; si<ProblemKeyType::staticNumSizes(); si++) {
+        sizes[si] = size(exactIdx, si);
+      }
+      const typename ProblemKeyType::SizeType *csizes = sizes;
+      return ProblemKeyType(csizes, false);
     }
 
-    for (size_t i=0; i<numExacts; i++) {
-      auto &pkey = embeddedExactTable[i].first;
-      auto solutionIdx = embeddedExactTable[i].second;
-      auto const &solution = solutionTable[solutionIdx];
+    // Log of every size in the layout of the sizes, for the ratio-distance scans.
+    // Floats halve the footprint ; the scans widen them back to double.
+    const float *logSizeRow(int si) const {
+      std::call_once(_logOnce, [this]() {
+        size_t n = size_t(ProblemKeyType::staticNumSizes()) * _data.numExacts;
+        _logSizes.resize(n);
+        for (size_t i=0; i<n; i++) {
+          _logSizes[i] = float(::log(double(_data.sizes[i])));
+        }
+        _derivedBytes.fetch_add(n * sizeof(float));
+      });
+      return &_logSizes[si*_data.numExacts];
+    }
 
-      _exactVector.push_back(embeddedExactTable[i]);
-      _exactMap.insert({pkey, solutionIdx});
+    // Bytes used by the table and the structures derived from it so far
+    size_t memoryBytes() const {
+      return _data.numExacts * (ProblemKeyType::staticNumSizes() * sizeof(unsigned int) +
+                                sizeof(int) + sizeof(float)) + _derivedBytes.load();
     }
 
+    ExactTableData        _data;
+    uint64_t              _hash; // 0 for the embedded table, else hash of the logic file
+
+    // Owner of the arrays of tables loaded from a logic file: remapped copies, or the
+    // mapped file if the arrays are used in place
+    std::vector<unsigned int>          _sizeStorage;
+    std::vector<int>                   _solutionIdxStorage;
+    std::vector<float>                 _gflopsStorage;
+    std::unique_ptr<TensileMappedFile> _file;
+
+    mutable std::once_flag      _logOnce;
+    mutable std::vector<float>  _logSizes;
+
+    // Sorted hashes of the canonical keys of the entries, see bucketHasExactEntries
+    mutable std::once_flag      _bucketsOnce;
+    mutable std::vector<size_t> _bucketHashes;
+
+    mutable std::atomic<size_t> _derivedBytes;
+  };
+
+public:
+  // Only records the (static, generated) tables - runtime state is allocated by materialize()
+  SolutionMapper(const char *name,
+                 const SolutionInfo *solutionTable, size_t numSolutions,
+                 const ExactTableData *embeddedExactTable,
+                 const ProblemType *problemType,
+                 const RangeLogic *rangeLogic,
+                 uint64_t libraryHash)
+     :  _name(name), _problemType(problemType),
+        _solutionInfo(solutionTable), _solutionTable(nullptr), _numSolutions(numSolutions),
+        _embeddedExactTable(embeddedExactTable),
+        _tableGeneration(0),
+        _rangeLogic(rangeLogic),
+        _autotuneCandidates(AUTOTUNE_CANDIDATES),
+        _libraryHash(libraryHash),
+        _findAlg(rangeLogic ? SolutionMapperRuntime::RangeLogicAlgo : SolutionMapperRuntime::EuclideanDistanceAlgo),
+        _rangeFallbackAlg(RANGE_FALLBACK_ALG),
+        _db(DEBUG_SM)
+  {
+    // Parsed here rather than in materialize: initializeMappers runs first and prints with it
     const char *db = std::getenv("TENSILE_DB");
     if (db) {
       _db = strtol(db,nullptr,0);
     }
+  }
 
-    const char *alg = std::getenv("TENSILE_FIND_ALG"); // If <0 see Algo enumeration, or >=0 specified specific solution index
-    if (alg) {
-      _findAlg = strtol(alg,nullptr,0);
+  // Called by MasterSolutionMapper::addMapper for each device using this mapper; only the
+  // first call does any work.
+  void materialize() {
+    std::call_once(_materializeOnce, &SolutionMapper::materializeOnce, this);
+  }
+
+  void addPreloads(int deviceId, TensilePreloader &preloader) {
+    materialize();
+
+    std::vector<size_t> selected;
+    if (preloader.mode() == TensilePreloader::Top) {
+      // Solutions winning the most exact entries first
+      std::shared_ptr<const ExactTable> table = exactTable();
+      std::vector<size_t> wins(_numSolutions);
+      for (size_t i=0; i<table->numExacts(); i++) {
+        wins[table->solutionIdx(i)]++;
+      }
+      for (size_t s=0; s<_numSolutions; s++) {
+        if (wins[s])
+          selected.push_back(s);
+      }
+      std::stable_sort(selected.begin(), selected.end(),
+                       [&](size_t a, size_t b) { return wins[a] > wins[b]; });
+      if (selected.size() > preloader.topN())
+        selected.resize(preloader.topN());
+    } else {
+      for (size_t s=0; s<_numSolutions; s++) {
+        if (preloader.mode() == TensilePreloader::All ||
+            (preloader.mode() == TensilePreloader::List && preloader.listed(_solutionInfo[s])))
+          selected.push_back(s);
+      }
+    }
+
+    for (auto iter=selected.begin(); iter!=selected.end(); iter++) {
+      preloader.add(&_solutionTable[*iter]._lock, &_solutionInfo[*iter], deviceId);
+    }
+    if (_db & 0x8) {
+      printf ("info: %s queued %zu solutions for preloading on device %d\n",
+              _name, selected.size(), deviceId);
     }
-    if (_db & 0x1)
-      printf ("TENSILE_FIND_ALGO= %d (%s)\n", _findAlg, algoString(_findAlg));
   }
 
   void initializeMappers(const std::vector<std::string> &deviceNames,
@@ -184,16 +400,22 @@ public:
     }
 
     if (_db & 0x8) {
-      printf ("info: mapper init - %s was used in %d devices\n", _name.c_str(), used);
+      printf ("info: mapper init - %s was used in %d devices\n", _name, used);
     }
     if (used==0) {
       if (_db & 0x8) {
-        printf ("info: **skipping mapper init - no devices of type: %s found\n", _name.c_str());
+        printf ("info: **skipping mapper init - no devices of type: %s found\n", _name);
       }
       return;
     }
   }
 
+  ~SolutionMapper() {
+    if (!_lookupCacheFile.empty()) {
+      saveLookupCache(_lookupCacheFile);
+    }
+  }
+
 #define CASE_STRING(X)  case X: return(#X)
   const char *algoString(int algo) 
   {
@@ -206,25 +428,40 @@ public:
       CASE_STRING(SolutionMapperRuntime::RatioDistanceAlgo);
       CASE_STRING(SolutionMapperRuntime::EuclideanDistanceAlgo);
       CASE_STRING(SolutionMapperRuntime::ManhattanDistanceAlgo);
+      CASE_STRING(SolutionMapperRuntime::RangeLogicAlgo);
+      CASE_STRING(SolutionMapperRuntime::PerformanceModelAlgo);
       default: return ("Unknown Algo");
     };
   };
 
   // Returns integer solutionIdx if exact match is found else -1
+  // Binary search of the sorted exact table
   int findExactMatch(const ProblemProperties  &pa,
                      const ProblemKeyType &pkey) const
   {
-    auto fiter = _exactMap.find(pkey);
-    if (fiter != _exactMap.end()) {
-      if (pa.validForSolution(getSolution(fiter->second)->_info->_assertionRequirements)) {
-        return fiter->second;
+    std::shared_ptr<const ExactTable> table = exactTable();
+    const size_t numExacts = table->numExacts();
+
+    // lower_bound on the entry index
+    size_t first = 0, count = numExacts;
+    while (count > 0) {
+      size_t step = count / 2;
+      if (table->compare(first + step, pkey) < 0) {
+        first += step + 1;
+        count -= step + 1;
       } else {
-        //printf ("Possible exact match %d failed assertion requirements\n", fiter->second);
-        return -1;
+        count = step;
       }
-    } else {
-      return -1;
     }
+
+    for (size_t i=first; i<numExacts && table->compare(i, pkey) == 0; i++) {
+      int solutionIdx = table->solutionIdx(i);
+      if (pa.validForSolution(_solutionInfo[solutionIdx]._assertionRequirements)) {
+        return solutionIdx;
+      }
+      //printf ("Possible exact match %d failed assertion requirements\n", solutionIdx);
+    }
+    return -1;
   }
 
   // Iterates through all known exact matching and finds the 'closest' match.
@@ -234,27 +471,29 @@ public:
                        DistanceFunction distanceF) const
   {
 
-    auto bestIter = _exactVector.end();
+    int bestIdx = -1;
     double bestDistance = std::numeric_limits<double>::max();
 
-    for (auto iter = _exactVector.begin(); iter != _exactVector.end(); iter++) {
-      auto tableP = iter->first;
-      auto solutionInfo= getSolution(iter->second)->_info;
+    std::shared_ptr<const ExactTable> table = exactTable();
+    for (size_t i=0; i<table->numExacts(); i++) {
+      ProblemKeyType tableP(table->key(i));
+      int solutionIdx = table->solutionIdx(i);
+      auto solutionInfo= &_solutionInfo[solutionIdx];
       if (pa.validForSolution(solutionInfo->_assertionRequirements)) {
         double distance = distanceF(pkey, tableP);
         if (distance < bestDistance) {
           bestDistance = distance;
-          bestIter = iter;
+          bestIdx = solutionIdx;
           if (_db & 0x2) {
-            std::cerr << " solutionIdx=" << iter->second << " pdims={";
-            iter->first.print(std::cerr);
+            std::cerr << " solutionIdx=" << solutionIdx << " pdims={";
+            tableP.print(std::cerr);
             std::cerr << "}";
             std::cerr << " distance=" << distance << "        <------------- newBest" << "\n";
           }
         } else {
           if (_db & 0x4) {
-            std::cerr << " solutionIdx=" << iter->second << " pdims={";
-            iter->first.print(std::cerr);
+            std::cerr << " solutionIdx=" << solutionIdx << " pdims={";
+            tableP.print(std::cerr);
             std::cerr << "}";
             std::cerr << " distance=" << distance << "\n";
           }
@@ -262,20 +501,370 @@ public:
       }
     }
 
-    if (bestIter != _exactVector.end())
-      return bestIter->second;
+    return bestIdx; // -1 if no solutions in the table
+  };
+
+  // Query value for a scan of the size rows, or of the log rows if ratio. Logs are
+  // rounded through float like the rows so that an identical size is at distance 0.
+  static double ratioQuery(unsigned int size, bool ratio)
+  {
+    return ratio ? double(float(::log(double(size)))) : double(size);
+  }
+
+  // Bound on the difference between a ratio distance of the log rows and RatioDistance,
+  // per size: the two logs are rounded to float (half an ulp, below 1e-6 for the logs of
+  // 32-bit sizes), the double operations add much less.
+  static double ratioTolerance()
+  {
+    return 4e-6 * ProblemKeyType::staticNumSizes();
+  }
+
+  // Same result as findNearestMatch with Euclidean, Manhattan or Ratio distance, but
+  // evaluates blocks of candidates from the SoA tables with the SIMD distance kernels.
+  // Euclidean and Manhattan distances are bit-identical to the scalar functors. Ratio
+  // distances from the float logs are approximate, so the candidates of each block that
+  // may be closest within ratioTolerance are rescored with RatioDistance, in entry order.
+  int findNearestMatchSoA(const ProblemProperties &pa,
+                          const ProblemKeyType &pkey,
+                          int algo) const
+  {
+    using namespace SolutionMapperDistance;
+
+    std::shared_ptr<const ExactTable> exacts = exactTable();
+    const size_t numExacts = exacts->numExacts();
+    const int numSizes = ProblemKeyType::staticNumSizes();
+
+    const bool ratio = (algo != SolutionMapperRuntime::EuclideanDistanceAlgo &&
+                        algo != SolutionMapperRuntime::ManhattanDistanceAlgo);
+    const Metric metric = (algo == SolutionMapperRuntime::EuclideanDistanceAlgo) ? SqrDiff : AbsDiff;
+
+    // Solutions are far fewer than exact entries - check assertions once per solution.
+    // Candidates failing the assertion requirements start at +inf and never win.
+    std::vector<double> initDistance(_numSolutions);
+    for (size_t s=0; s<_numSolutions; s++) {
+      bool valid = pa.validForSolution(_solutionInfo[s]._assertionRequirements);
+      initDistance[s] = !valid ? std::numeric_limits<double>::infinity() : ratio ? 1.0 : 0.0;
+    }
+
+    std::vector<double> query(numSizes);
+    for (int si=0; si<numSizes; si++) {
+      query[si] = ratioQuery(pkey.sizes(si), ratio);
+    }
+
+    double dist[BlockSize];
+    int bestIdx = -1;
+    double bestDistance = std::numeric_limits<double>::max();
+    for (size_t blockStart=0; blockStart<numExacts; blockStart+=BlockSize) {
+      int n = int(std::min<size_t>(BlockSize, numExacts - blockStart));
+
+      for (int i=0; i<n; i++) {
+        dist[i] = initDistance[exacts->solutionIdx(blockStart + i)];
+      }
+      for (int si=0; si<numSizes; si++) {
+        if (ratio)
+          accumulate(metric, dist, exacts->logSizeRow(si) + blockStart, query[si], n);
+        else
+          accumulate(metric, dist, exacts->sizeRow(si) + blockStart, query[si], n);
+      }
+
+      // Strict compare keeps the earliest entry on ties, same as the scalar scan
+      double blockBest = minimum(dist, n);
+      if (ratio) {
+        // The closest entry of the block is within tolerance of blockBest, and can only
+        // win if it is closer than bestDistance
+        const double tolerance = ratioTolerance();
+        const double threshold = std::min(bestDistance, blockBest + tolerance) + tolerance;
+        if (blockBest == std::numeric_limits<double>::max() || blockBest - tolerance >= bestDistance)
+          continue;
+        for (int i=0; i<n; i++) {
+          if (dist[i] <= threshold) {
+            double distance = RatioDistance<ProblemKeyType>()(pkey, exacts->key(blockStart + i));
+            if (distance < bestDistance) {
+              bestDistance = distance;
+              bestIdx = int(blockStart) + i;
+            }
+          }
+        }
+      } else if (blockBest < bestDistance) {
+        bestDistance = blockBest;
+        bestIdx = int(blockStart) + firstIndexOf(dist, n, blockBest);
+      }
+    }
+
+    if (bestIdx != -1)
+      return exacts->solutionIdx(bestIdx);
     else
       return -1; // if no solutions in the table
   };
 
+  // Top-k solutions by the distance of their closest exact entry to the problem.
+  // Uses the mapper's distance algorithm (ratio distance for the algorithms that are
+  // not distance based). A bounded max-heap holds the k best during the selection.
+  // Ties go to the solution of the earliest entry and ratio distances are rescored with
+  // RatioDistance, so the first valid candidate is the solution the nearest-match
+  // search picks.
+  size_t getCandidates(const ProblemDimsType &pdims, size_t k,
+                       SolutionMapperRuntime::SolutionCandidate *candidates,
+                       bool includeInvalid)
+  {
+    using namespace SolutionMapperDistance;
+
+    if (k == 0)
+      return 0;
+    std::shared_ptr<const ExactTable> exacts = exactTable();
+    const size_t numExacts = exacts->numExacts();
+    const int numSizes = ProblemKeyType::staticNumSizes();
+
+    ProblemKeyType pkey(pdims);
+    ProblemProperties pa(pdims, _problemType);
+
+    const int algo = (_findAlg == SolutionMapperRuntime::EuclideanDistanceAlgo ||
+                      _findAlg == SolutionMapperRuntime::ManhattanDistanceAlgo) ?
+                      _findAlg : SolutionMapperRuntime::RatioDistanceAlgo;
+    const bool ratio = (algo == SolutionMapperRuntime::RatioDistanceAlgo);
+    const Metric metric = (algo == SolutionMapperRuntime::EuclideanDistanceAlgo) ? SqrDiff : AbsDiff;
+
+    std::vector<double> query(numSizes);
+    for (int si=0; si<numSizes; si++) {
+      query[si] = ratioQuery(pkey.sizes(si), ratio);
+    }
+
+    // Distance of every entry
+    std::vector<double> entryDistance(numExacts);
+    for (size_t blockStart=0; blockStart<numExacts; blockStart+=BlockSize) {
+      int n = int(std::min<size_t>(BlockSize, numExacts - blockStart));
+      double *dist = &entryDistance[blockStart];
+      std::fill(dist, dist+n, ratio ? 1.0 : 0.0);
+      for (int si=0; si<numSizes; si++) {
+        if (ratio)
+          accumulate(metric, dist, exacts->logSizeRow(si) + blockStart, query[si], n);
+        else
+          accumulate(metric, dist, exacts->sizeRow(si) + blockStart, query[si], n);
+      }
+    }
+
+    // Closest entry of each solution, the first one on ties
+    std::vector<double> solutionDistance(_numSolutions, std::numeric_limits<double>::infinity());
+    std::vector<size_t> solutionEntry(_numSolutions, numExacts);
+    for (size_t i=0; i<numExacts; i++) {
+      int s = exacts->solutionIdx(i);
+      if (entryDistance[i] < solutionDistance[s]) {
+        solutionDistance[s] = entryDistance[i];
+        solutionEntry[s] = i;
+      }
+    }
+    if (ratio) {
+      // Each float-log distance is within ratioTolerance of RatioDistance: the closest
+      // entry of a solution is within twice that of its float-log minimum
+      const double tolerance = 2*ratioTolerance();
+      std::vector<double> approxDistance(solutionDistance);
+      std::fill(solutionDistance.begin(), solutionDistance.end(), std::numeric_limits<double>::infinity());
+      for (size_t i=0; i<numExacts; i++) {
+        int s = exacts->solutionIdx(i);
+        if (entryDistance[i] <= approxDistance[s] + tolerance) {
+          double distance = RatioDistance<ProblemKeyType>()(pkey, exacts->key(i));
+          if (distance < solutionDistance[s]) {
+            solutionDistance[s] = distance;
+            solutionEntry[s] = i;
+          }
+        }
+      }
+    }
+
+    // Bounded max-heap on (distance, closest entry): the root is the worst of the k kept so far
+    typedef std::pair<double, size_t> Ranked;
+    std::vector<Ranked> heap;
+    heap.reserve(k);
+    std::vector<bool> valid(_numSolutions);
+    for (size_t s=0; s<_numSolutions; s++) {
+      if (solutionEntry[s] == numExacts)
+        continue; // solution has no exact entries
+      valid[s] = pa.validForSolution(_solutionInfo[s]._assertionRequirements);
+      if (!valid[s] && !includeInvalid)
+        continue;
+      Ranked r(solutionDistance[s], solutionEntry[s]);
+      if (heap.size() < k) {
+        heap.push_back(r);
+        std::push_heap(heap.begin(), heap.end());
+      } else if (r < heap.front()) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = r;
+        std::push_heap(heap.begin(), heap.end());
+      }
+    }
+    std::sort_heap(heap.begin(), heap.end());
+
+    for (size_t i=0; i<heap.size(); i++) {
+      int s = exacts->solutionIdx(heap[i].second);
+      candidates[i]._solution = getSolution(s);
+      candidates[i]._distance = heap[i].first;
+      candidates[i]._valid    = valid[s];
+    }
+    return heap.size();
+  }
+
+  // Fraction of the work-groups' macro tiles covered by the problem in the free dimensions.
+  // 1 for an empty problem, which launches no work-groups.
+  double tileEfficiency(const SolutionInfo &info, double free0Size, double free1Size) const
+  {
+    double efficiency = 1.0;
+    if (free0Size == 0 || free1Size == 0)
+      return efficiency;
+    if (info._macroTile0) {
+      double mt = info._macroTile0;
+      efficiency *= free0Size / (::ceil(free0Size / mt) * mt);
+    }
+    if (info._macroTile1) {
+      double mt = info._macroTile1;
+      efficiency *= free1Size / (::ceil(free1Size / mt) * mt);
+    }
+    return efficiency;
+  }
+
+  // Predict the performance of each valid solution for the problem and return the fastest.
+  // For each solution the PerfModelNeighbors exact entries closest to the problem (ratio
+  // distance) where it was the winner give the measured GFlops ; these are divided by the
+  // tile efficiency of those entries to estimate the solution's efficiency-free throughput,
+  // then scaled by the tile efficiency of the problem. Estimates that extrapolate from
+  // distant shapes are penalized by 1/(1+distance).
+  // Falls back to the ratio-distance nearest match if the table has no GFlops.
+  int findPerformanceModelMatch(const ProblemProperties &pa,
+                                const ProblemKeyType &pkey) const
+  {
+    using namespace SolutionMapperDistance;
+    static const int PerfModelNeighbors = 4;
+
+    std::shared_ptr<const ExactTable> exacts = exactTable();
+    const size_t numExacts = exacts->numExacts();
+    const int numSizes = ProblemKeyType::staticNumSizes();
+
+    std::vector<bool> valid(_numSolutions);
+    for (size_t s=0; s<_numSolutions; s++) {
+      valid[s] = pa.validForSolution(_solutionInfo[s]._assertionRequirements);
+    }
+
+    std::vector<double> query(numSizes);
+    for (int si=0; si<numSizes; si++) {
+      query[si] = ratioQuery(std::max(pkey.sizes(si), 1u), true);
+    }
+
+    // Closest entries for each solution, sorted by distance
+    struct Neighbor { double distance; size_t exactIdx; };
+    std::vector<Neighbor> neighbors(_numSolutions * PerfModelNeighbors,
+                                    Neighbor{std::numeric_limits<double>::infinity(), 0});
+
+    double dist[BlockSize];
+    for (size_t blockStart=0; blockStart<numExacts; blockStart+=BlockSize) {
+      int n = int(std::min<size_t>(BlockSize, numExacts - blockStart));
+      std::fill(dist, dist+n, 0.0);
+      for (int si=0; si<numSizes; si++) {
+        accumulate(AbsDiff, dist, exacts->logSizeRow(si) + blockStart, query[si], n);
+      }
+      for (int i=0; i<n; i++) {
+        int solutionIdx = exacts->solutionIdx(blockStart+i);
+        if (!valid[solutionIdx] || !(exacts->gflops(blockStart+i) > 0))
+          continue;
+        Neighbor *nb = &neighbors[solutionIdx * PerfModelNeighbors];
+        if (dist[i] >= nb[PerfModelNeighbors-1].distance)
+          continue;
+        int pos = PerfModelNeighbors-1;
+        for (; pos>0 && nb[pos-1].distance > dist[i]; pos--) {
+          nb[pos] = nb[pos-1];
+        }
+        nb[pos] = Neighbor{dist[i], blockStart+i};
+      }
+    }
+
+    const double free0 = pkey.sizes(_problemType->free0Idx());
+    const double free1 = pkey.sizes(_problemType->free1Idx());
+    int bestIdx = -1;
+    double bestGFlops = 0.0;
+    for (size_t s=0; s<_numSolutions; s++) {
+      const Neighbor *nb = &neighbors[s * PerfModelNeighbors];
+      if (nb[0].distance == std::numeric_limits<double>::infinity())
+        continue; // no measurements for this solution
+
+      double weightedPeak = 0.0, totalWeight = 0.0;
+      for (int k=0; k<PerfModelNeighbors && nb[k].distance != std::numeric_limits<double>::infinity(); k++) {
+        double efficiency = tileEfficiency(_solutionInfo[s],
+                                           exacts->size(nb[k].exactIdx, _problemType->free0Idx()),
+                                           exacts->size(nb[k].exactIdx, _problemType->free1Idx()));
+        double weight = 1.0 / (1.0 + nb[k].distance);
+        weightedPeak += weight * exacts->gflops(nb[k].exactIdx) / efficiency;
+        totalWeight += weight;
+      }
+      double predicted = tileEfficiency(_solutionInfo[s], free0, free1) *
+                         (weightedPeak / totalWeight) / (1.0 + nb[0].distance);
+      if (_db & 0x2)
+        printf ("perf model solutionIdx=%zu predicted=%.1f GFlop/s\n", s, predicted);
+      if (predicted > bestGFlops) {
+        bestGFlops = predicted;
+        bestIdx = int(s);
+      }
+    }
+
+    if (bestIdx == -1)
+      return findNearestMatchSoA (pa, pkey, SolutionMapperRuntime::RatioDistanceAlgo);
+    return bestIdx;
+  }
+
+  // Walk the range logic decision table - one short scan of the rule group per index.
+  // Returns -1 if there is no range logic or the selected solution does not meet
+  // the assertion requirements for this problem.
+  int findRangeMatch(const ProblemProperties &pa, const ProblemKeyType &pkey) const
+  {
+    if (_rangeLogic == nullptr || _rangeLogic->numRules == 0)
+      return -1;
+
+    int next = 0;
+    for (unsigned int level=0; level<_rangeLogic->numLevels; level++) {
+      auto size = pkey.sizes(_rangeLogic->indexOrder[level]);
+      const RangeRule *rule = &_rangeLogic->rules[next];
+      while (size > rule->threshold) {
+        rule++;
+      }
+      next = rule->next;
+    }
+
+    if (_db & 0x2)
+      printf ("range logic selected solutionIdx=%d\n", next);
+    if (next < 0 || size_t(next) >= _numSolutions ||
+        !pa.validForSolution(_solutionInfo[next]._assertionRequirements))
+      return -1;
+    return next;
+  }
+
   int findNearestMatchWithAlg(const ProblemProperties &pa, const ProblemKeyType &pkey) const
   {
-    if (_findAlg >= 0) {
-      if (_findAlg < _numSolutions) {
-        return _findAlg; // user specified a specific algorithm
+    return findNearestMatchWithAlg(pa, pkey, _findAlg);
+  }
+
+  int findNearestMatchWithAlg(const ProblemProperties &pa, const ProblemKeyType &pkey, int findAlg) const
+  {
+    if (findAlg >= 0) {
+      if (size_t(findAlg) < _numSolutions) {
+        return findAlg; // user specified a specific algorithm
       }
     }
-    switch (_findAlg) {
+    if (findAlg == SolutionMapperRuntime::PerformanceModelAlgo) {
+      return findPerformanceModelMatch (pa, pkey);
+    }
+    if (findAlg == SolutionMapperRuntime::RangeLogicAlgo) {
+      int solutionIdx = findRangeMatch(pa, pkey);
+      if (solutionIdx != -1)
+        return solutionIdx;
+      // No range logic or the range winner is not valid here - use the fallback algorithm,
+      // which can not be the range logic again
+      return _rangeFallbackAlg == SolutionMapperRuntime::RangeLogicAlgo ? -1 :
+             findNearestMatchWithAlg (pa, pkey, _rangeFallbackAlg);
+    }
+    if (findAlg != SolutionMapperRuntime::PickNoneAlgo &&
+        findAlg != SolutionMapperRuntime::RandomAlgo &&
+        !(_db & 0x6)) {
+      // Fast path - the scalar functors below are kept for Random and for the debug prints
+      return findNearestMatchSoA (pa, pkey, findAlg);
+    }
+    switch (findAlg) {
       case SolutionMapperRuntime::PickNoneAlgo: // Fall through to range logic
         return -1;
       case SolutionMapperRuntime::RandomAlgo:
@@ -303,31 +892,170 @@ public:
     // for example summation is some int multiple or macro-tile bounds are <32bits
     ProblemProperties pa(pdims,_problemType);
 
-    std::lock_guard<std::mutex> lockGuard(_cachedMutex);
-    auto fiter = _cachedLookups.find(pkey);
-    if (fiter != _cachedLookups.end()) {
+    // Cache is sharded and locks internally - the nearest-match search below runs unlocked
+    int solutionIdx;
+    if (_cachedLookups.find(pkey, &solutionIdx)) {
+      _stats->count(TensileLookupCacheHits);
       if (_db & 0x1)
-        std::cerr << "findAlgorithmStatic hit in cache solutionIdx=" << fiter->second << "\n";
-      return fiter->second;
+        std::cerr << "findAlgorithmStatic hit in cache solutionIdx=" << solutionIdx << "\n";
 
     } else {
-      // Less frequently come here, this is only first time problem size is seen.
-      int solutionIdx = findExactMatch(pa, pkey);
-      if (solutionIdx == -1) {
-        solutionIdx = findNearestMatchWithAlg (pa, pkey);
-        if (_db & 0x1)
-          std::cerr << "findAlgorithmStatic picked nearest-match solutionIdx=" << solutionIdx << "\n";
-      } else {
-        if (_db & 0x1)
-          std::cerr << "findAlgorithmStatic picked exact solutionIdx=" << solutionIdx << "\n";
+      // Less frequently come here, this is only first time problem size is seen
+      // (or the entry was evicted from the bounded cache)
+      _stats->count(TensileLookupCacheMisses);
+      solutionIdx = findAndCacheAlgorithm(pa, pkey);
+    }
+    _stats->countSelection(solutionIdx);
+    return solutionIdx;
+  }
+
+  // Search for the problem in the exact table then with the find algorithm, and
+  // save the result in the lookup cache.
+  // With canonicalization enabled, problems that are not in the exact table share the
+  // entry of their canonical key in _canonicalLookups, unless that bucket holds an exact
+  // table entry or its solution does not meet the assertion requirements of the problem.
+  // Canonical entries are kept apart from _cachedLookups so that a problem whose sizes
+  // equal a canonical key is still searched for with its own assertions.
+  // The time taken is recorded in the latency histogram of the path that found the solution.
+  int findAndCacheAlgorithm(const ProblemProperties &pa, const ProblemKeyType &pkey)
+  {
+    uint64_t startNs = TensileLookupStats::now();
+    uint64_t generation = _tableGeneration.load(std::memory_order_acquire);
+    ProblemKeyType ckey(pkey);
+    bool useCanonical = canonicalBucket(pkey, &ckey);
+    {
+      int solutionIdx;
+      if (useCanonical && _canonicalLookups.find(ckey, &solutionIdx)) {
+        if (pa.validForSolution(_solutionInfo[solutionIdx]._assertionRequirements)) {
+          if (_db & 0x1)
+            std::cerr << "findAlgorithmStatic hit canonical entry solutionIdx=" << solutionIdx << "\n";
+          _stats->count(TensileLookupCanonicalHits);
+          _stats->recordLatency(TensileLookupPathCanonical, TensileLookupStats::now() - startNs);
+          return solutionIdx;
+        }
+        useCanonical = false; // bucket solution is not valid here - cache the exact problem
       }
+    }
+
+    TensileLookupPath path = TensileLookupPathExact;
+    int solutionIdx = findExactMatch(pa, pkey);
+    if (solutionIdx == -1) {
+      solutionIdx = findNearestMatchWithAlg (pa, useCanonical ? ckey : pkey);
+      path = TensileLookupStats::pathForAlgo(_findAlg);
+      _stats->count(TensileLookupNearestMatches);
+      if (_db & 0x1)
+        std::cerr << "findAlgorithmStatic picked nearest-match solutionIdx=" << solutionIdx << "\n";
+    } else {
+      useCanonical = false;
+      _stats->count(TensileLookupExactHits);
+      if (_db & 0x1)
+        std::cerr << "findAlgorithmStatic picked exact solutionIdx=" << solutionIdx << "\n";
+    }
+
+    // Save problem->solutionIdx mapping so future lookups are fast, unless a logic file
+    // was loaded during the search:
+    if (solutionIdx != -1) {
+      cacheSearchResult(useCanonical ? ckey : pkey, solutionIdx, generation, useCanonical);
+    } else {
+      _stats->count(TensileLookupNotFound);
+    }
 
-      // Save problem->solutionIdx mapping so future lookups are fast:
-      if (solutionIdx != -1) {
-        _cachedLookups.insert({pkey, solutionIdx});
+    _stats->recordLatency(path, TensileLookupStats::now() - startNs);
+    return solutionIdx;
+  }
+
+  // Sets *ckey to the canonical key of pkey and returns true if pkey shares the lookup
+  // of that bucket, see findAndCacheAlgorithm
+  bool canonicalBucket(const ProblemKeyType &pkey, ProblemKeyType *ckey) const
+  {
+    if (!_canonicalizer.enabled())
+      return false;
+    *ckey = canonicalKey(pkey);
+    return !(*ckey == pkey) && !bucketHasExactEntries(*ckey);
+  }
+
+  ProblemKeyType canonicalKey(const ProblemKeyType &pkey) const
+  {
+    typename ProblemKeyType::SizeType sizes[ProblemKeyType::staticNumSizes()];
+    for (int si=0; si<pkey.numSizes(); si++) {
+      sizes[si] = _canonicalizer.canonicalize(si, pkey.sizes(si));
+    }
+    const typename ProblemKeyType::SizeType *csizes = sizes;
+    return ProblemKeyType(csizes, pkey.equalStrides());
+  }
+
+  // True if some exact table entry has the canonical key ckey. Those buckets are not
+  // canonicalized so exact entries always take precedence.
+  // Compares hashes only: a collision just disables canonicalization for that bucket.
+  bool bucketHasExactEntries(const ProblemKeyType &ckey) const
+  {
+    std::shared_ptr<const ExactTable> table = exactTable();
+    std::call_once(table->_bucketsOnce, [&]() {
+      table->_bucketHashes.reserve(table->numExacts());
+      for (size_t i=0; i<table->numExacts(); i++) {
+        table->_bucketHashes.push_back(canonicalKey(table->key(i)).hash());
       }
+      std::sort(table->_bucketHashes.begin(), table->_bucketHashes.end());
+      table->_derivedBytes.fetch_add(table->_bucketHashes.capacity() * sizeof(size_t));
+    });
+    return std::binary_search(table->_bucketHashes.begin(), table->_bucketHashes.end(), ckey.hash());
+  }
 
-      return solutionIdx;
+  // Batch lookup: duplicate shapes in the batch are looked up once, and the cache
+  // probes for the whole batch take each cache shard lock at most once.
+  void findAlgorithmsStatic(const ProblemDimsType *pdims, size_t numProblems, int *solutionIdxs)
+  {
+    std::vector<ProblemKeyType> keys;
+    keys.reserve(numProblems);
+    std::vector<std::pair<size_t, size_t>> byHash(numProblems); // (hash, problemIdx)
+    for (size_t i=0; i<numProblems; i++) {
+      keys.push_back(ProblemKeyType(pdims[i]));
+      byHash[i] = std::make_pair(keys[i].hash(), i);
+    }
+    std::sort(byHash.begin(), byHash.end());
+
+    // Map each problem to the first problem in the batch with the same key
+    std::vector<size_t> representative(numProblems);
+    std::vector<ProblemKeyType> uniqueKeys;
+    std::vector<size_t> uniqueProblems;
+    for (size_t run=0; run<numProblems; ) {
+      size_t runEnd = run+1;
+      while (runEnd<numProblems && byHash[runEnd].first == byHash[run].first)
+        runEnd++;
+      for (size_t i=run; i<runEnd; i++) {
+        size_t pi = byHash[i].second;
+        representative[pi] = pi;
+        for (size_t j=run; j<i; j++) {
+          size_t pj = byHash[j].second;
+          if (representative[pj] == pj && keys[pj] == keys[pi]) {
+            representative[pi] = pj;
+            break;
+          }
+        }
+        if (representative[pi] == pi) {
+          uniqueKeys.push_back(keys[pi]);
+          uniqueProblems.push_back(pi);
+        }
+      }
+      run = runEnd;
+    }
+
+    std::vector<int> uniqueIdxs(uniqueKeys.size());
+    std::unique_ptr<bool[]> found(new bool[uniqueKeys.size()]);
+    size_t hits = _cachedLookups.findBatch(uniqueKeys.data(), uniqueKeys.size(), uniqueIdxs.data(), found.get());
+    _stats->count(TensileLookupCacheHits, hits);
+    _stats->count(TensileLookupCacheMisses, uniqueKeys.size() - hits);
+    for (size_t u=0; u<uniqueKeys.size(); u++) {
+      size_t pi = uniqueProblems[u];
+      if (!found[u]) {
+        ProblemProperties pa(pdims[pi], _problemType);
+        uniqueIdxs[u] = findAndCacheAlgorithm(pa, uniqueKeys[u]);
+      }
+      solutionIdxs[pi] = uniqueIdxs[u];
+    }
+    for (size_t i=0; i<numProblems; i++) {
+      solutionIdxs[i] = solutionIdxs[representative[i]];
+      _stats->countSelection(solutionIdxs[i]);
     }
   }
 
@@ -344,6 +1072,264 @@ public:
     return solution;
   }
  
+  // Batch version of getSolutionWithFallback - problems not found by the device mapper
+  // are looked up one at a time in the fallback mapper.
+  // Returns the number of problems without a solution.
+  size_t getSolutionsWithFallback(const ProblemDimsType *pdims, size_t numProblems,
+                                  SolutionMapperRuntime::SolutionRuntime **solutions,
+                                  MasterSolutionMapper<ProblemDimsType> *masterSolutionMapper) {
+    masterSolutionMapper->mapper()->getSolutions(pdims, numProblems, solutions);
+    size_t numMissing = 0;
+    for (size_t i=0; i<numProblems; i++) {
+      if (solutions[i] == nullptr) {
+        ProblemDimsType fallbackDims(pdims[i]);
+        solutions[i] = masterSolutionMapper->fallbackMapper()->getSolution(fallbackDims);
+        if (solutions[i] == nullptr)
+          numMissing++;
+      }
+    }
+    return numMissing;
+  }
+
+  // Grouped call, see tensileGrouped_<ProblemType>: look up the solution of every problem,
+  // plan every launch, then enqueue the problems grouped by solution (see groupBySolution).
+  //   plan(p, solution, launch) packs the kernel args of problem p into launch
+  //   enqueue(p, solution, launch, first, last) enqueues problem p ; first and last are set
+  //   for the first and last launch of the call
+  // Both return a TensileStatus. Nothing is enqueued if a problem has no solution or fails
+  // to plan. Returns the first failing status ; the launches after it are not enqueued.
+  template <class PlanFunction, class EnqueueFunction>
+  TensileStatus launchGrouped(const ProblemDimsType *pdims, size_t numProblems,
+                              MasterSolutionMapper<ProblemDimsType> *masterSolutionMapper,
+                              PlanFunction plan, EnqueueFunction enqueue) {
+    if (numProblems == 0)
+      return tensileStatusSuccess;
+    std::vector<SolutionMapperRuntime::SolutionRuntime *> solutions(numProblems);
+    if (getSolutionsWithFallback(pdims, numProblems, solutions.data(), masterSolutionMapper))
+      return tensileStatusFailure; // no solution found for some problem
+    std::vector<unsigned int> order(numProblems);
+    groupBySolution(numProblems, solutions.data(), order.data());
+
+    // pack the kernel args of every launch before enqueueing the first one
+    std::vector<SolutionLaunch> launches(numProblems);
+    for (size_t p=0; p<numProblems; p++) {
+      TensileStatus status = plan(static_cast<unsigned int>(p), solutions[p], &launches[p]);
+      if (status != tensileStatusSuccess)
+        return status;
+    }
+
+    for (size_t i=0; i<numProblems; i++) {
+      unsigned int p = order[i];
+      TensileStatus status = enqueue(p, solutions[p], &launches[p], i == 0, i == numProblems-1);
+      if (status != tensileStatusSuccess)
+        return status;
+    }
+    return tensileStatusSuccess;
+  }
+
+  // Launch plan, see tensileCreatePlan_<ProblemType>: look up the solution of pdims once and
+  // keep dims (strides then sizes). If the solution has a plan function, plan(solution, launch)
+  // precomputes its launch. *newPlan is nullptr unless tensileStatusSuccess is returned.
+  template <unsigned int NumDims, class PlanFunction>
+  TensileStatus createPlan(ProblemDimsType &pdims, const unsigned int *dims,
+                           MasterSolutionMapper<ProblemDimsType> *masterSolutionMapper,
+                           PlanFunction plan, TensilePlan<NumDims> **newPlan) {
+    *newPlan = nullptr;
+    auto solution = getSolutionWithFallback(pdims, masterSolutionMapper);
+    if (solution == nullptr)
+      return tensileStatusFailure; // no solution found
+    TensilePlan<NumDims> *result = new TensilePlan<NumDims>;
+    result->_solution = solution;
+    std::copy(dims, dims+NumDims, result->_dims);
+    result->_precomputed = solution->_info->_planFunctionPtr != nullptr;
+    if (result->_precomputed) {
+      TensileStatus status = plan(solution, &result->_launch);
+      if (status != tensileStatusSuccess) {
+        delete result;
+        return status;
+      }
+    }
+    *newPlan = result;
+    return tensileStatusSuccess;
+  }
+
+  // Enqueue a plan, see tensileExecutePlan_<ProblemType>: execute(solution, launch) if its
+  // launch is precomputed, else launch(solution, dims) with the dims of the plan.
+  template <unsigned int NumDims, class ExecuteFunction, class LaunchFunction>
+  static TensileStatus executePlan(const TensilePlan<NumDims> *plan,
+                                   ExecuteFunction execute, LaunchFunction launch) {
+    if (plan->_precomputed)
+      return execute(plan->_solution, &plan->_launch);
+    return launch(plan->_solution, plan->_dims);
+  }
+
+  void getSolutions(const ProblemDimsType *pdims, size_t numProblems,
+                    SolutionMapperRuntime::SolutionRuntime **solutions) {
+    std::vector<int> solutionIdxs(numProblems);
+    findAlgorithmsStatic(pdims, numProblems, solutionIdxs.data());
+    for (size_t i=0; i<numProblems; i++) {
+      solutions[i] = (solutionIdxs[i] != -1) ? getSolution(solutionIdxs[i]) : nullptr;
+    }
+  }
+
+  // Autotuning version of getSolutionWithFallback
+  SolutionMapperRuntime::SolutionRuntime *getSolutionForLaunchWithFallback(ProblemDimsType &pdims,
+      MasterSolutionMapper<ProblemDimsType> *masterSolutionMapper,
+      typename SolutionMapperBase<ProblemDimsType>::AutotuneTrial *trial) {
+
+    SolutionMapperRuntime::SolutionRuntime *solution = nullptr;
+
+    solution = masterSolutionMapper->mapper()->getSolutionForLaunch(pdims, trial);
+    if (solution == nullptr) {
+      solution = masterSolutionMapper->fallbackMapper()->getSolutionForLaunch(pdims, trial);
+    }
+    return solution;
+  }
+
+  // Single launch, see tensile_<ProblemType>: look up the solution of pdims and return
+  // launch(solution). While the problem is autotuned (see getSolutionForLaunch) the launch is
+  // timed on stream with the launch timer of the device context and reported with reportTrial.
+  // Returns tensileStatusFailure if no solution is found.
+  template <class LaunchFunction>
+  TensileStatus launchWithAutotune(ProblemDimsType &pdims,
+                                   MasterSolutionMapper<ProblemDimsType> *masterSolutionMapper,
+                                   TensileStream stream, LaunchFunction launch) {
+    typename SolutionMapperBase<ProblemDimsType>::AutotuneTrial trial;
+    auto solution = getSolutionForLaunchWithFallback(pdims, masterSolutionMapper, &trial);
+    if (solution == nullptr)
+      return tensileStatusFailure; // no solution found
+    if (!trial.active())
+      return launch(solution);
+
+    // autotuning this problem - time the launch and report it
+    TensileStatus status;
+    double elapsedMs = TensileDeviceContext::instance().launchTimer()->time(stream, [&]() {
+      return launch(solution);
+    }, &status);
+    trial._mapper->reportTrial(pdims, trial, elapsedMs);
+    return status;
+  }
+
+  SolutionMapperRuntime::SolutionRuntime *getSolutionForLaunch(ProblemDimsType &pdims,
+      typename SolutionMapperBase<ProblemDimsType>::AutotuneTrial *trial) {
+
+    trial->_mapper = nullptr;
+    if (_autotuneCandidates == 0)
+      return getSolution(pdims);
+
+    ProblemKeyType pkey(pdims);
+    int solutionIdx;
+    if (_cachedLookups.find(pkey, &solutionIdx)) {
+      _stats->count(TensileLookupCacheHits);
+      _stats->countSelection(solutionIdx);
+      return getSolution(solutionIdx);
+    }
+
+    uint64_t generation = _tableGeneration.load(std::memory_order_acquire);
+    ProblemProperties pa(pdims, _problemType);
+    solutionIdx = findExactMatch(pa, pkey);
+    if (solutionIdx != -1) {
+      _stats->count(TensileLookupCacheMisses);
+      _stats->count(TensileLookupExactHits);
+      _stats->countSelection(solutionIdx);
+      cacheSearchResult(pkey, solutionIdx, generation);
+      return getSolution(solutionIdx);
+    }
+
+    // Problems of a canonical bucket share its entry, and its autotuning
+    ProblemKeyType tkey(pkey);
+    bool canonical = canonicalBucket(pkey, &tkey);
+    if (canonical && _canonicalLookups.find(tkey, &solutionIdx) &&
+        pa.validForSolution(_solutionInfo[solutionIdx]._assertionRequirements)) {
+      _stats->count(TensileLookupCacheMisses);
+      _stats->count(TensileLookupCanonicalHits);
+      _stats->countSelection(solutionIdx);
+      return getSolution(solutionIdx);
+    }
+
+    {
+      std::lock_guard<std::mutex> lockGuard(_autotuneMutex);
+      auto iter = _autotuning.find(tkey);
+      if (iter == _autotuning.end()) {
+        std::vector<SolutionMapperRuntime::SolutionCandidate> candidates(_autotuneCandidates);
+        size_t numCandidates = getCandidates(pdims, _autotuneCandidates, candidates.data(), false);
+        if (numCandidates > 1) {
+          AutotuneState state;
+          for (size_t i=0; i<numCandidates; i++) {
+            state._candidates.push_back(int(candidates[i]._solution - _solutionTable));
+          }
+          state._bestMs.assign(numCandidates, std::numeric_limits<double>::infinity());
+          state._generation = generation;
+          iter = _autotuning.insert({tkey, state}).first;
+          if (_db & 0x1)
+            printf ("info: %s autotuning new problem with %zu candidates\n", _name, numCandidates);
+        }
+      }
+      if (iter != _autotuning.end()) {
+        AutotuneState &state = iter->second;
+        size_t numTrials = state._candidates.size() * AUTOTUNE_TRIALS;
+        // Round-robin through the candidates ; calls beyond the last trial (while reports are
+        // still outstanding) launch the closest candidate untimed
+        size_t issued = state._issued;
+        solutionIdx = state._candidates[issued < numTrials ? issued % state._candidates.size() : 0];
+        // The candidates were chosen for the first problem of the bucket
+        if (pa.validForSolution(_solutionInfo[solutionIdx]._assertionRequirements)) {
+          state._issued++;
+          if (issued < numTrials) {
+            trial->_mapper = this;
+            trial->_solutionIdx = solutionIdx;
+          }
+          return getSolution(solutionIdx);
+        }
+      }
+    }
+
+    // Nothing to choose between - commit to the usual search result
+    return getSolution(pdims);
+  }
+
+  void reportTrial(const ProblemDimsType &pdims,
+                   const typename SolutionMapperBase<ProblemDimsType>::AutotuneTrial &trial,
+                   double elapsedMs) {
+    ProblemKeyType pkey(pdims);
+    ProblemKeyType tkey(pkey);
+    bool canonical = canonicalBucket(pkey, &tkey);
+    int bestIdx = -1;
+    uint64_t generation;
+    {
+      std::lock_guard<std::mutex> lockGuard(_autotuneMutex);
+      auto iter = _autotuning.find(tkey);
+      if (iter == _autotuning.end())
+        return;
+      AutotuneState &state = iter->second;
+      for (size_t i=0; i<state._candidates.size(); i++) {
+        if (state._candidates[i] == trial._solutionIdx && elapsedMs < state._bestMs[i])
+          state._bestMs[i] = elapsedMs;
+      }
+      if (++state._reported < state._candidates.size() * AUTOTUNE_TRIALS)
+        return;
+
+      // Strict compare keeps the closest candidate on ties (including all launches failing)
+      size_t best = 0;
+      for (size_t i=1; i<state._candidates.size(); i++) {
+        if (state._bestMs[i] < state._bestMs[best])
+          best = i;
+      }
+      bestIdx = state._candidates[best];
+      generation = state._generation;
+      if (_db & 0x1)
+        printf ("info: %s autotuned problem to solutionIdx=%d (%.3f ms, closest candidate %.3f ms)\n",
+                _name, bestIdx, state._bestMs[best], state._bestMs[0]);
+      _autotuning.erase(iter);
+    }
+
+    // Candidates picked from a table that has been replaced since are not cached
+    std::lock_guard<std::mutex> lockGuard(_loadLogicMutex);
+    if (generation == _tableGeneration.load(std::memory_order_relaxed))
+      (canonical ? _canonicalLookups : _cachedLookups).insert(tkey, bestIdx,
+          LookupCache<ProblemKeyType, int>::Preferred);
+  }
+
   SolutionMapperRuntime::SolutionRuntime *getSolution(ProblemDimsType &pdims) {
      
     int solutionIdx = findAlgorithmStatic(pdims);
@@ -355,43 +1341,503 @@ public:
     return solution;
   }
 
+  // Only valid once the mapper is materialized
   SolutionMapperRuntime::SolutionRuntime *getSolution(int solutionIdx) const {
     //printf ("getSolution for solutionIdx=%d\n", solutionIdx);
     return &_solutionTable[solutionIdx];
   };
 
-  const SolutionMapperRuntime::SolutionRuntime &cacheSolution(const ProblemDimsType &pdims, int solutionIdx) {
-    {
-      if (solutionIdx != -1) {
-        ProblemKeyType pkey(pdims);
-        std::lock_guard<std::mutex> lockGuard(_cachedMutex);
-        auto fiter = _cachedLookups.find(pkey);
-        if (fiter != _cachedLookups.end()) {
-          _cachedLookups.insert({pkey, solutionIdx});
+  // Cache pdims->solutionIdx as a preferred lookup cache entry: the entry overrides the
+  // exact table and find algorithm, outlives the other entries under eviction (see
+  // LookupCache.h), and is saved with the persistent lookup cache. Loading a logic file
+  // drops it. Returns nullptr if solutionIdx is -1.
+  SolutionMapperRuntime::SolutionRuntime *cacheSolution(const ProblemDimsType &pdims, int solutionIdx) {
+    if (solutionIdx == -1)
+      return nullptr;
+    ProblemKeyType pkey(pdims);
+    _cachedLookups.insert(pkey, solutionIdx, LookupCache<ProblemKeyType, int>::Preferred);
+    return getSolution(solutionIdx);
+  };
+  const std::string name() const { return _name; };
+
+  bool isMaterialized() const { return _solutionTable != nullptr; };
+
+  // Active exact table
+  std::shared_ptr<const ExactTable> exactTable() const {
+    return std::atomic_load(&_exactTable);
+  }
+
+  //--------------------
+  // Binary logic file
+  // Exact table written by TensileCreateLibrary --write-logic-files
+  // (LogicData/<schedule>_<problemType>.tensile_logic) that can replace the embedded table
+  // at runtime. Little endian layout:
+  //   LogicFileHeader
+  //   LogicFileSolution solutions[numSolutions]
+  //   numExacts entries sorted by sizes, as rows (the ExactTableData layout):
+  //     uint32 sizes[numSizes][numExacts], int32 solutionIdx[numExacts], float gflops[numExacts]
+  //   char names[namesSize] - NUL terminated solution names
+  // solutionIdx indexes the solutions of the file. These are matched to the compiled solution
+  // table by name ; a solution that is not compiled in, or whose assertion requirements
+  // differ, is dropped with its entries. If every solution matches the compiled solution
+  // with the same index the rows are used in place from the mapped file.
+  struct LogicFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t numSizes;
+    uint32_t numSolutions;
+    uint32_t numExacts;
+    uint32_t namesSize;
+    uint32_t reserved;
+  };
+
+  struct LogicFileSolution {
+    uint32_t nameOffset; // into names
+    uint32_t summationElementMultiple;
+    uint32_t free0ElementMultiple;
+    uint32_t free1ElementMultiple;
+    int32_t  approxSize;
+    uint32_t equalStrides;
+  };
+
+  // Load the exact table of a logic file and make it the active table. The lookup caches
+  // are cleared, and problems being autotuned start over. Returns the number of exact entries loaded, or -1
+  // if the file is missing or malformed, in which case the active table is unchanged.
+  int loadLogicFile(const std::string &path) {
+    std::unique_ptr<TensileMappedFile> file(new TensileMappedFile);
+    if (!file->open(path) || file->size() < sizeof(LogicFileHeader)) {
+      if (_db & 0x8)
+        printf ("info: %s no logic file %s\n", _name, path.c_str());
+      return -1;
+    }
+
+    const size_t numSizes = ProblemKeyType::staticNumSizes();
+    LogicFileHeader header;
+    memcpy(&header, file->data(), sizeof(header));
+    const size_t numExacts = header.numExacts;
+    const size_t solutionsOffset = sizeof(header);
+    const size_t sizesOffset = solutionsOffset + size_t(header.numSolutions) * sizeof(LogicFileSolution);
+    const size_t solutionIdxOffset = sizesOffset + numSizes * numExacts * sizeof(uint32_t);
+    const size_t gflopsOffset = solutionIdxOffset + numExacts * sizeof(int32_t);
+    const size_t namesOffset = gflopsOffset + numExacts * sizeof(float);
+    if (memcmp(header.magic, "TNSLOGIC", 8) != 0 || header.version != 2 ||
+        header.numSizes != numSizes || file->size() != namesOffset + header.namesSize) {
+      printf ("warning: %s ignoring malformed logic file %s\n", _name, path.c_str());
+      return -1;
+    }
+
+    // Match the solutions of the file to the compiled solutions
+    std::unordered_map<std::string, int> compiledIdx;
+    for (size_t i=0; i<_numSolutions; i++) {
+      compiledIdx[_solutionInfo[i]._name] = int(i);
+    }
+    const char *names = reinterpret_cast<const char *>(file->data() + namesOffset);
+    std::vector<int> solutionMap(header.numSolutions, -1);
+    bool identity = true;
+    for (uint32_t i=0; i<header.numSolutions; i++) {
+      LogicFileSolution fs;
+      memcpy(&fs, file->data() + solutionsOffset + i * sizeof(fs), sizeof(fs));
+      if (fs.nameOffset >= header.namesSize ||
+          !memchr(names + fs.nameOffset, 0, header.namesSize - fs.nameOffset)) {
+        printf ("warning: %s ignoring malformed logic file %s\n", _name, path.c_str());
+        return -1;
+      }
+      auto iter = compiledIdx.find(names + fs.nameOffset);
+      if (iter == compiledIdx.end()) {
+        printf ("warning: %s logic file %s uses solution %s which is not in the library\n",
+                _name, path.c_str(), names + fs.nameOffset);
+      } else {
+        const ProblemProperties &req = _solutionInfo[iter->second]._assertionRequirements;
+        if (req._summationElementMultiple == fs.summationElementMultiple &&
+            req._free0ElementMultiple == fs.free0ElementMultiple &&
+            req._free1ElementMultiple == fs.free1ElementMultiple &&
+            req._approxSize == fs.approxSize &&
+            req._equalStrides == (fs.equalStrides != 0)) {
+          solutionMap[i] = iter->second;
+        } else {
+          printf ("warning: %s logic file %s has different assertion requirements for solution %s\n",
+                  _name, path.c_str(), names + fs.nameOffset);
+        }
+      }
+      identity = identity && solutionMap[i] == int(i);
+    }
+
+    // Validate the entries, then use the rows in place or copy the entries with a usable solution
+    const unsigned char *data = file->data();
+    auto fileSize = [&](size_t exactIdx, size_t si) {
+      uint32_t v;
+      memcpy(&v, data + sizesOffset + (si*numExacts + exactIdx) * sizeof(uint32_t), sizeof(v));
+      return v;
+    };
+    auto fileSolutionIdx = [&](size_t exactIdx) {
+      int32_t v;
+      memcpy(&v, data + solutionIdxOffset + exactIdx * sizeof(int32_t), sizeof(v));
+      return v;
+    };
+    // Lexicographic compare of the sizes of two entries of the file
+    auto fileLess = [&](size_t a, size_t b) {
+      for (size_t si=0; si<numSizes; si++) {
+        uint32_t sa = fileSize(a, si), sb = fileSize(b, si);
+        if (sa != sb)
+          return sa < sb;
+      }
+      return false;
+    };
+
+    bool sorted = true;
+    for (size_t i=0; i<numExacts; i++) {
+      int32_t solutionIdx = fileSolutionIdx(i);
+      if (solutionIdx < 0 || uint32_t(solutionIdx) >= header.numSolutions) {
+        printf ("warning: %s ignoring malformed logic file %s\n", _name, path.c_str());
+        return -1;
+      }
+      if (i && fileLess(i, i-1))
+        sorted = false;
+    }
+
+    uint64_t hash = 0xcbf29ce484222325ull; // fnv1a of the file contents
+    for (size_t i=0; i<file->size(); i++) {
+      hash = (hash ^ data[i]) * 0x100000001b3ull;
+    }
+
+    std::shared_ptr<ExactTable> table;
+    if (identity && sorted && reinterpret_cast<uintptr_t>(data) % alignof(uint32_t) == 0) {
+      // Every offset is a multiple of 4 so the rows are aligned if the mapping is
+      ExactTableData rows = {reinterpret_cast<const unsigned int *>(data + sizesOffset),
+                             reinterpret_cast<const int *>(data + solutionIdxOffset),
+                             reinterpret_cast<const float *>(data + gflopsOffset),
+                             static_cast<unsigned int>(numExacts)};
+      table.reset(new ExactTable(rows, hash));
+      table->_file = std::move(file);
+    } else {
+      std::vector<size_t> order; // entries of the file to keep, in sizes order
+      order.reserve(numExacts);
+      for (size_t i=0; i<numExacts; i++) {
+        if (solutionMap[fileSolutionIdx(i)] != -1)
+          order.push_back(i);
+      }
+      if (!sorted) {
+        std::stable_sort(order.begin(), order.end(), fileLess);
+      }
+
+      const size_t numKept = order.size();
+      table.reset(new ExactTable(ExactTableData(), hash));
+      table->_sizeStorage.resize(numSizes * numKept);
+      table->_solutionIdxStorage.resize(numKept);
+      table->_gflopsStorage.resize(numKept);
+      for (size_t i=0; i<numKept; i++) {
+        for (size_t si=0; si<numSizes; si++) {
+          table->_sizeStorage[si*numKept + i] = fileSize(order[i], si);
         }
+        table->_solutionIdxStorage[i] = solutionMap[fileSolutionIdx(order[i])];
+        memcpy(&table->_gflopsStorage[i], data + gflopsOffset + order[i] * sizeof(float), sizeof(float));
       }
+      table->_data.sizes = table->_sizeStorage.data();
+      table->_data.solutionIdx = table->_solutionIdxStorage.data();
+      table->_data.gflops = table->_gflopsStorage.data();
+      table->_data.numExacts = static_cast<unsigned int>(numKept);
     }
-    return _solutionTable[solutionIdx];
+
+    {
+      std::lock_guard<std::mutex> lockGuard(_loadLogicMutex);
+      std::atomic_store(&_exactTable, std::shared_ptr<const ExactTable>(table));
+      _tableGeneration.fetch_add(1, std::memory_order_acq_rel);
+      _cachedLookups.clear();
+      _canonicalLookups.clear();
+    }
+    {
+      std::lock_guard<std::mutex> lockGuard(_autotuneMutex);
+      _autotuning.clear();
+    }
+
+    if (_db & 0x8)
+      printf ("info: %s loaded %zu exact entries from logic file %s%s\n", _name,
+              table->numExacts(), path.c_str(), table->_file ? " (in place)" : "");
+    return int(table->numExacts());
+  }
+
+  // Reload the logic file named by TENSILE_LOGIC_PATH, ie after newer tuning results were
+  // deployed. Returns the number of exact entries loaded, or -1 if there is no usable file.
+  int reloadLogic() {
+    if (_logicFile.empty())
+      return -1;
+    return loadLogicFile(_logicFile);
+  }
+
+  //--------------------
+  // Persistent lookup cache
+  // File layout (native endian) is LookupCacheFileHeader followed by numEntries records of
+  //   uint32 sizes[numSizes], uint32 flags (LookupFlag*), int32 solutionIdx
+  // Entries of _canonicalLookups are flagged LookupFlagCanonical.
+  // The file is only accepted if it was written by the same schedule (nameHash), library build
+  // (libraryHash), nearest-match algorithms and canonicalization rules (rulesHash); otherwise
+  // it is ignored and rewritten at exit.
+  struct LookupCacheFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t numSizes;
+    int32_t  findAlg;
+    uint32_t numEntries;
+    int32_t  rangeFallbackAlg;
+    uint32_t rulesHash; // of ShapeCanonicalizer::rulesString
+    uint64_t nameHash;
+    uint64_t libraryHash;
+  };
+
+  enum {LookupFlagEqualStrides=0x1, LookupFlagPreferred=0x2, LookupFlagCanonical=0x4};
+
+  static uint64_t fnv1a(const std::string &str) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i=0; i<str.size(); i++) {
+      h = (h ^ (unsigned char)str[i]) * 0x100000001b3ull;
+    }
+    return h;
+  }
+
+  void lookupCacheFileHeader(LookupCacheFileHeader *header, uint32_t numEntries) const {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, "TNSLKUP\0", 8);
+    header->version     = 4;
+    header->numSizes    = ProblemKeyType::staticNumSizes();
+    header->findAlg     = _findAlg;
+    header->numEntries  = numEntries;
+    header->rangeFallbackAlg = _rangeFallbackAlg;
+    uint64_t rulesHash  = fnv1a(_canonicalizer.rulesString());
+    header->rulesHash   = uint32_t(rulesHash ^ (rulesHash >> 32));
+    header->nameHash    = fnv1a(_name);
+    header->libraryHash = _libraryHash ^ exactTable()->_hash;
+  }
+
+  // Returns number of entries loaded, or -1 if the file is missing, stale or malformed
+  int loadLookupCache(const std::string &path) {
+    TensileMappedFile file;
+    if (!file.open(path) || file.size() < sizeof(LookupCacheFileHeader))
+      return -1;
+
+    LookupCacheFileHeader header, expected;
+    memcpy(&header, file.data(), sizeof(header));
+    lookupCacheFileHeader(&expected, header.numEntries);
+    const size_t recordSize = (ProblemKeyType::staticNumSizes() + 2) * sizeof(uint32_t);
+    if (memcmp(&header, &expected, sizeof(header)) != 0 ||
+        file.size() != sizeof(header) + header.numEntries * recordSize) {
+      if (_db & 0x8)
+        printf ("info: %s ignoring stale lookup cache file %s\n", _name, path.c_str());
+      return -1;
+    }
+
+    const unsigned char *p = file.data() + sizeof(header);
+    std::vector<uint32_t> record(ProblemKeyType::staticNumSizes() + 2);
+    int loaded = 0;
+    for (uint32_t i=0; i<header.numEntries; i++, p+=recordSize) {
+      memcpy(record.data(), p, recordSize);
+      int32_t solutionIdx = int32_t(record[header.numSizes+1]);
+      if (solutionIdx < 0 || size_t(solutionIdx) >= _numSolutions)
+        continue;
+      const typename ProblemKeyType::SizeType *sizes = record.data();
+      uint32_t flags = record[header.numSizes];
+      ProblemKeyType pkey(sizes, (flags & LookupFlagEqualStrides) != 0);
+      (flags & LookupFlagCanonical ? _canonicalLookups : _cachedLookups).insert(pkey, solutionIdx,
+          flags & LookupFlagPreferred ? LookupCache<ProblemKeyType, int>::Preferred
+                                      : LookupCache<ProblemKeyType, int>::Normal);
+      loaded++;
+    }
+    return loaded;
+  }
+
+  // Returns false if the file could not be written
+  bool saveLookupCache(const std::string &path) const {
+    const size_t numSizes = ProblemKeyType::staticNumSizes();
+    std::vector<uint32_t> records;
+    auto addRecord = [&](const ProblemKeyType &pkey, int solutionIdx, uint32_t flags) {
+      for (size_t si=0; si<numSizes; si++) {
+        records.push_back(pkey.sizes(si));
+      }
+      records.push_back((pkey.equalStrides() ? LookupFlagEqualStrides : 0) | flags);
+      records.push_back(uint32_t(solutionIdx));
+    };
+    typedef LookupCache<ProblemKeyType, int> Cache;
+    _cachedLookups.forEach([&](const ProblemKeyType &pkey, int solutionIdx, typename Cache::Retention retention) {
+      addRecord(pkey, solutionIdx, retention != Cache::Normal ? LookupFlagPreferred : 0);
+    });
+    _canonicalLookups.forEach([&](const ProblemKeyType &pkey, int solutionIdx, typename Cache::Retention retention) {
+      addRecord(pkey, solutionIdx, LookupFlagCanonical | (retention != Cache::Normal ? LookupFlagPreferred : 0));
+    });
+
+    LookupCacheFileHeader header;
+    lookupCacheFileHeader(&header, records.size() / (numSizes + 2));
+    std::vector<unsigned char> buffer(sizeof(header) + records.size() * sizeof(uint32_t));
+    memcpy(buffer.data(), &header, sizeof(header));
+    if (!records.empty())
+      memcpy(buffer.data() + sizeof(header), records.data(), records.size() * sizeof(uint32_t));
+    return tensileWriteFileAtomic(path, buffer.data(), buffer.size());
+  }
+
+  // Only valid once the mapper is materialized
+  const TensileLookupStats &lookupStats() const { return *_stats; };
+
+  // Bytes held by the active exact table, including the search structures built so far
+  size_t exactTableBytes() const {
+    return exactTable()->memoryBytes();
+  };
+
+  // Hit/miss/eviction counters and occupancy of the problem->solution lookup cache
+  typename LookupCache<ProblemKeyType, int>::Stats lookupCacheStats() const {
+    return _cachedLookups.stats();
   };
-  const std::string name() const { return _name; };
 
 private:
-  const std::string        _name;
+  // Cache a search result unless a logic file was loaded since the search started.
+  // Checked under _loadLogicMutex so a swap can not land between the check and the insert.
+  // canonical results go to _canonicalLookups, pkey is then the canonical key.
+  void cacheSearchResult(const ProblemKeyType &pkey, int solutionIdx, uint64_t generation,
+                         bool canonical=false) {
+    std::lock_guard<std::mutex> lockGuard(_loadLogicMutex);
+    if (generation == _tableGeneration.load(std::memory_order_relaxed))
+      (canonical ? _canonicalLookups : _cachedLookups).insert(pkey, solutionIdx);
+  }
+
+  void materializeOnce() {
+    const char *alg = std::getenv("TENSILE_FIND_ALG"); // If <0 see Algo enumeration, or >=0 specified specific solution index
+    if (alg) {
+      _findAlg = strtol(alg,nullptr,0);
+    }
+    if (_db & 0x1)
+      printf ("TENSILE_FIND_ALGO= %d (%s)\n", _findAlg, algoString(_findAlg));
+    const char *fallback = std::getenv("TENSILE_RANGE_FALLBACK_ALG");
+    if (fallback) {
+      _rangeFallbackAlg = strtol(fallback,nullptr,0);
+    }
+    if ((_db & 0x1) && _findAlg == SolutionMapperRuntime::RangeLogicAlgo)
+      printf ("TENSILE_RANGE_FALLBACK_ALG= %d (%s)\n", _rangeFallbackAlg, algoString(_rangeFallbackAlg));
+
+    size_t cacheSize = LOOKUP_CACHE_SIZE;
+    const char *cs = std::getenv("TENSILE_LOOKUP_CACHE_SIZE");
+    if (cs) {
+      cacheSize = strtoul(cs,nullptr,0);
+    }
+    _cachedLookups.setCapacity(cacheSize);
+    _canonicalLookups.setCapacity(cacheSize);
+
+    const char *canonicalize = std::getenv("TENSILE_CANONICALIZE");
+    if (!_canonicalizer.parse(canonicalize ? canonicalize : CANONICALIZE_RULES)) {
+      printf ("warning: %s ignoring malformed canonicalization rules \"%s\"\n", _name,
+              canonicalize ? canonicalize : CANONICALIZE_RULES);
+      _canonicalizer = ShapeCanonicalizer();
+    }
+    for (int si=0; si<ProblemKeyType::staticNumSizes(); si++) {
+      _canonicalizer.setIndexClass(si,
+          _problemType->isBatchIdx(si) ? ShapeCanonicalizer::BatchIndex :
+          _problemType->isSummationIdx(si) ? ShapeCanonicalizer::SummationIndex :
+          ShapeCanonicalizer::FreeIndex);
+    }
+
+    const char *autotune = std::getenv("TENSILE_AUTOTUNE");
+    if (autotune) {
+      _autotuneCandidates = strtoul(autotune,nullptr,0);
+    }
+
+    auto solutionTable = new SolutionMapperRuntime::SolutionRuntime[_numSolutions];
+    for (size_t i=0; i<_numSolutions; i++) {
+      solutionTable[i]._info = &_solutionInfo[i];
+    }
+    _solutionTable = solutionTable;
+
+    _stats.reset(new TensileLookupStats(_name, _solutionInfo, _numSolutions));
+
+    // The exact table is pre-sorted by TensileCreateLibrary and its rows are scanned in
+    // place ; only the logs for the ratio distance are built, on first use (see logSizeRow)
+    _exactTable.reset(new ExactTable(_embeddedExactTable ? *_embeddedExactTable : ExactTableData(), 0));
+
+    // Newer tuning results deployed without rebuilding the library:
+    const char *logicDir = std::getenv("TENSILE_LOGIC_PATH");
+    if (logicDir) {
+      _logicFile = std::string(logicDir) + "/" + _name + ".tensile_logic";
+      loadLogicFile(_logicFile);
+    }
+
+    // Warm-start the lookup cache from a previous run:
+    const char *cacheDir = std::getenv("TENSILE_LOOKUP_CACHE_PATH");
+    if (cacheDir) {
+      _lookupCacheFile = std::string(cacheDir) + "/" + _name + ".tensile_lookups";
+      int loaded = loadLookupCache(_lookupCacheFile);
+      if (_db & 0x8) {
+        printf ("info: mapper init - %s loaded %d cached lookups from %s\n",
+                _name, loaded, _lookupCacheFile.c_str());
+      }
+    }
+
+    if (_db & 0x8) {
+      printf ("info: materialized mapper %s - %zu solutions, %zu exact entries\n",
+              _name, _numSolutions, exactTable()->numExacts());
+    }
+  }
+
+  const char               *_name;
   const ProblemType        *_problemType;
 
+  std::once_flag            _materializeOnce;
+
+  // Generated (read-only) solution table, and the runtime state for each solution
+  // which is only allocated when the mapper is materialized
+  const SolutionInfo       *_solutionInfo;
   SolutionMapperRuntime::SolutionRuntime *   _solutionTable;
   size_t              _numSolutions;
 
-  // Two different structures supporting mapping from problems to solutions:
-  // Map for fast exact lookups and a vector for fast walking
-  std::map<const ProblemKeyType, int> _exactMap;
-  std::vector<PtoS>                   _exactVector;
+  // Exact problem->solution table generated by TensileCreateLibrary, sorted by sizes
+  const ExactTableData               *_embeddedExactTable;
+
+  // Active exact table - the embedded one or one loaded from a logic file.
+  // Only accessed through exactTable() / std::atomic_store so it can be swapped under lookups.
+  std::shared_ptr<const ExactTable>   _exactTable;
+  std::mutex                          _loadLogicMutex;
+  // Bumped by every swap so searches against the previous table are not cached
+  std::atomic<uint64_t>               _tableGeneration;
+
+  // Logic file reloaded by reloadLogic, empty if TENSILE_LOGIC_PATH is not set
+  std::string                         _logicFile;
+
+  // Rounding of problem sizes to share cache entries
+  ShapeCanonicalizer                  _canonicalizer;
+
+  // Flattened range logic generated by TensileCreateLibrary, nullptr if none
+  const RangeLogic                   *_rangeLogic;
+
+  // Bounded (CLOCK eviction) cache of problem->solutionIdx for every problem seen
+  LookupCache<ProblemKeyType, int>    _cachedLookups;
+  // Same for the canonical keys shared by several problems, see findAndCacheAlgorithm.
+  // Only probed with canonical keys, and each hit is checked against the problem.
+  LookupCache<ProblemKeyType, int>    _canonicalLookups;
+
+  // Problems being autotuned (by canonical key if they share a canonical bucket), and
+  // the best time of each of their candidates so far
+  struct AutotuneState {
+    AutotuneState() : _issued(0), _reported(0), _generation(0) {};
+    std::vector<int>    _candidates; // solutionIdx, closest first
+    std::vector<double> _bestMs;
+    size_t              _issued;
+    size_t              _reported;
+    uint64_t            _generation; // _tableGeneration the candidates were picked from
+  };
+  struct ProblemKeyHash {
+    size_t operator() (const ProblemKeyType &key) const { return key.hash(); }
+  };
+  size_t                              _autotuneCandidates;
+  std::mutex                          _autotuneMutex;
+  std::unordered_map<ProblemKeyType, AutotuneState, ProblemKeyHash> _autotuning;
+
+  // Hit/miss counters and latency histograms, see LookupStats.h
+  std::unique_ptr<TensileLookupStats> _stats;
+
+  // Persistent copy of the lookup caches, empty if TENSILE_LOOKUP_CACHE_PATH is not set
+  std::string                         _lookupCacheFile;
 
-  std::mutex                          _cachedMutex;
-  std::map<const ProblemKeyType, int> _cachedLookups;
+  // Hash of the solution and exact tables this mapper was generated from
+  uint64_t                            _libraryHash;
 
   // Algorithm that should be used to find nearest match - See Algo enum
   int                                 _findAlg;
+  // Algorithm used by RangeLogicAlgo for the problems the range logic does not cover
+  int                                 _rangeFallbackAlg;
 
   // Debug print control:
   int                                 _db;
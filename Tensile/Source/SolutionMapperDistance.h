@@ -0,0 +1,240 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+#include <limits>
+#include <math.h>
+
+/*******************************************************************************
+ * Batched distance kernels for the SolutionMapper nearest-match scan
+ *   - Candidate sizes are stored structure-of-arrays, one contiguous row per
+ *     size index, so each kernel streams over many candidates at once. Rows
+ *     hold the sizes themselves (unsigned int) or their logs (float) and are
+ *     widened to double as they are loaded.
+ *   - The kernels do the double operations of the scalar distance functors in
+ *     the same order (no fused multiply-add), so Euclidean and Manhattan
+ *     distances are bit-identical to them. Ratio distances differ by the float
+ *     rounding of the logs, see SolutionMapper::findNearestMatchSoA.
+ *   - Each accumulate kernel adds the contribution of one size index to a
+ *     block of distances; minimum then reduces the block.
+ *   - AVX2 / AVX-512 versions are selected at runtime when the host supports
+ *     them, otherwise the scalar loops (which the compiler may auto-vectorize)
+ *     are used.
+ ******************************************************************************/
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(__HIP_DEVICE_COMPILE__)
+#define TENSILE_DISTANCE_X86 1
+#include <immintrin.h>
+#else
+#define TENSILE_DISTANCE_X86 0
+#endif
+
+namespace SolutionMapperDistance {
+
+// Number of candidates evaluated per block - sized so the distance block stays in L1
+static const int BlockSize = 256;
+
+enum Metric {AbsDiff, SqrDiff};
+
+//--------------------
+// Scalar kernels
+template <class RowType>
+inline void accumulateScalar(Metric metric, double *dist, const RowType *row, double q, int n)
+{
+  if (metric == SqrDiff) {
+    for (int i=0; i<n; i++) {
+      double d = q - double(row[i]);
+      dist[i] += d*d;
+    }
+  } else {
+    for (int i=0; i<n; i++) {
+      dist[i] += ::fabs(q - double(row[i]));
+    }
+  }
+}
+
+inline double minScalar(const double *dist, int n)
+{
+  double best = std::numeric_limits<double>::max();
+  for (int i=0; i<n; i++) {
+    best = dist[i] < best ? dist[i] : best;
+  }
+  return best;
+}
+
+#if TENSILE_DISTANCE_X86
+//--------------------
+// AVX2 kernels
+
+// Load 4 row values widened to double
+__attribute__((target("avx2")))
+inline __m256d loadAvx2(const unsigned int *row)
+{
+  // No unsigned conversion before AVX-512: flip the sign bit, convert as signed, add 2^31 back
+  __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row)),
+                            _mm_set1_epi32(int(0x80000000u)));
+  return _mm256_add_pd(_mm256_cvtepi32_pd(v), _mm256_set1_pd(2147483648.0));
+}
+
+__attribute__((target("avx2")))
+inline __m256d loadAvx2(const float *row)
+{
+  return _mm256_cvtps_pd(_mm_loadu_ps(row));
+}
+
+template <class RowType>
+__attribute__((target("avx2")))
+inline void accumulateAvx2(Metric metric, double *dist, const RowType *row, double q, int n)
+{
+  const __m256d vq = _mm256_set1_pd(q);
+  const __m256d signMask = _mm256_set1_pd(-0.0);
+  int i=0;
+  if (metric == SqrDiff) {
+    for (; i+4<=n; i+=4) {
+      __m256d d = _mm256_sub_pd(vq, loadAvx2(row+i));
+      _mm256_storeu_pd(dist+i, _mm256_add_pd(_mm256_loadu_pd(dist+i), _mm256_mul_pd(d, d)));
+    }
+  } else {
+    for (; i+4<=n; i+=4) {
+      __m256d d = _mm256_andnot_pd(signMask, _mm256_sub_pd(vq, loadAvx2(row+i)));
+      _mm256_storeu_pd(dist+i, _mm256_add_pd(_mm256_loadu_pd(dist+i), d));
+    }
+  }
+  accumulateScalar(metric, dist+i, row+i, q, n-i);
+}
+
+__attribute__((target("avx2")))
+inline double minAvx2(const double *dist, int n)
+{
+  __m256d vmin = _mm256_set1_pd(std::numeric_limits<double>::max());
+  int i=0;
+  for (; i+4<=n; i+=4) {
+    vmin = _mm256_min_pd(_mm256_loadu_pd(dist+i), vmin); // NaN distances keep vmin
+  }
+  double lanes[4];
+  _mm256_storeu_pd(lanes, vmin);
+  double best = minScalar(lanes, 4);
+  double tail = minScalar(dist+i, n-i);
+  return tail < best ? tail : best;
+}
+
+//--------------------
+// AVX-512 kernels
+
+// Load 8 row values widened to double
+__attribute__((target("avx512f")))
+inline __m512d loadAvx512(const unsigned int *row)
+{
+  return _mm512_cvtepu32_pd(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(row)));
+}
+
+__attribute__((target("avx512f")))
+inline __m512d loadAvx512(const float *row)
+{
+  return _mm512_cvtps_pd(_mm256_loadu_ps(row));
+}
+
+template <class RowType>
+__attribute__((target("avx512f")))
+inline void accumulateAvx512(Metric metric, double *dist, const RowType *row, double q, int n)
+{
+  const __m512d vq = _mm512_set1_pd(q);
+  int i=0;
+  if (metric == SqrDiff) {
+    for (; i+8<=n; i+=8) {
+      __m512d d = _mm512_sub_pd(vq, loadAvx512(row+i));
+      _mm512_storeu_pd(dist+i, _mm512_add_pd(_mm512_loadu_pd(dist+i), _mm512_mul_pd(d, d)));
+    }
+  } else {
+    for (; i+8<=n; i+=8) {
+      __m512d d = _mm512_abs_pd(_mm512_sub_pd(vq, loadAvx512(row+i)));
+      _mm512_storeu_pd(dist+i, _mm512_add_pd(_mm512_loadu_pd(dist+i), d));
+    }
+  }
+  accumulateScalar(metric, dist+i, row+i, q, n-i);
+}
+
+__attribute__((target("avx512f")))
+inline double minAvx512(const double *dist, int n)
+{
+  __m512d vmin = _mm512_set1_pd(std::numeric_limits<double>::max());
+  int i=0;
+  for (; i+8<=n; i+=8) {
+    __m512d d = _mm512_loadu_pd(dist+i);
+    vmin = _mm512_mask_mov_pd(vmin, _mm512_cmp_pd_mask(d, vmin, _CMP_LT_OQ), d);
+  }
+  double lanes[8];
+  _mm512_storeu_pd(lanes, vmin);
+  double best = minScalar(lanes, 8);
+  double tail = minScalar(dist+i, n-i);
+  return tail < best ? tail : best;
+}
+
+// 0=scalar, 1=avx2, 2=avx512 ; probed once per process
+inline int isaLevel()
+{
+  static const int level = __builtin_cpu_supports("avx512f") ? 2 :
+                           __builtin_cpu_supports("avx2") ? 1 : 0;
+  return level;
+}
+#endif
+
+//--------------------
+// Dispatchers
+
+// dist[i] += metric(q, row[i]) for i in [0,n) ; RowType is unsigned int or float
+template <class RowType>
+inline void accumulate(Metric metric, double *dist, const RowType *row, double q, int n)
+{
+#if TENSILE_DISTANCE_X86
+  switch (isaLevel()) {
+    case 2: accumulateAvx512(metric, dist, row, q, n); return;
+    case 1: accumulateAvx2(metric, dist, row, q, n); return;
+  }
+#endif
+  accumulateScalar(metric, dist, row, q, n);
+}
+
+// Returns the smallest entry of dist[0,n), or std::numeric_limits<double>::max()
+// if no entry is below that (ie all candidates were masked off). NaN entries are ignored.
+inline double minimum(const double *dist, int n)
+{
+#if TENSILE_DISTANCE_X86
+  switch (isaLevel()) {
+    case 2: return minAvx512(dist, n);
+    case 1: return minAvx2(dist, n);
+  }
+#endif
+  return minScalar(dist, n);
+}
+
+// Index of the first entry equal to value, -1 if none
+inline int firstIndexOf(const double *dist, int n, double value)
+{
+  for (int i=0; i<n; i++) {
+    if (dist[i] == value)
+      return i;
+  }
+  return -1;
+}
+
+} // namespace SolutionMapperDistance
@@ -32,8 +32,12 @@ function(TensileCreateLibrary
     Tensile_LIBRARY_PRINT_DEBUG )
 
   # Tensile_ROOT can be specified instead of installing
+  # SPLIT_PROBLEM_TYPES builds each problem type into its own module, libTensile_<ProblemType>,
+  # loaded by libTensile on first use (see LibraryLoader.h) ; requires Tensile_MERGE_FILES
+  # WRITE_LOGIC_FILES also writes the binary logic files read from TENSILE_LOGIC_PATH at runtime
+  set(options SPLIT_PROBLEM_TYPES WRITE_LOGIC_FILES)
   set(oneValueArgs Tensile_ROOT)
-  cmake_parse_arguments(PARSE "" "${oneValueArgs}" "" ${ARGN})
+  cmake_parse_arguments(PARSE "${options}" "${oneValueArgs}" "" ${ARGN})
 
   if(PARSE_Tensile_ROOT)
     # python not pre-installed, use scripts downloaded to extern/Tensile
@@ -60,6 +64,14 @@ function(TensileCreateLibrary
     set(Tensile_CREATE_COMMAND ${Tensile_CREATE_COMMAND} "--no-short-file-names")
   endif()
 
+  if(PARSE_SPLIT_PROBLEM_TYPES)
+    set(Tensile_CREATE_COMMAND ${Tensile_CREATE_COMMAND} "--split-problem-types")
+  endif()
+
+  if(PARSE_WRITE_LOGIC_FILES)
+    set(Tensile_CREATE_COMMAND ${Tensile_CREATE_COMMAND} "--write-logic-files")
+  endif()
+
   if(${Tensile_PRINT_DEBUG})
     set(Tensile_CREATE_COMMAND ${Tensile_CREATE_COMMAND} "--library-print-debug")
   else()
@@ -101,12 +113,37 @@ function(TensileCreateLibrary
 
   # create Tensile Library
   set(options)
+  if(PARSE_SPLIT_PROBLEM_TYPES)
+    # the problem type modules resolve the runtime (device context, module registry, ...)
+    # from libTensile, so there is only one copy of it in the process
+    set(options SHARED)
+  endif()
   add_library(Tensile ${options} ${Tensile_SOURCE_FILES})
   # specify gpu targets
   set(Tensile_HIP_ISA "gfx803" "gfx900" "gfx906")
   foreach( target ${Tensile_HIP_ISA} )
     target_link_libraries( Tensile PRIVATE --amdgpu-target=${target} )
   endforeach()
+
+  # one module per problem type, with only its loader entry point exported
+  if(PARSE_SPLIT_PROBLEM_TYPES)
+    target_link_libraries( Tensile PRIVATE ${CMAKE_DL_LIBS} )
+    file(GLOB Tensile_PROBLEM_TYPES RELATIVE ${Tensile_SOURCE_PATH}/ProblemTypes
+      ${Tensile_SOURCE_PATH}/ProblemTypes/*)
+    foreach( problemType ${Tensile_PROBLEM_TYPES} )
+      set(problemTypePath ${Tensile_SOURCE_PATH}/ProblemTypes/${problemType})
+      file(GLOB problemTypeSourceFiles ${problemTypePath}/*.cpp)
+      add_library(Tensile_${problemType} MODULE ${problemTypeSourceFiles})
+      set_target_properties(Tensile_${problemType} PROPERTIES
+        CXX_VISIBILITY_PRESET hidden
+        VISIBILITY_INLINES_HIDDEN ON )
+      target_include_directories(Tensile_${problemType} PRIVATE ${problemTypePath})
+      target_link_libraries(Tensile_${problemType} PRIVATE Tensile)
+      foreach( target ${Tensile_HIP_ISA} )
+        target_link_libraries( Tensile_${problemType} PRIVATE --amdgpu-target=${target} )
+      endforeach()
+    endforeach()
+  endif()
   if( Tensile_MERGE_FILES )
     target_include_directories(Tensile
       PUBLIC $<BUILD_INTERFACE:${Tensile_SOURCE_PATH}> )
@@ -152,6 +152,35 @@ private:
 };
 
 
+// Exact table written by TensileCreateLibrary, structure-of-arrays so the one copy
+// serves both the binary-search exact lookups and the vectorized nearest-match scans.
+// Entries are sorted by sizes ; size si of entry i is sizes[si*numExacts + i].
+// Plain aggregate so the generated tables are constant-initialized in read-only
+// memory rather than constructed at static-init time.
+struct ExactTableData {
+  const unsigned int *sizes;
+  const int          *solutionIdx;
+  const float        *gflops; // measured performance of the solution for these sizes, 0 if unknown
+  unsigned int        numExacts;
+};
+
+// Rule in the flattened range logic written by TensileCreateLibrary.
+// The rules testing one size index are contiguous and the first rule with
+// size <= threshold applies ; the last rule of each group has threshold UINT_MAX.
+// next is the first rule of the group testing the next index in the index order,
+// or the solutionIdx if this is the last index.
+struct RangeRule {
+  unsigned int threshold;
+  int          next;
+};
+
+struct RangeLogic {
+  const unsigned int *indexOrder; // size index tested at each level
+  unsigned int        numLevels;
+  const RangeRule    *rules;     // group for the first level starts at rules[0]
+  unsigned int        numRules;
+};
+
 // Base template for ProblemKey
 // -  stores the sizes
 // -  supports hash generation and comparison for lookup
@@ -180,6 +209,14 @@ public:
                      (pdims.strideD(1) == pdims.strideC(1)));
 	}
 
+  // Used when reloading keys that were serialized with sizes() and equalStrides()
+  ProblemKey(const SizeType *sizes, bool equalStrides) {
+    for (int i=0; i<NumSizes; i++) {
+      _sizes[i] = sizes[i];
+    }
+    _equalStrides = equalStrides;
+  }
+
   bool operator< (const ProblemKey<NumSizes> & p) const
   {
     if (p._equalStrides != this->_equalStrides)
@@ -214,7 +251,9 @@ public:
   }
 
   const SizeType sizes(int i) const { return _sizes[i];};
+  bool equalStrides() const { return _equalStrides;};
   int numSizes() const { return NumSizes;};
+  static constexpr int staticNumSizes() { return NumSizes;};
 
   std::ostream &print(std::ostream &os) const {
     for (int i=0; i<NumSizes; i++) {
@@ -322,6 +361,9 @@ public:
   bool isBatchIdx(int idx) const {
     return std::find(_indicesBatch.begin(), _indicesBatch.end(), idx) != _indicesBatch.end();
   };
+  bool isSummationIdx(int idx) const {
+    return std::find(_indicesSummation.begin(), _indicesSummation.end(), idx) != _indicesSummation.end();
+  };
 
 private:
   const std::vector<int> _indicesFree;
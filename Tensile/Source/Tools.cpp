@@ -23,6 +23,16 @@
 #include "Tools.h"
 #include <ctype.h>
 #include <cmath>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#ifndef WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 // QueryPerformanceFrequency is defined to return in units of counts per second
 // QueryPerformanceCounter is defined to return in units of counts
@@ -97,3 +107,106 @@ double TensileTimer::elapsed_ns() {
 #endif
     return return_elapsed_ns;
 }
+
+
+/*******************************************************************************
+ * Memory mapped file
+ ******************************************************************************/
+TensileMappedFile::TensileMappedFile() : _data(nullptr), _size(0) {
+}
+
+TensileMappedFile::~TensileMappedFile() {
+  close();
+}
+
+bool TensileMappedFile::open(const std::string &path) {
+  close();
+#ifdef WIN32
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f)
+    return false;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (size <= 0) {
+    fclose(f);
+    return false;
+  }
+  unsigned char *buffer = new unsigned char[size];
+  if (fread(buffer, 1, size, f) != (size_t)size) {
+    delete[] buffer;
+    fclose(f);
+    return false;
+  }
+  fclose(f);
+  _data = buffer;
+  _size = size;
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+  void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd); // mapping stays valid after close
+  if (p == MAP_FAILED)
+    return false;
+  _data = static_cast<const unsigned char *>(p);
+  _size = st.st_size;
+#endif
+  return true;
+}
+
+void TensileMappedFile::close() {
+  if (_data) {
+#ifdef WIN32
+    delete[] _data;
+#else
+    munmap(const_cast<unsigned char *>(_data), _size);
+#endif
+  }
+  _data = nullptr;
+  _size = 0;
+}
+
+bool tensileWriteFileAtomic(const std::string &path, const void *data, size_t size) {
+  // Unique per thread, so writers of the same path never share the temporary file
+  std::string tmpId = std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+#ifdef WIN32
+  std::string tmpPath = path + ".tmp." + tmpId;
+#else
+  std::string tmpPath = path + ".tmp." + std::to_string(getpid()) + "." + tmpId;
+#endif
+  FILE *f = fopen(tmpPath.c_str(), "wb");
+  if (!f)
+    return false;
+  bool ok = fwrite(data, 1, size, f) == size;
+  ok = (fclose(f) == 0) && ok;
+#ifdef WIN32
+  remove(path.c_str()); // rename does not replace on windows
+#endif
+  if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+    remove(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool tensileMakeDirectories(const std::string &path) {
+  for (size_t end = 1; end <= path.size(); end++) {
+    if (end < path.size() && path[end] != '/' && path[end] != '\\')
+      continue;
+    std::string parent = path.substr(0, end);
+#ifdef WIN32
+    if (!CreateDirectoryA(parent.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+      return false;
+#else
+    if (mkdir(parent.c_str(), 0755) != 0 && errno != EEXIST)
+      return false;
+#endif
+  }
+  return true;
+}
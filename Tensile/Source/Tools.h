@@ -59,6 +59,37 @@ private:
 #endif
 };
 
+/*******************************************************************************
+ * Read-only memory mapped file
+ *   - On WIN32 the file is read into a heap buffer instead.
+ ******************************************************************************/
+class TensileMappedFile {
+public:
+  TensileMappedFile();
+  ~TensileMappedFile();
+
+  // Returns false if the file can not be opened or mapped
+  bool open(const std::string &path);
+  void close();
+
+  const unsigned char *data() const { return _data; };
+  size_t size() const { return _size; };
+
+private:
+  TensileMappedFile(const TensileMappedFile &);
+  TensileMappedFile &operator=(const TensileMappedFile &);
+
+  const unsigned char *_data;
+  size_t               _size;
+};
+
+// Write size bytes to path via a temporary file and rename, so concurrent
+// readers only ever see a complete file. Returns false on failure.
+bool tensileWriteFileAtomic(const std::string &path, const void *data, size_t size);
+
+// Create the directory path and its missing parents. Returns false on failure.
+bool tensileMakeDirectories(const std::string &path);
+
 
 #define tensileMin(a,b) (((a) < (b)) ? (a) : (b))
 #define tensileMax(a,b) (((a) > (b)) ? (a) : (b))
@@ -27,6 +27,8 @@ from KernelWriterSource import KernelWriterSource
 from KernelWriterAssembly import KernelWriterAssembly
 import multiprocessing
 
+import hashlib
+import struct
 import os
 import sys
 import os.path
@@ -101,6 +103,57 @@ def prepAsm():
   assemblerFile.close()
   os.chmod(assemblerFileName, 0777)
 
+################################################################################
+# Write Code Object Archive
+# bundle the code objects of the assembly kernels into assembly/<CodeObjectArchive>,
+# which the module registry maps once in place of the separate .co files.
+# Layout must match CodeObjectArchiveHeader / CodeObjectArchiveEntry in ModuleRegistry.h
+################################################################################
+def writeCodeObjectArchive(kernels, kernelWriterAssembly, kernelsWithBuildErrs):
+  asmPath = os.path.join(globalParameters["WorkingPath"], "assembly")
+  members = []
+  for kernel in kernels:
+    if kernel["KernelLanguage"] != "Assembly":
+      continue
+    kernelName = kernelWriterAssembly.getKernelName(kernel)
+    codeObjectFileName = os.path.join(asmPath, "%s.co" % kernelName)
+    if kernelName in kernelsWithBuildErrs or not os.path.isfile(codeObjectFileName):
+      continue
+    isa = kernel["ISA"]
+    members.append((kernelName, isa[0]*100 + isa[1]*10 + isa[2], codeObjectFileName))
+  # sorted by name then ISA so the index can be binary searched in place
+  members = sorted(set(members))
+
+  alignment = 4096 # code objects start on a page
+  def alignUp(n):
+    return (n + alignment-1) / alignment * alignment
+
+  names = ""
+  for (kernelName, isa, codeObjectFileName) in members:
+    names += kernelName + "\0"
+  namesOffset = 32 + 32*len(members) # after the header and the index
+  offset = alignUp(namesOffset + len(names))
+
+  entries = ""
+  nameOffset = 0
+  for (kernelName, isa, codeObjectFileName) in members:
+    codeObjectSize = os.path.getsize(codeObjectFileName)
+    entries += struct.pack("<QQIIII", offset, codeObjectSize, nameOffset, len(kernelName), isa, 0)
+    nameOffset += len(kernelName) + 1
+    offset = alignUp(offset + codeObjectSize)
+
+  header = struct.pack("<8sIIQQ", "TNSLCOBJ", 1, len(members), namesOffset, len(names))
+  archiveFileName = os.path.join(asmPath, globalParameters["CodeObjectArchive"])
+  archiveFile = open(archiveFileName, "wb")
+  archiveFile.write(header + entries + names)
+  for (kernelName, isa, codeObjectFileName) in members:
+    archiveFile.write("\0"*(alignUp(archiveFile.tell()) - archiveFile.tell()))
+    codeObjectFile = open(codeObjectFileName, "rb")
+    archiveFile.write(codeObjectFile.read())
+    codeObjectFile.close()
+  archiveFile.close()
+  print1("# Wrote %u code objects to %s" % (len(members), archiveFileName))
+
 ################################################################################
 # processResults
 # input: results is list with (err, src, header, kernelName)
@@ -136,9 +189,11 @@ def processResults(results, outputPath, kernelsWithBuildErrs, \
 
 ################################################################################
 # Write Solutions and Kernels for BenchmarkClient or LibraryClient
+# returns the kernels that failed to build ; writeArchive=False leaves the
+# code object archive to the caller
 ################################################################################
 def writeSolutionsAndKernels(outputPath, problemTypes, solutions, kernels, kernelsBetaOnly, \
-    solutionWriter, kernelWriterSource, kernelWriterAssembly):
+    solutionWriter, kernelWriterSource, kernelWriterAssembly, writeArchive=True):
   start = time.time()
   print1("# Writing Kernels...")
   if not globalParameters["MergeFiles"]:
@@ -291,6 +346,9 @@ def writeSolutionsAndKernels(outputPath, problemTypes, solutions, kernels, kerne
   if globalParameters["MergeFiles"]:
     kernelHeaderFile.close()
 
+  if writeArchive and globalParameters["CodeObjectArchive"] and globalParameters["CodeFromFiles"]:
+    writeCodeObjectArchive(kernels, kernelWriterAssembly, kernelsWithBuildErrs)
+
   stop = time.time()
   print "# Kernel Building elapsed time = %.1f secs" % (stop-start)
 
@@ -330,6 +388,15 @@ def writeSolutionsAndKernels(outputPath, problemTypes, solutions, kernels, kerne
     for i in range(0, len(argListAll)):
       h += "    %s %s%s" % (argListAll[i][0], argListAll[i][1], ",\n" \
           if i < len(argListAll)-1 else ");\n\n")
+    # declare plan and execute pointers, see SolutionLaunch
+    for (pointerName, argList) in [ \
+        ("Plan", solutionWriter.getPlanArgList(problemType)), \
+        ("Execute", solutionWriter.getExecuteArgList(problemType))]:
+      h += "typedef TensileStatus (*TensileSolution%sPointer_%s)(\n" \
+          % (pointerName, problemType)
+      for i in range(0, len(argList)):
+        h += "    %s %s%s" % (argList[i][0], argList[i][1], ",\n" \
+            if i < len(argList)-1 else ");\n\n")
     h += "\n"
 
   solutionHeaderFile.write(h)
@@ -367,6 +434,8 @@ def writeSolutionsAndKernels(outputPath, problemTypes, solutions, kernels, kerne
   if globalParameters["ExitAfterKernelGen"]:
     printExit("** Exiting after kernel generation due to ExitAfterKernelGen=1")
 
+  return kernelsWithBuildErrs
+
 
 ################################################################################
 # Write Logic
@@ -383,6 +452,8 @@ def writeLogic(outputPath, logicData, solutionWriter ):
   h += "#include \"TensileTypes.h\"\n"
   h += "#include \"SolutionHelper.h\"\n"
   h += "#include \"SolutionMapper.h\"\n"
+  h += "\n// reload the logic files of TENSILE_LOGIC_PATH, returns the number of tables replaced\n"
+  h += "int tensileReloadLogic();\n"
 
   # TensileInternal.h
   ih = ""
@@ -395,6 +466,14 @@ def writeLogic(outputPath, logicData, solutionWriter ):
   s += "#include \"TensileInternal.h\"\n"
   s += "#include \"SolutionMapper.h\"\n"
 
+  # Tensile.cpp with --split-problem-types: stubs loading the library of each
+  # problem type on first use, see LibraryLoader.h
+  splitProblemTypes = globalParameters["SplitProblemTypes"]
+  stubs = ""
+  stubs += "#include \"Tensile.h\"\n"
+  stubs += "#include \"TensileInternal.h\"\n"
+  stubs += "#include \"LibraryLoader.h\"\n"
+
   ########################################
   # problemType
   for problemType in logicData:
@@ -428,6 +507,46 @@ def writeLogic(outputPath, logicData, solutionWriter ):
     h += "typedef SolutionMapper<ProblemDims_%s, ProblemKey_%s> SolutionMapper_%s;\n" \
             % (problemType, problemType, problemType)
 
+    # declare launch plans
+    numDims = len(argListSizes)
+    argListExecute = solutionWriter.getExecuteArgList(problemType)[2:] # minus solutionLock, launch
+    h += "\n// launch plans: the solution, launch sizes and kernel arguments of a problem are\n"
+    h += "// computed once by tensileCreatePlan, then tensileExecutePlan only takes the data,\n"
+    h += "// alpha/beta and stream. A plan must be executed on the device it was created on.\n"
+    h += "typedef TensilePlan<%u> TensilePlan_%s;\n" % (numDims, problemType)
+    h += "TensileStatus tensileCreatePlan_%s(\n" % problemType
+    h += "    TensilePlan_%s **plan,\n" % problemType
+    for i in range(0, len(argListSizes)):
+      h += "    %s %s%s" \
+          % (argListSizes[i][0], argListSizes[i][1], \
+          ",\n" if i < len(argListSizes)-1 else ");\n")
+    h += "TensileStatus tensileExecutePlan_%s(\n" % problemType
+    h += "    const TensilePlan_%s *plan,\n" % problemType
+    for i in range(0, len(argListExecute)):
+      h += "    %s %s%s" \
+          % (argListExecute[i][0], argListExecute[i][1], \
+          ",\n" if i < len(argListExecute)-1 else ");\n")
+    h += "void tensileDestroyPlan_%s(TensilePlan_%s *plan);\n" % (problemType, problemType)
+
+    # declare grouped call
+    argListProblem = solutionWriter.getArgList(problemType, False, True, False, False)
+    argListGroup = [arg for arg in argListData if arg not in argListProblem] # stream and events
+    h += "\n// grouped call: enqueues a group of independent problems of different sizes.\n"
+    h += "// Problems sharing a solution are launched back-to-back; the input events gate the\n"
+    h += "// first launch and the output event is recorded by the last one. Nothing is\n"
+    h += "// enqueued if a problem has no solution.\n"
+    h += "struct TensileGroupedProblem_%s {\n" % problemType
+    for arg in argListProblem:
+      h += "  %s %s;\n" % arg
+    h += "};\n"
+    h += "TensileStatus tensileGrouped_%s(\n" % problemType
+    h += "    unsigned int numProblems,\n"
+    h += "    const TensileGroupedProblem_%s *problems,\n" % problemType
+    for i in range(0, len(argListGroup)):
+      h += "    %s %s%s" \
+          % (argListGroup[i][0], argListGroup[i][1], \
+          ",\n" if i < len(argListGroup)-1 else ");\n")
+
     # declare tensileGetSolutionPointer_ProblemType
     h += "\n// get solution pointer\n"
     h += "SolutionMapper_%s::SolutionRuntime *\n" % (problemType)
@@ -437,6 +556,22 @@ def writeLogic(outputPath, logicData, solutionWriter ):
           % (argListSizes[i][0], argListSizes[i][1], \
           ",\n" if i < len(argListSizes)-1 else ");\n\n")
 
+    # declare tensileGetSolutionPointers_ProblemType
+    h += "// get solution pointers for a batch of problems, solutions[i]=nullptr if none found\n"
+    h += "// returns tensileStatusFailure if any problem has no solution\n"
+    h += "TensileStatus tensileGetSolutionPointers_%s(\n" % (problemType)
+    h += "    unsigned int numProblems,\n"
+    h += "    const ProblemDims_%s *problems,\n" % (problemType)
+    h += "    SolutionMapper_%s::SolutionRuntime **solutions);\n\n" % (problemType)
+
+    # declare tensileGetSolutionCandidates_ProblemType
+    h += "// get up to k candidate solutions for the problem, closest first ; returns the number found\n"
+    h += "unsigned int tensileGetSolutionCandidates_%s(\n" % (problemType)
+    h += "    const ProblemDims_%s &problem,\n" % (problemType)
+    h += "    unsigned int k,\n"
+    h += "    SolutionMapper_%s::SolutionCandidate *candidates,\n" % (problemType)
+    h += "    bool includeInvalid);\n\n"
+
     # declare tensileName_
     h += "// get solution name\n"
     h += "const char * tensileGetSolutionName_%s(\n" \
@@ -462,7 +597,13 @@ def writeLogic(outputPath, logicData, solutionWriter ):
       solutionNamesForProblemType.append(solutionName)
 
     # reset problemType source
-    if not globalParameters["MergeFiles"]:
+    if splitProblemTypes:
+      s = "#include \"Solutions.h\"\n"
+      s += "#include \"Tensile.h\"\n"
+      s += "#include \"TensileInternal.h\"\n"
+      s += "#include \"SolutionMapper.h\"\n"
+      s += "#include \"LibraryLoader.h\"\n"
+    elif not globalParameters["MergeFiles"]:
       filePrefix = "Tensile_%s" % (problemType)
       s = "#include \"TensileTypes.h\"\n"
       s = "#include \"Tensile.h\"\n"
@@ -508,14 +649,22 @@ def writeLogic(outputPath, logicData, solutionWriter ):
 
       # solution names for schedule
       solutionNamesForSchedule = []
+      kernelInfoForSchedule = []
+      planInfoForSchedule = []
       for solution in solutionsForSchedule:
         solutionName = solutionWriter.getSolutionName(solution)
         solutionNamesForSchedule.append(solutionName)
+        kernelInfoForSchedule.append(solutionWriter.getKernelInfoInitializer(solution))
+        planInfoForSchedule.append(solutionWriter.getPlanInfoInitializer(solution))
 
       s += "\n\n"
       schedProbName = "%s_%s" % (scheduleName, problemType)
       s += writeSolutionAndExactTable(scheduleName, deviceNames, schedProbName, problemType, \
-              solutionsForSchedule, solutionNamesForSchedule, exactLogic)
+              solutionsForSchedule, solutionNamesForSchedule, kernelInfoForSchedule, \
+              planInfoForSchedule, exactLogic, indexOrder, rangeLogic)
+      if globalParameters["WriteLogicFiles"]:
+        writeLogicFile(outputPath, schedProbName, problemType["TotalIndices"], \
+            solutionsForSchedule, solutionNamesForSchedule, exactLogic)
 
 
     # Per-problem function here:
@@ -533,13 +682,37 @@ def writeLogic(outputPath, logicData, solutionWriter ):
     exactLogicStr = writeExactLogic(problemType, indexOrder, \
                                     solutionsForSchedule, exactLogic, \
                                     solutionNamesForSchedule, True)
-    if rangeLogic != None:
-      print "** warning: ignored ranges in logic file, these should have been expanded with ExpandRanges=1 during Tensile phase 3"
     s += "  /* exact mappings */\n"
     s += exactLogicStr
     s += "\n  return nullptr;\n"
     s += "\n}\n"
 
+    # function tensileGetSolutionPointers_ProblemType
+    s += "\n// batch of problem dims -> solutions\n"
+    s += "TensileStatus tensileGetSolutionPointers_%s(\n" % (problemType)
+    s += "    unsigned int numProblems,\n"
+    s += "    const ProblemDims_%s *problems,\n" % (problemType)
+    s += "    SolutionMapper_%s::SolutionRuntime **solutions) {\n\n" % (problemType)
+    s += "  auto solutionMapper = reinterpret_cast<SolutionMapper_%s *> (masterSolutionMapper_%s.mapper());\n" \
+        % (problemType, problemType)
+    s += "  size_t numMissing = solutionMapper->getSolutionsWithFallback(problems, numProblems, solutions, &masterSolutionMapper_%s);\n" \
+        % (problemType)
+    s += "  return numMissing ? tensileStatusFailure : tensileStatusSuccess;\n"
+    s += "}\n"
+
+    # function tensileGetSolutionCandidates_ProblemType
+    s += "\n// problem dims -> ranked candidate solutions\n"
+    s += "unsigned int tensileGetSolutionCandidates_%s(\n" % (problemType)
+    s += "    const ProblemDims_%s &problem,\n" % (problemType)
+    s += "    unsigned int k,\n"
+    s += "    SolutionMapper_%s::SolutionCandidate *candidates,\n" % (problemType)
+    s += "    bool includeInvalid) {\n\n"
+    s += "  auto solutionMapper = masterSolutionMapper_%s.mapper();\n" % (problemType)
+    s += "  if (solutionMapper == nullptr)\n"
+    s += "    solutionMapper = masterSolutionMapper_%s.fallbackMapper();\n" % (problemType)
+    s += "  return static_cast<unsigned int>(solutionMapper->getCandidates(problem, k, candidates, includeInvalid));\n"
+    s += "}\n"
+
     # function tensileGetSolutionName_Schedule_ProblemType
     s += "\n// get solution name for problem dims\n"
     s += "const char * tensileGetSolutionName_%s(\n" \
@@ -569,27 +742,165 @@ def writeLogic(outputPath, logicData, solutionWriter ):
       s += "    %s %s%s" \
           % (argListData[i][0], argListData[i][1], \
           ",\n" if i < len(argListData)-1 else ") {\n")
-    s += "    auto solution = tensileGetSolutionPointer_%s(\n" % (problemType)
-    for i in range(0, len(argListSizes)):
-      s += "        %s%s" \
-          % (argListSizes[i][1], ", " if i < len(argListSizes)-1 else ");")
-      s += "\n"
-    s += "    if (solution) {\n"
-    s += "      TensileSolutionPointer_%s f = reinterpret_cast<TensileSolutionPointer_%s> (solution->_info->_functionPtr);\n" \
+    s += "    " + writeProblemDims(problemType, indexOrder)
+    s += "    auto solutionMapper = reinterpret_cast<SolutionMapper_%s *> (masterSolutionMapper_%s.mapper());\n" \
+        % (problemType, problemType)
+    s += "    return solutionMapper->launchWithAutotune(pdims, &masterSolutionMapper_%s, stream,\n" \
+        % (problemType)
+    s += "      [&](SolutionMapper_%s::SolutionRuntime *solution) -> TensileStatus {\n" % (problemType)
+    s += "        TensileSolutionPointer_%s f = reinterpret_cast<TensileSolutionPointer_%s> (solution->_info->_functionPtr);\n" \
       % (problemType, problemType)
-    s += "      auto solutionLock = &solution->_lock;\n"
-    s += "      return f("
+    s += "        auto solutionLock = &solution->_lock;\n"
+    s += "        return f("
     for i in range(0, len(argListAll)):
       s += "%s%s" \
           % (argListAll[i][1], ", " if i < len(argListAll)-1 else ");\n")
-    s += "    } else {\n"
-    #s += "      printf(\"solution not valid, returning fail\\n\");"
-    s += "      return tensileStatusFailure; // no solution found\n"
+    s += "      });\n"
+    s += "}\n"
+
+    # launch plans
+    s += "\n// problem dims -> solution and its precomputed launch\n"
+    s += "TensileStatus tensileCreatePlan_%s(\n" % problemType
+    s += "    TensilePlan_%s **plan,\n" % problemType
+    for i in range(0, len(argListSizes)):
+      s += "    %s %s%s" \
+          % (argListSizes[i][0], argListSizes[i][1], \
+          ",\n" if i < len(argListSizes)-1 else ") {\n")
+    s += "    " + writeProblemDims(problemType, indexOrder)
+    s += "    const unsigned int dims[] = {%s};\n" \
+        % ", ".join([arg[1] for arg in argListSizes])
+    s += "    auto solutionMapper = reinterpret_cast<SolutionMapper_%s *> (masterSolutionMapper_%s.mapper());\n" \
+        % (problemType, problemType)
+    s += "    return solutionMapper->createPlan(pdims, dims, &masterSolutionMapper_%s,\n" \
+        % (problemType)
+    s += "      [&](SolutionMapper_%s::SolutionRuntime *solution, SolutionLaunch *launch) -> TensileStatus {\n" \
+        % (problemType)
+    s += "        TensileSolutionPlanPointer_%s planFunction = reinterpret_cast<TensileSolutionPlanPointer_%s> (solution->_info->_planFunctionPtr);\n" \
+        % (problemType, problemType)
+    s += "        return planFunction(launch, %s);\n" \
+        % ", ".join([arg[1] for arg in argListSizes])
+    s += "      }, plan);\n"
+    s += "}\n"
+
+    s += "\n// enqueue the solution of a plan\n"
+    s += "TensileStatus tensileExecutePlan_%s(\n" % problemType
+    s += "    const TensilePlan_%s *plan,\n" % problemType
+    for i in range(0, len(argListExecute)):
+      s += "    %s %s%s" \
+          % (argListExecute[i][0], argListExecute[i][1], \
+          ",\n" if i < len(argListExecute)-1 else ") {\n")
+    s += "    return SolutionMapper_%s::executePlan(plan,\n" % problemType
+    s += "      [&](SolutionMapper_%s::SolutionRuntime *solution, const SolutionLaunch *launch) -> TensileStatus {\n" \
+        % (problemType)
+    s += "        TensileSolutionExecutePointer_%s execute = reinterpret_cast<TensileSolutionExecutePointer_%s> (solution->_info->_executeFunctionPtr);\n" \
+        % (problemType, problemType)
+    s += "        return execute(&solution->_lock, launch, %s);\n" \
+        % ", ".join([arg[1] for arg in argListExecute])
+    s += "      },\n"
+    s += "      // no precomputed launch: call the solution with the dims of the plan\n"
+    s += "      [&](SolutionMapper_%s::SolutionRuntime *solution, const unsigned int *dims) -> TensileStatus {\n" \
+        % (problemType)
+    s += "        TensileSolutionPointer_%s f = reinterpret_cast<TensileSolutionPointer_%s> (solution->_info->_functionPtr);\n" \
+      % (problemType, problemType)
+    callArgs = []
+    for arg in argListAll:
+      if arg[1] == "solutionLock":
+        callArgs.append("&solution->_lock")
+      elif arg in argListSizes:
+        callArgs.append("dims[%u]" % argListSizes.index(arg))
+      else:
+        callArgs.append(arg[1])
+    s += "        return f(%s);\n" % ", ".join(callArgs)
+    s += "      });\n"
+    s += "}\n"
+
+    s += "\nvoid tensileDestroyPlan_%s(TensilePlan_%s *plan) {\n" % (problemType, problemType)
+    s += "    delete plan;\n"
+    s += "}\n"
+
+    # grouped call
+    s += "\n// group of problems -> solutions, enqueued grouped by solution\n"
+    s += "TensileStatus tensileGrouped_%s(\n" % problemType
+    s += "    unsigned int numProblems,\n"
+    s += "    const TensileGroupedProblem_%s *problems,\n" % problemType
+    for i in range(0, len(argListGroup)):
+      s += "    %s %s%s" \
+          % (argListGroup[i][0], argListGroup[i][1], \
+          ",\n" if i < len(argListGroup)-1 else ") {\n")
+    s += "    if (numProblems == 0)\n"
+    s += "      return tensileStatusSuccess;\n"
+    s += "    std::vector<ProblemDims_%s> problemDims;\n" % problemType
+    s += "    problemDims.reserve(numProblems);\n"
+    s += "    for (unsigned int p = 0; p < numProblems; p++) {\n"
+    s += "      const TensileGroupedProblem_%s &problem = problems[p];\n" % problemType
+    s += "      " + writeProblemDims(problemType, indexOrder, "problem.")
+    s += "      problemDims.push_back(pdims);\n"
     s += "    }\n"
+    s += "    auto solutionMapper = reinterpret_cast<SolutionMapper_%s *> (masterSolutionMapper_%s.mapper());\n" \
+        % (problemType, problemType)
+    s += "    return solutionMapper->launchGrouped(problemDims.data(), numProblems, &masterSolutionMapper_%s,\n" \
+        % (problemType)
+    s += "      [&](unsigned int p, SolutionMapper_%s::SolutionRuntime *solution, SolutionLaunch *launch) -> TensileStatus {\n" \
+        % (problemType)
+    s += "        TensileSolutionPlanPointer_%s planFunction = reinterpret_cast<TensileSolutionPlanPointer_%s> (solution->_info->_planFunctionPtr);\n" \
+        % (problemType, problemType)
+    s += "        if (planFunction == nullptr)\n"
+    s += "          return tensileStatusSuccess;\n"
+    s += "        const TensileGroupedProblem_%s &problem = problems[p];\n" % problemType
+    s += "        return planFunction(launch, %s);\n" \
+        % ", ".join(["problem.%s" % arg[1] for arg in argListSizes])
+    s += "      },\n"
+    s += "      [&](unsigned int p, SolutionMapper_%s::SolutionRuntime *solution, SolutionLaunch *launch, bool first, bool last) -> TensileStatus {\n" \
+        % (problemType)
+    s += "        const TensileGroupedProblem_%s &problem = problems[p];\n" % problemType
+    # events of the whole group go to its first and last launch
+    groupArgs = {}
+    for arg in argListGroup:
+      if arg[1] == "numInputEvents":
+        s += "        %s problemNumInputEvents = first ? numInputEvents : 0;\n" % arg[0]
+        groupArgs[arg[1]] = "problemNumInputEvents"
+      elif arg[1] == "inputEvents":
+        s += "        %s problemInputEvents = first ? inputEvents : nullptr;\n" % arg[0]
+        groupArgs[arg[1]] = "problemInputEvents"
+      elif arg[1] == "outputEvent":
+        s += "        %s problemOutputEvent = last ? outputEvent : nullptr;\n" % arg[0]
+        groupArgs[arg[1]] = "problemOutputEvent"
+      else:
+        groupArgs[arg[1]] = arg[1]
+    callArgs = []
+    for arg in argListAll:
+      if arg[1] == "solutionLock":
+        callArgs.append("&solution->_lock")
+      elif arg[1] in groupArgs:
+        callArgs.append(groupArgs[arg[1]])
+      else:
+        callArgs.append("problem.%s" % arg[1])
+    executeArgs = ["&solution->_lock", "launch"] \
+        + [arg for arg in callArgs[1:] if not arg[len("problem."):] in [a[1] for a in argListSizes]]
+    s += "        TensileSolutionExecutePointer_%s execute = reinterpret_cast<TensileSolutionExecutePointer_%s> (solution->_info->_executeFunctionPtr);\n" \
+        % (problemType, problemType)
+    s += "        if (execute)\n"
+    s += "          return execute(%s);\n" % ", ".join(executeArgs)
+    s += "        TensileSolutionPointer_%s f = reinterpret_cast<TensileSolutionPointer_%s> (solution->_info->_functionPtr);\n" \
+        % (problemType, problemType)
+    s += "        return f(%s);\n" % ", ".join(callArgs)
+    s += "      });\n"
     s += "}\n"
 
     # open and close problemType files
-    if not globalParameters["MergeFiles"]:
+    if splitProblemTypes:
+      entryPoints = getLibraryEntryPoints(problemType, argListData, argListSizes, \
+          argListExecute, argListGroup)
+      ih += writeLibraryTable(problemType, entryPoints)
+      s += "\n"
+      s += writeTensileInitialize({problemType: logicData[problemType]}, "_%s" % problemType)
+      s += writeLibraryEntryPoint(problemType, entryPoints)
+      stubs += writeLibraryStubs(problemType, entryPoints)
+      logicSourceFile = open(os.path.join(outputPath, "ProblemTypes", \
+          str(problemType), "Tensile_%s.cpp" % problemType), "w")
+      logicSourceFile.write(s)
+      logicSourceFile.close()
+    elif not globalParameters["MergeFiles"]:
       logicSourceFile = open(os.path.join(outputPath, "Logic", \
           "%s.cpp" % filePrefix), "w")
       logicSourceFile.write(s)
@@ -599,7 +910,14 @@ def writeLogic(outputPath, logicData, solutionWriter ):
   s += writeTensileInitialize(logicData)
 
   # close merged files
-  if globalParameters["MergeFiles"]:
+  if splitProblemTypes:
+    stubs += "\n"
+    stubs += writeTensileInitializeStubs(logicData)
+    logicSourceFile = open(os.path.join(outputPath, \
+        "Tensile.cpp"), "w")
+    logicSourceFile.write(stubs)
+    logicSourceFile.close()
+  elif globalParameters["MergeFiles"]:
     logicSourceFile = open(os.path.join(outputPath, \
         "Tensile.cpp"), "w")
     logicSourceFile.write(s)
@@ -616,12 +934,18 @@ def writeLogic(outputPath, logicData, solutionWriter ):
   internalHeaderFile.close()
 
 
-def writeTensileInitialize(logicData):
+################################################################################
+# Write tensileInitialize and tensileReloadLogic
+# with a suffix, ie "_<ProblemType>", writes static versions for one problem
+# type library instead
+################################################################################
+def writeTensileInitialize(logicData, suffix=""):
 
+  storage = "static " if suffix else ""
   s = "/*******************************************************************************\n"
   s += "* Tensilze initializer\n"
   s += "*******************************************************************************/\n"
-  s += "void tensileInitialize() {\n"
+  s += "%svoid tensileInitialize%s() {\n" % (storage, suffix)
 
   for problemType in logicData:
     s += "  masterSolutionMapper_%s.initialize();\n" % problemType
@@ -635,28 +959,171 @@ def writeTensileInitialize(logicData):
       s += "  solutionMapper_%s.initializeMappers(" % (schedProbName)
       s += "{%s}," % (', '.join('"{0}"'.format(w) for w in deviceNames))
       s += "&masterSolutionMapper_%s);\n" % (problemType)
-      
+
+  s += "\n"
+  s += "  // Load code objects in the background, see TENSILE_PRELOAD in Preloader.h\n"
+  s += "  TensilePreloader &preloader = TensilePreloader::instance();\n"
+  s += "  if (preloader.enabled()) {\n"
+  for problemType in logicData:
+    s += "    masterSolutionMapper_%s.addPreloads(preloader);\n" % problemType
+  s += "    preloader.start();\n"
+  s += "  }\n"
+  s += "}\n\n"
+
+  s += "%sint tensileReloadLogic%s() {\n" % (storage, suffix)
+  s += "  int reloaded = 0;\n"
+  for problemType in logicData:
+    for scheduleTuple in logicData[problemType]:
+      schedProbName = "%s_%s" % (scheduleTuple[0], problemType)
+      s += "  reloaded += (solutionMapper_%s.reloadLogic() >= 0);\n" % (schedProbName)
+  s += "  return reloaded;\n"
   s += "}"
 
   return s
 
+################################################################################
+# Library Entry Points
+# public functions of a problem type, as
+# (table member, return type, function name, argument list, value on failure)
+################################################################################
+def getLibraryEntryPoints(problemType, argListData, argListSizes, argListExecute, \
+    argListGroup):
+  pt = str(problemType)
+  return [ \
+      ("enqueue", "TensileStatus", "tensile_%s" % pt, \
+          argListData, "tensileStatusFailure"), \
+      ("createPlan", "TensileStatus", "tensileCreatePlan_%s" % pt, \
+          [("TensilePlan_%s **" % pt, "plan")] + argListSizes, "tensileStatusFailure"), \
+      ("executePlan", "TensileStatus", "tensileExecutePlan_%s" % pt, \
+          [("const TensilePlan_%s *" % pt, "plan")] + argListExecute, "tensileStatusFailure"), \
+      ("destroyPlan", "void", "tensileDestroyPlan_%s" % pt, \
+          [("TensilePlan_%s *" % pt, "plan")], None), \
+      ("grouped", "TensileStatus", "tensileGrouped_%s" % pt, \
+          [("unsigned int", "numProblems"), \
+          ("const TensileGroupedProblem_%s *" % pt, "problems")] + argListGroup, \
+          "tensileStatusFailure"), \
+      ("getSolutionPointer", "SolutionMapper_%s::SolutionRuntime *" % pt, \
+          "tensileGetSolutionPointer_%s" % pt, argListSizes, "nullptr"), \
+      ("getSolutionPointers", "TensileStatus", "tensileGetSolutionPointers_%s" % pt, \
+          [("unsigned int", "numProblems"), \
+          ("const ProblemDims_%s *" % pt, "problems"), \
+          ("SolutionMapper_%s::SolutionRuntime **" % pt, "solutions")], \
+          "tensileStatusFailure"), \
+      ("getSolutionCandidates", "unsigned int", "tensileGetSolutionCandidates_%s" % pt, \
+          [("const ProblemDims_%s &" % pt, "problem"), \
+          ("unsigned int", "k"), \
+          ("SolutionMapper_%s::SolutionCandidate *" % pt, "candidates"), \
+          ("bool", "includeInvalid")], "0"), \
+      ("getSolutionName", "const char *", "tensileGetSolutionName_%s" % pt, \
+          argListSizes, "nullptr") ]
+
+################################################################################
+# Write Library Table
+# table of the functions of a problem type library, in TensileInternal.h
+################################################################################
+def writeLibraryTable(problemType, entryPoints):
+  s = ""
+  s += "\n// functions of the library of problem type %s, see LibraryLoader.h\n" % problemType
+  s += "struct TensileLibrary_%s {\n" % problemType
+  for (member, returnType, functionName, argList, failure) in entryPoints:
+    s += "  decltype(&%s) %s;\n" % (functionName, member)
+  s += "  int (*reloadLogic)();\n"
+  s += "};\n"
+  return s
+
+################################################################################
+# Write Library Entry Point
+# exported function of a problem type library, called once when it is loaded
+################################################################################
+def writeLibraryEntryPoint(problemType, entryPoints):
+  s = ""
+  s += "\n\n// entry point of the library, called once by TensileLibraryLoader\n"
+  s += "TENSILE_LIBRARY_EXPORT const void *tensileLibrary_%s() {\n" % problemType
+  s += "  tensileInitialize_%s();\n" % problemType
+  s += "  static const TensileLibrary_%s library = {\n" % problemType
+  for (member, returnType, functionName, argList, failure) in entryPoints:
+    s += "    %s,\n" % functionName
+  s += "    tensileReloadLogic_%s };\n" % problemType
+  s += "  return &library;\n"
+  s += "}\n"
+  return s
+
+################################################################################
+# Write Library Stubs
+# problem type functions of Tensile.cpp forwarding to the problem type library
+################################################################################
+def writeLibraryStubs(problemType, entryPoints):
+  s = ""
+  s += "\n/*******************************************************************************\n"
+  s += "* Stubs for %s\n" % problemType
+  s += "*******************************************************************************/\n"
+  s += "static TensileLibraryLoader libraryLoader_%s(\"%s\");\n" % (problemType, problemType)
+  for (member, returnType, functionName, argList, failure) in entryPoints:
+    s += "\n%s %s(\n" % (returnType, functionName)
+    for i in range(0, len(argList)):
+      s += "    %s %s%s" \
+          % (argList[i][0], argList[i][1], \
+          ",\n" if i < len(argList)-1 else ") {\n")
+    if len(argList) == 0:
+      s += ") {\n"
+    s += "  auto library = static_cast<const TensileLibrary_%s *>(libraryLoader_%s.library());\n" \
+        % (problemType, problemType)
+    callArgs = ", ".join([arg[1] for arg in argList])
+    if failure is None:
+      s += "  if (library)\n"
+      s += "    library->%s(%s);\n" % (member, callArgs)
+    else:
+      s += "  if (library == nullptr)\n"
+      s += "    return %s; // library not found\n" % failure
+      s += "  return library->%s(%s);\n" % (member, callArgs)
+    s += "}\n"
+  return s
+
+################################################################################
+# Write tensileInitialize and tensileReloadLogic of the stubs
+################################################################################
+def writeTensileInitializeStubs(logicData):
+  s = ""
+  s += "/*******************************************************************************\n"
+  s += "* Tensile initializer\n"
+  s += "*******************************************************************************/\n"
+  s += "void tensileInitialize() {\n"
+  s += "  // each problem type library initializes itself when it is loaded\n"
+  s += "}\n\n"
+
+  s += "int tensileReloadLogic() {\n"
+  s += "  int reloaded = 0;\n"
+  for problemType in logicData:
+    s += "  if (auto library = static_cast<const TensileLibrary_%s *>(libraryLoader_%s.loaded()))\n" \
+        % (problemType, problemType)
+    s += "    reloaded += library->reloadLogic();\n"
+  s += "  return reloaded;\n"
+  s += "}"
+  return s
+
 def writeSolutionAndExactTable(scheduleName, deviceNames, schedProbName, problemType, \
-                               solutionsForSchedule, solutionNames, exactLogic):
+                               solutionsForSchedule, solutionNames, kernelInfo, planInfo, \
+                               exactLogic, indexOrder, rangeLogic):
   s = ""
   s += "namespace { // Start schedule '%s'\n" % scheduleName
 
-  s += "// solution table - function, name, assertion requirements\n"
+  s += "// solution table - function, name, assertion requirements, macro tile, kernel to load,\n"
+  s += "// plan and execute functions\n"
   s += "static const SolutionInfo solutionTable_%s[] = {\n" % (schedProbName)
   for i in range(0, len(solutionsForSchedule)):
     solution = solutionsForSchedule[i]
     solutionName = solutionNames[i]
-    s += "  {(void*)%s, \"%s\", {%d, %d, %d, %d, %d} }%s // %d" % \
+    s += "  {(void*)%s, \"%s\", {%d, %d, %d, %d, %d}, %u, %u, %s, %s }%s // %d" % \
       (solutionName, solutionName, \
         solution["AssertSummationElementMultiple"], \
         solution["AssertFree0ElementMultiple"], \
         solution["AssertFree1ElementMultiple"], \
         solution["AssertMinApproxSize"], \
         solution["LdcEqualsLdd"], \
+        solution["MacroTile0"], \
+        solution["MacroTile1"], \
+        kernelInfo[i], \
+        planInfo[i], \
         "," if i < len(solutionsForSchedule)-1 else "", \
         i)
     s += "\n"
@@ -664,26 +1131,49 @@ def writeSolutionAndExactTable(scheduleName, deviceNames, schedProbName, problem
   s += "};\n\n"
 
   # Write the exact problems here
-  s += "// table of exact problem dims and selected solutionIdx\n"
-  s += "static const std::pair<const ProblemKey_%s, int> embeddedExactTable_%s[] = {\n" % (problemType,schedProbName)
+  # Sorted by sizes so the mapper can binary-search the table in place
   numSizes = problemType["TotalIndices"]
-  for ruleIdx in range(0, len(exactLogic)):
-    rule = exactLogic[ruleIdx]
-    problemSize = rule[0][:numSizes]
-    problemStrides = rule[0][numSizes:]
-    solutionIdx = rule[1][0]
-    solutionGFlops = rule[1][1]
-    s += " { {"
-    for i in range(0, len(problemSize)):
-      if i == 0:
-        s += "%u" % problemSize[i];
-      else:
-        s += ", %u" % problemSize[i];
-    s += "}, %u}" % (solutionIdx)
-    s += "," if ruleIdx != len(exactLogic)-1 else " "
-    s += " // %.0f GFlop/s" % (solutionGFlops)
-    s += "\n";
-  s += "};\n\n"
+  exactLogic = sorted(exactLogic, key=lambda rule: rule[0][:numSizes])
+  # Structure-of-arrays: one row per size index, then the solutionIdx and GFlop/s rows
+  if len(exactLogic):
+    s += "// exact problem dims, one row per size index, entries sorted by problem dims\n"
+    s += "static const unsigned int exactSizes_%s[] = {\n" % (schedProbName)
+    for sizeIdx in range(0, numSizes):
+      s += "  %s%s // size%s\n" % ( \
+          ", ".join("%u" % rule[0][sizeIdx] for rule in exactLogic), \
+          "," if sizeIdx != numSizes-1 else "", \
+          globalParameters["IndexChars"][sizeIdx])
+    s += "};\n"
+    s += "// selected solutionIdx and its GFlop/s for each exact problem\n"
+    s += "static const int exactSolutionIdx_%s[] = {\n  %s\n};\n" \
+        % (schedProbName, ", ".join("%u" % rule[1][0] for rule in exactLogic))
+    s += "static const float exactGFlops_%s[] = {\n  %s\n};\n" \
+        % (schedProbName, ", ".join("%.1ff" % rule[1][1] for rule in exactLogic))
+    s += "static const ExactTableData embeddedExactTable_%s = { exactSizes_%s, exactSolutionIdx_%s, exactGFlops_%s, %u };\n\n" \
+        % (schedProbName, schedProbName, schedProbName, schedProbName, len(exactLogic))
+  else:
+    s += "static const ExactTableData embeddedExactTable_%s = { nullptr, nullptr, nullptr, 0 };\n\n" \
+        % (schedProbName)
+
+  # Write the range logic as a flattened decision table
+  rangeRules = flattenRangeLogic(rangeLogic, len(indexOrder))
+  if rangeRules == None:
+    if rangeLogic:
+      print "** warning: ignored malformed range logic for %s" % schedProbName
+  else:
+    s += "// range logic - size index tested at each level, then the rules for each level\n"
+    s += "static const unsigned int rangeIndexOrder_%s[] = { %s };\n" \
+        % (schedProbName, ", ".join("%u" % i for i in indexOrder))
+    s += "static const RangeRule rangeRules_%s[] = {\n" % (schedProbName)
+    for ruleIdx in range(0, len(rangeRules)):
+      (level, threshold, nextIdx) = rangeRules[ruleIdx]
+      s += "  {%s, %d}%s // %u: size%s\n" % ( \
+          "0xFFFFFFFF" if threshold < 0 else "%u" % threshold, nextIdx, \
+          "," if ruleIdx != len(rangeRules)-1 else " ", \
+          ruleIdx, globalParameters["IndexChars"][indexOrder[level]])
+    s += "};\n"
+    s += "static const RangeLogic rangeLogic_%s = { rangeIndexOrder_%s, %u, rangeRules_%s, %u };\n\n" \
+        % (schedProbName, schedProbName, len(indexOrder), schedProbName, len(rangeRules))
 
   # Create a solution mapper and init with the table above:
   s += "// The solution master constructor here adds device to the master solution mapper\n"
@@ -691,13 +1181,109 @@ def writeSolutionAndExactTable(scheduleName, deviceNames, schedProbName, problem
   s += "static SolutionMapper_%s solutionMapper_%s(\n" % (problemType, schedProbName)
   s += "  \"%s\", // schedule+problem name\n" % (schedProbName) 
   s += "  solutionTable_%s, %u,\n" % (schedProbName, len(solutionsForSchedule))
-  s += "  embeddedExactTable_%s, %u,\n" % (schedProbName, len(exactLogic))
-  s += "  &problemType_%s);\n" % (problemType)
+  s += "  &embeddedExactTable_%s,\n" % (schedProbName)
+  s += "  &problemType_%s,\n" % (problemType)
+  if rangeRules == None:
+    s += "  nullptr, // no range logic\n"
+  else:
+    s += "  &rangeLogic_%s,\n" % (schedProbName)
+  s += "  0x%sull); // library hash - invalidates persisted lookup caches when the tables change\n" \
+      % getLibraryHash(solutionNames, exactLogic, rangeRules)
 
   s += "} // end anonymous namespace\n" 
   return s
 
 
+################################################################################
+# Write Logic File
+# binary copy of the solution requirements and exact table of one schedule, which
+# SolutionMapper::loadLogicFile can load at runtime in place of the embedded table.
+# Only written with --write-logic-files (WriteLogicFiles).
+# Layout must match LogicFileHeader / LogicFileSolution in SolutionMapper.h
+################################################################################
+def writeLogicFile(outputPath, schedProbName, numSizes, solutionsForSchedule, \
+                   solutionNames, exactLogic):
+  logicPath = ensurePath(os.path.join(outputPath, "LogicData"))
+  exactLogic = sorted(exactLogic, key=lambda rule: rule[0][:numSizes])
+
+  names = ""
+  solutionRecords = ""
+  for i in range(0, len(solutionsForSchedule)):
+    solution = solutionsForSchedule[i]
+    solutionRecords += struct.pack("<IIIIiI", len(names), \
+        solution["AssertSummationElementMultiple"], \
+        solution["AssertFree0ElementMultiple"], \
+        solution["AssertFree1ElementMultiple"], \
+        solution["AssertMinApproxSize"], \
+        1 if solution["LdcEqualsLdd"] else 0)
+    names += solutionNames[i] + "\0"
+
+  # Rows as in the generated ExactTableData: sizes by size index, solutionIdx, GFlop/s
+  numExacts = len(exactLogic)
+  entryRecords = ""
+  for sizeIdx in range(0, numSizes):
+    entryRecords += struct.pack("<%uI" % numExacts, *[rule[0][sizeIdx] for rule in exactLogic])
+  entryRecords += struct.pack("<%ui" % numExacts, *[rule[1][0] for rule in exactLogic])
+  entryRecords += struct.pack("<%uf" % numExacts, *[rule[1][1] for rule in exactLogic])
+
+  header = struct.pack("<8sIIIIII", "TNSLOGIC", 2, numSizes, \
+      len(solutionsForSchedule), len(exactLogic), len(names), 0)
+  logicFile = open(os.path.join(logicPath, "%s.tensile_logic" % schedProbName), "wb")
+  logicFile.write(header + solutionRecords + entryRecords + names)
+  logicFile.close()
+
+
+################################################################################
+# Hash of the solution, exact and range tables of one schedule, as 16 hex digits
+################################################################################
+def getLibraryHash(solutionNames, exactLogic, rangeRules):
+  h = hashlib.sha1()
+  for solutionName in solutionNames:
+    h.update(solutionName)
+  h.update(str(exactLogic))
+  h.update(str(rangeRules))
+  return h.hexdigest()[:16]
+
+
+################################################################################
+# Flatten Range Logic
+# rangeLogic is nested per index in indexOrder: a list of [threshold, next]
+# where next is the logic for the next index, or the solution index for the
+# last index. The first rule with size <= threshold applies, threshold -1 is
+# the catch-all for the last rule.
+# Returns a list of (level, threshold, next) where the rules of each group are
+# contiguous and next is the position of the next group (or the solution
+# index), or None if there is no usable range logic.
+################################################################################
+def flattenRangeLogic(rangeLogic, numLevels):
+  if not rangeLogic or numLevels == 0:
+    return None
+  rules = []
+
+  def flattenGroup(logic, level):
+    if not isinstance(logic, list) or len(logic) == 0:
+      return -1
+    first = len(rules)
+    for i in range(0, len(logic)):
+      threshold = -1 if i == len(logic)-1 else logic[i][0]
+      rules.append([level, threshold, -1])
+    for i in range(0, len(logic)):
+      if level == numLevels-1:
+        if isinstance(logic[i][1], list):
+          return -1
+        rules[first+i][2] = logic[i][1]
+      else:
+        nextIdx = flattenGroup(logic[i][1], level+1)
+        if nextIdx < 0:
+          return -1
+        rules[first+i][2] = nextIdx
+    return first
+
+  if flattenGroup(rangeLogic, 0) < 0:
+    return None
+  return [tuple(rule) for rule in rules]
+
+
 ################################################################################
 # Write Range Logic Recursive
 # ptr :
@@ -708,7 +1294,26 @@ def writeExactLogic(problemType, indexOrder,
                     solutionsForSchedule, exactLogic, \
                     solutionNames, ptr):
   s = ""
-  s += "  ProblemDims_%s pdims(" % problemType
+  s += "  " + writeProblemDims(problemType, indexOrder)
+
+  s += "  auto solutionMapper = reinterpret_cast<SolutionMapper_%s *> (masterSolutionMapper_%s.mapper());\n"  \
+      % (problemType, problemType)
+  if ptr:
+    s += "  return solutionMapper->getSolutionWithFallback(pdims,&masterSolutionMapper_%s);\n" % problemType
+  else:
+    s += "  return solutionMapper->getSolutionWithFallback(pdims,&masterSolutionMapper_%s)->_info->_name;\n" % problemType
+
+  return s
+
+
+################################################################################
+# Write ProblemDims
+# declaration of "pdims" built from the stride and size arguments,
+# or from the members of prefix (ie "problem.")
+################################################################################
+def writeProblemDims(problemType, indexOrder, prefix=""):
+  s = ""
+  s += "ProblemDims_%s pdims(" % problemType
   indexChars = globalParameters["IndexChars"]
   firstStride = 0 if problemType["UseInitialStrides"] else 1
   lastStrideD = problemType["NumIndicesC"]
@@ -717,26 +1322,18 @@ def writeExactLogic(problemType, indexOrder,
   lastStrideB = len(problemType["IndexAssignmentsB"])
   for i in range(firstStride,lastStrideD):
     if i != firstStride: s += ", "
-    s += "strideD%u%s" % (i, indexChars[i])
+    s += "%sstrideD%u%s" % (prefix, i, indexChars[i])
   for i in range(firstStride,lastStrideC):
-    s += ", strideC%u%s" % (i, indexChars[i])
+    s += ", %sstrideC%u%s" % (prefix, i, indexChars[i])
   for i in range(firstStride,lastStrideA):
-    s += ", strideA%u%s" % (i, \
+    s += ", %sstrideA%u%s" % (prefix, i, \
         indexChars[problemType["IndexAssignmentsA"][i]])
   for i in range(firstStride,lastStrideB):
-    s += ", strideB%u%s" % (i, \
+    s += ", %sstrideB%u%s" % (prefix, i, \
         indexChars[problemType["IndexAssignmentsB"][i]])
   for i in range(0,len(indexOrder)):
-    s += ", size%s" % indexChars[i]
+    s += ", %ssize%s" % (prefix, indexChars[i])
   s += ");\n"
-
-  s += "  auto solutionMapper = reinterpret_cast<SolutionMapper_%s *> (masterSolutionMapper_%s.mapper());\n"  \
-      % (problemType, problemType)
-  if ptr:
-    s += "  return solutionMapper->getSolutionWithFallback(pdims,&masterSolutionMapper_%s);\n" % problemType
-  else:
-    s += "  return solutionMapper->getSolutionWithFallback(pdims,&masterSolutionMapper_%s)->_info->_name;\n" % problemType
-
   return s
 
 
@@ -872,6 +1469,15 @@ def TensileCreateLibrary():
       action="store_true")
   argParser.add_argument("--no-short-file-names", dest="ShortNames", \
       action="store_false")
+  argParser.add_argument("--code-object-archive", dest="CodeObjectArchive", \
+      nargs="?", const="Kernels.coa", default="", \
+      help="Load assembly kernels from one code object archive instead of byte arrays")
+  argParser.add_argument("--split-problem-types", dest="SplitProblemTypes", \
+      action="store_true", \
+      help="Build each problem type into its own shared object, loaded on first use")
+  argParser.add_argument("--write-logic-files", dest="WriteLogicFiles", \
+      action="store_true", \
+      help="Also write LogicData/<schedule>_<problemType>.tensile_logic, loadable with TENSILE_LOGIC_PATH")
   argParser.add_argument("--library-print-debug", dest="LibraryPrintDebug", \
       action="store_true")
   argParser.add_argument("--no-library-print-debug", dest="LibraryPrintDebug", \
@@ -887,9 +1493,16 @@ def TensileCreateLibrary():
   arguments["MergeFiles"] = args.MergeFiles
   arguments["ShortNames"] = args.ShortNames
   arguments["LibraryPrintDebug"] = args.LibraryPrintDebug
-  arguments["CodeFromFiles"] = False
+  arguments["CodeObjectArchive"] = args.CodeObjectArchive
+  arguments["SplitProblemTypes"] = args.SplitProblemTypes
+  arguments["WriteLogicFiles"] = args.WriteLogicFiles
+  # kernels in an archive are loaded from it rather than embedded as byte arrays
+  arguments["CodeFromFiles"] = bool(args.CodeObjectArchive)
   assignGlobalParameters(arguments)
 
+  if globalParameters["SplitProblemTypes"] and not globalParameters["MergeFiles"]:
+    printExit("--split-problem-types requires --merge-files")
+
   if not os.path.exists(logicPath):
     printExit("LogicPath %s doesn't exist" % logicPath)
 
@@ -951,11 +1564,52 @@ def TensileCreateLibrary():
 
   # write solutions and kernels
   problemTypes = logicData.keys()
-  writeSolutionsAndKernels(outputPath, problemTypes, solutions, kernels, kernelsBetaOnly, \
-      solutionWriter, kernelWriterSource, kernelWriterAssembly)
+  if globalParameters["SplitProblemTypes"]:
+    # solutions and kernels of each problem type in ProblemTypes/<ProblemType>,
+    # built into their own shared object by TensileConfig.cmake
+    kernelsWithBuildErrs = {}
+    for problemType in problemTypes:
+      problemTypePath = ensurePath(os.path.join(outputPath, "ProblemTypes", str(problemType)))
+      problemTypeSolutions = []
+      for scheduleTuple in logicData[problemType]:
+        for solution in scheduleTuple[2]:
+          if solution not in problemTypeSolutions:
+            problemTypeSolutions.append(solution)
+      problemTypeKernels = []
+      problemTypeKernelsBetaOnly = []
+      for solution in problemTypeSolutions:
+        for kernel in solution.getKernels():
+          if kernel not in problemTypeKernels:
+            problemTypeKernels.append(kernel)
+        for kernel in solution.getKernelsBetaOnly():
+          if kernel not in problemTypeKernelsBetaOnly:
+            problemTypeKernelsBetaOnly.append(kernel)
+      kernelsWithBuildErrs.update(writeSolutionsAndKernels(problemTypePath, [problemType], \
+          problemTypeSolutions, problemTypeKernels, problemTypeKernelsBetaOnly, \
+          solutionWriter, kernelWriterSource, kernelWriterAssembly, False))
+    if globalParameters["CodeObjectArchive"] and globalParameters["CodeFromFiles"]:
+      writeCodeObjectArchive(kernels, kernelWriterAssembly, kernelsWithBuildErrs)
+  else:
+    writeSolutionsAndKernels(outputPath, problemTypes, solutions, kernels, kernelsBetaOnly, \
+        solutionWriter, kernelWriterSource, kernelWriterAssembly)
 
   libraryStaticFiles = [
       "SolutionMapper.h",
+      "SolutionMapperDistance.h",
+      "LookupCache.h",
+      "ShapeCanonicalizer.h",
+      "DeviceContext.cpp",
+      "DeviceContext.h",
+      "LookupStats.cpp",
+      "LookupStats.h",
+      "ModuleRegistry.cpp",
+      "ModuleRegistry.h",
+      "Preloader.cpp",
+      "Preloader.h",
+      "ProgramCache.cpp",
+      "ProgramCache.h",
+      "LoadTrace.cpp",
+      "LoadTrace.h",
       "TensileTypes.h",
       "tensile_bfloat16.h",
       "KernelHeader.h",
@@ -963,6 +1617,11 @@ def TensileCreateLibrary():
       "SolutionHelper.h",
       "Tools.cpp",
       "Tools.h" ]
+  # dlopen is only linked (${CMAKE_DL_LIBS}) into the split library
+  if globalParameters["SplitProblemTypes"]:
+    libraryStaticFiles += [
+        "LibraryLoader.cpp",
+        "LibraryLoader.h" ]
 
   # write cmake
   clientName = "LibraryClient"
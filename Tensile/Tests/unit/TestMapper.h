@@ -0,0 +1,138 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+/*******************************************************************************
+ * Solution mapper fixtures
+ * - TestExactTable: exact table in the row layout written by TensileCreateLibrary
+ * - TestMapper: solution mapper of a 4 size gemm-like problem type
+ * - writeLogicFile: binary logic file read by SolutionMapper::loadLogicFile
+ *******************************************************************************/
+
+#include "TestUtils.h"
+#include "TensileTypes.h"
+#include "SolutionHelper.h"
+#include "SolutionMapper.h"
+
+#include <string>
+#include <vector>
+
+typedef ProblemKey<4>                TestKey;
+typedef ProblemDims<1,3,3,3,3,4>     TestDims;
+typedef SolutionMapper<TestDims, TestKey> TestMapper;
+
+// Problem with free sizes a, b, batch c and summation k
+inline TestDims testDims(unsigned a, unsigned b, unsigned c, unsigned k) {
+  return TestDims(a, a*b, a+1, (a+1)*b, a, a*k, k, k*b, a, b, c, k);
+}
+
+inline const ProblemType *testProblemType() {
+  static const ProblemType *problemType = new ProblemType({0,1}, {3}, {2});
+  return problemType;
+}
+
+struct TestExactEntry {
+  unsigned int sizes[4];
+  int          solutionIdx;
+  float        gflops;
+};
+
+// Rows of an exact table, entries must be sorted by sizes
+class TestExactTable {
+public:
+  explicit TestExactTable(const std::vector<TestExactEntry> &entries) {
+    size_t n = entries.size();
+    _sizes.resize(4*n + 1);
+    _solutionIdx.resize(n + 1);
+    _gflops.resize(n + 1);
+    for (size_t i=0; i<n; i++) {
+      for (size_t si=0; si<4; si++)
+        _sizes[si*n + i] = entries[i].sizes[si];
+      _solutionIdx[i] = entries[i].solutionIdx;
+      _gflops[i] = entries[i].gflops;
+    }
+    _data.sizes = _sizes.data();
+    _data.solutionIdx = _solutionIdx.data();
+    _data.gflops = _gflops.data();
+    _data.numExacts = static_cast<unsigned int>(n);
+  }
+  const ExactTableData *data() const { return &_data; }
+
+private:
+  std::vector<unsigned int> _sizes;
+  std::vector<int>          _solutionIdx;
+  std::vector<float>        _gflops;
+  ExactTableData            _data;
+};
+
+inline TensileStatus testSolution() { return tensileStatusSuccess; }
+
+// Solution without assertion requirements
+inline SolutionInfo testSolutionInfo(const char *name) {
+  SolutionInfo info = {(void*)testSolution, name, {1,1,1,1,0}};
+  return info;
+}
+
+// Write a logic file mapping each entry to the solution named in solutionNames.
+// Entries must be sorted by sizes. Returns false if the file can not be written.
+inline bool writeLogicFile(const std::string &path,
+                           const std::vector<std::string> &solutionNames,
+                           const std::vector<TestExactEntry> &entries) {
+  TestMapper::LogicFileHeader header;
+  memcpy(header.magic, "TNSLOGIC", 8);
+  header.version = 2;
+  header.numSizes = 4;
+  header.numSolutions = static_cast<uint32_t>(solutionNames.size());
+  header.numExacts = static_cast<uint32_t>(entries.size());
+  header.reserved = 0;
+
+  std::string names;
+  std::vector<TestMapper::LogicFileSolution> solutions;
+  for (size_t i=0; i<solutionNames.size(); i++) {
+    TestMapper::LogicFileSolution solution = {static_cast<uint32_t>(names.size()), 1, 1, 1, 1, 0};
+    solutions.push_back(solution);
+    names += solutionNames[i];
+    names += '\0';
+  }
+  header.namesSize = static_cast<uint32_t>(names.size());
+
+  FILE *file = fopen(path.c_str(), "wb");
+  if (!file)
+    return false;
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(solutions.data(), sizeof(solutions[0]), solutions.size(), file);
+  for (size_t si=0; si<4; si++) {
+    for (size_t i=0; i<entries.size(); i++) {
+      uint32_t size = entries[i].sizes[si];
+      fwrite(&size, sizeof(size), 1, file);
+    }
+  }
+  for (size_t i=0; i<entries.size(); i++) {
+    int32_t solutionIdx = entries[i].solutionIdx;
+    fwrite(&solutionIdx, sizeof(solutionIdx), 1, file);
+  }
+  for (size_t i=0; i<entries.size(); i++) {
+    fwrite(&entries[i].gflops, sizeof(float), 1, file);
+  }
+  fwrite(names.data(), 1, names.size(), file);
+  return fclose(file) == 0;
+}
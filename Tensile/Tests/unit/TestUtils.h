@@ -0,0 +1,48 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+/*******************************************************************************
+ * Unit test helpers
+ * - CHECK: report a failed condition and fail the test at exit
+ * - testResult: exit status of the test
+ * Mapper fixtures are in TestMapper.h.
+ *******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+
+static int testFailures = 0;
+
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      printf ("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      testFailures++; \
+    } \
+  } while (0)
+
+// Exit status of a test
+inline int testResult(const char *testName) {
+  printf ("%s: %s\n", testName, testFailures ? "FAILED" : "passed");
+  return testFailures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// Lookup time of the SoA nearest-match scan (SolutionMapper::findNearestMatchSoA) and of
+// the scalar functor scan it replaces, per distance algorithm. Not a test: run it by hand
+//   bench_nearest_match [numExacts [numProblems]]
+
+#include "TestMapper.h"
+
+#include <chrono>
+#include <set>
+
+struct Algo : SolutionMapperRuntime {
+  static const int Euclidean = EuclideanDistanceAlgo;
+  static const int Manhattan = ManhattanDistanceAlgo;
+  static const int Ratio     = RatioDistanceAlgo;
+};
+
+static unsigned int randomSize(unsigned int *seed) {
+  *seed = *seed * 1103515245 + 12345;
+  return 16 + *seed / 65536 % 8192;
+}
+
+// Average microseconds per lookup of search over the problems
+template <class Search>
+static double timeLookups(const std::vector<TestDims> &problems, Search search, int *checksum) {
+  auto start = std::chrono::steady_clock::now();
+  for (auto iter=problems.begin(); iter!=problems.end(); iter++) {
+    *checksum += search(TestKey(*iter), ProblemProperties(*iter, testProblemType()));
+  }
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / problems.size();
+}
+
+template <class DistanceFunction>
+static void compare(const TestMapper &mapper, const std::vector<TestDims> &problems,
+                    const char *name, int algo, DistanceFunction distanceF) {
+  int scalarSum = 0, soaSum = 0;
+  double scalar = timeLookups(problems, [&](const TestKey &pkey, const ProblemProperties &pa) {
+    return mapper.findNearestMatch(pa, pkey, distanceF);
+  }, &scalarSum);
+  double soa = timeLookups(problems, [&](const TestKey &pkey, const ProblemProperties &pa) {
+    return mapper.findNearestMatchSoA(pa, pkey, algo);
+  }, &soaSum);
+  printf ("%-9s scalar %9.2f us  SoA %9.2f us  speedup %5.1fx%s\n", name, scalar, soa,
+          scalar / soa, scalarSum == soaSum ? "" : "  (different solutions)");
+}
+
+int main(int argc, char *argv[]) {
+  size_t numExacts   = argc > 1 ? strtoul(argv[1], nullptr, 0) : 20000;
+  size_t numProblems = argc > 2 ? strtoul(argv[2], nullptr, 0) : 200;
+
+  static std::vector<SolutionInfo> solutions;
+  for (int s=0; s<64; s++) {
+    solutions.push_back(testSolutionInfo("S"));
+  }
+  unsigned int seed = 1;
+  std::set<std::vector<unsigned int> > keys;
+  while (keys.size() < numExacts) {
+    std::vector<unsigned int> key = {randomSize(&seed), randomSize(&seed), 1 + seed % 4,
+                                     randomSize(&seed)};
+    keys.insert(key);
+  }
+  std::vector<TestExactEntry> entries;
+  for (auto iter=keys.begin(); iter!=keys.end(); iter++) {
+    TestExactEntry entry = {{(*iter)[0], (*iter)[1], (*iter)[2], (*iter)[3]},
+                            int(entries.size() % solutions.size()), 1.0f};
+    entries.push_back(entry);
+  }
+  static TestExactTable table(entries);
+  TestMapper mapper("bench", solutions.data(), solutions.size(), table.data(),
+                    testProblemType(), nullptr, 1);
+  mapper.materialize();
+
+  std::vector<TestDims> problems;
+  for (size_t p=0; p<numProblems; p++) {
+    problems.push_back(testDims(randomSize(&seed), randomSize(&seed), 1, randomSize(&seed)));
+  }
+
+  printf ("%zu exact entries, %zu problems, microseconds per lookup\n", numExacts, numProblems);
+  compare(mapper, problems, "Euclidean", Algo::Euclidean, EuclideanDistance<TestKey>());
+  compare(mapper, problems, "Manhattan", Algo::Manhattan, ManhattanDistance<TestKey>());
+  compare(mapper, problems, "Ratio",     Algo::Ratio,     RatioDistance<TestKey>());
+  return EXIT_SUCCESS;
+}
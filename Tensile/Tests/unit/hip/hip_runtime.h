@@ -0,0 +1,86 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+/*******************************************************************************
+ * Host-only stand-in for the HIP runtime API used by the Tensile runtime sources,
+ * so the unit tests build with the host compiler and run without ROCm.
+ * There are no devices: every call that would reach one fails with
+ * hipErrorNoDevice. The tests replace devices, modules and launch timing with
+ * the fakes of the runtime (FakeDeviceRuntime, FakeModuleLoader, ...).
+ *******************************************************************************/
+
+#include <cstddef>
+#include <stdint.h>
+
+typedef int hipError_t;
+enum {
+  hipSuccess            = 0,
+  hipErrorOutOfMemory   = 2,
+  hipErrorInvalidValue  = 11,
+  hipErrorNoDevice      = 100,
+  hipErrorFileNotFound  = 301,
+  hipErrorNotReady      = 600,
+  hipErrorUnknown       = 999,
+  hipErrorRuntimeOther  = 1052
+};
+enum { hipEventDefault = 0x0, hipEventDisableTiming = 0x2 };
+
+typedef int                    hipDevice_t;
+typedef struct ihipModule_t   *hipModule_t;
+typedef struct ihipFunction_t *hipFunction_t;
+typedef struct ihipStream_t   *hipStream_t;
+typedef struct ihipEvent_t    *hipEvent_t;
+
+struct float2  { float x, y; };
+struct double2 { double x, y; };
+
+struct hipDeviceProp_t {
+  char name[256];
+  int  multiProcessorCount;
+  int  gcnArch;
+};
+
+inline hipError_t hipGetDeviceCount(int *count) { *count = 0; return hipErrorNoDevice; }
+inline hipError_t hipGetDevice(int *deviceId) { *deviceId = 0; return hipErrorNoDevice; }
+inline hipError_t hipSetDevice(int) { return hipErrorNoDevice; }
+inline hipError_t hipGetDeviceProperties(hipDeviceProp_t *, int) { return hipErrorNoDevice; }
+inline hipError_t hipDeviceSynchronize() { return hipErrorNoDevice; }
+
+inline hipError_t hipModuleLoadData(hipModule_t *module, const void *) { *module = nullptr; return hipErrorNoDevice; }
+inline hipError_t hipModuleUnload(hipModule_t) { return hipErrorNoDevice; }
+inline hipError_t hipModuleGetFunction(hipFunction_t *function, hipModule_t, const char *) {
+  *function = nullptr;
+  return hipErrorNoDevice;
+}
+
+inline hipError_t hipStreamCreate(hipStream_t *stream) { *stream = nullptr; return hipErrorNoDevice; }
+inline hipError_t hipStreamDestroy(hipStream_t) { return hipErrorNoDevice; }
+inline hipError_t hipStreamSynchronize(hipStream_t) { return hipErrorNoDevice; }
+
+inline hipError_t hipEventCreate(hipEvent_t *event) { *event = nullptr; return hipErrorNoDevice; }
+inline hipError_t hipEventCreateWithFlags(hipEvent_t *event, unsigned) { *event = nullptr; return hipErrorNoDevice; }
+inline hipError_t hipEventDestroy(hipEvent_t) { return hipErrorNoDevice; }
+inline hipError_t hipEventRecord(hipEvent_t, hipStream_t) { return hipErrorNoDevice; }
+inline hipError_t hipEventQuery(hipEvent_t) { return hipErrorNoDevice; }
+inline hipError_t hipEventSynchronize(hipEvent_t) { return hipErrorNoDevice; }
+inline hipError_t hipEventElapsedTime(float *ms, hipEvent_t, hipEvent_t) { *ms = 0.0f; return hipErrorNoDevice; }
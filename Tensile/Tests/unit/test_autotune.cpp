@@ -0,0 +1,191 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// Runtime autotuning (TENSILE_AUTOTUNE) through SolutionMapper::launchWithAutotune, the
+// launch path of tensile_<ProblemType>, with an injected TensileLaunchTimer: a problem
+// without an exact match rotates through its closest candidates, each launch timed, then
+// the fastest candidate is cached and launched untimed. Problems of a canonical bucket are
+// tuned together.
+
+#include "TestMapper.h"
+#include "DeviceContext.h"
+
+#include <limits>
+#include <map>
+
+// Timer reporting a fixed duration for each solution
+class FakeLaunchTimer : public TensileLaunchTimer {
+public:
+  FakeLaunchTimer() : _timed(0), _launched(-1) {};
+
+  double time(TensileStream stream, const std::function<TensileStatus()> &launch,
+              TensileStatus *status) {
+    _timed++;
+    *status = launch();
+    if (*status != tensileStatusSuccess)
+      return std::numeric_limits<double>::infinity();
+    auto iter = _durations.find(_launched);
+    return iter == _durations.end() ? 10.0 : iter->second;
+  }
+
+  std::map<int, double> _durations; // ms by solutionIdx
+  int                   _timed;
+  int                   _launched;  // solutionIdx of the last launch
+};
+
+int main() {
+  std::vector<TensileDeviceProperties> devices(1);
+  devices[0]._name = "gpu";
+  FakeDeviceRuntime runtime(devices);
+  TensileDeviceContext &context = TensileDeviceContext::instance();
+  context.setRuntime(&runtime);
+  FakeLaunchTimer timer;
+  context.setLaunchTimer(&timer);
+
+  // Exact entries of size 100..800 mapped to S0..S7
+  static std::vector<SolutionInfo> solutions;
+  std::vector<TestExactEntry> entries;
+  static const char *names[8] = {"S0", "S1", "S2", "S3", "S4", "S5", "S6", "S7"};
+  for (unsigned i=0; i<8; i++) {
+    solutions.push_back(testSolutionInfo(names[i]));
+    TestExactEntry entry = {{100*(i+1), 100*(i+1), 1, 100*(i+1)}, int(i), 1.0f};
+    entries.push_back(entry);
+  }
+  static TestExactTable exactTable(entries);
+  setenv("TENSILE_AUTOTUNE", "4", 1);
+  static TestMapper mapper("gpu", solutions.data(), solutions.size(), exactTable.data(),
+                           testProblemType(), nullptr, 1);
+  static MasterSolutionMapper<TestDims> master;
+  master.initialize();
+  CHECK(master.addMapper("gpu", &mapper) == 1);
+  CHECK(master.addMapper("fallback", &mapper) >= 1);
+  unsetenv("TENSILE_AUTOTUNE");
+
+  TensileStatus launchStatus = tensileStatusSuccess;
+  auto launch = [&](TestDims pdims) {
+    return mapper.launchWithAutotune(pdims, &master, nullptr,
+      [&](SolutionMapperRuntime::SolutionRuntime *solution) -> TensileStatus {
+        timer._launched = int(solution - mapper.getSolution(0));
+        return launchStatus;
+      });
+  };
+
+  // The 4 closest candidates of a problem between the entries of size 300 and 400
+  TestDims problem = testDims(350, 350, 1, 350);
+  std::vector<SolutionMapperRuntime::SolutionCandidate> candidates(4);
+  CHECK(mapper.getCandidates(problem, 4, candidates.data(), false) == 4);
+  std::vector<int> candidateIdx;
+  for (auto &candidate : candidates) {
+    candidateIdx.push_back(int(candidate._solution - mapper.getSolution(0)));
+  }
+  // The third candidate is the fastest
+  for (size_t i=0; i<candidateIdx.size(); i++) {
+    timer._durations[candidateIdx[i]] = i == 2 ? 1.0 : 5.0 + i;
+  }
+
+  // Trials rotate through the candidates, AUTOTUNE_TRIALS rounds
+  for (int call=0; call<4*AUTOTUNE_TRIALS; call++) {
+    CHECK(launch(problem) == tensileStatusSuccess);
+    CHECK(timer._timed == call+1);
+    CHECK(timer._launched == candidateIdx[call % 4]);
+  }
+  // Then the fastest candidate is cached as a preferred entry and launched untimed
+  for (int call=0; call<4; call++) {
+    CHECK(launch(problem) == tensileStatusSuccess);
+    CHECK(timer._launched == candidateIdx[2]);
+  }
+  CHECK(timer._timed == 4*AUTOTUNE_TRIALS);
+  CHECK(mapper.lookupCacheStats().preferred == 1);
+  CHECK(mapper.lookupCacheStats().pinned == 0);
+  CHECK(mapper.cacheSolution(problem, -1) == nullptr);
+
+  // Exact matches are not autotuned
+  int timed = timer._timed;
+  CHECK(launch(testDims(300, 300, 1, 300)) == tensileStatusSuccess);
+  CHECK(timer._launched == 2 && timer._timed == timed);
+
+  // Failing launches return their status and time as +inf: the closest candidate is kept
+  TestDims failing = testDims(550, 550, 1, 550);
+  CHECK(mapper.getCandidates(failing, 4, candidates.data(), false) == 4);
+  int closest = int(candidates[0]._solution - mapper.getSolution(0));
+  launchStatus = hipErrorInvalidValue;
+  for (int call=0; call<4*AUTOTUNE_TRIALS; call++) {
+    CHECK(launch(failing) == hipErrorInvalidValue);
+  }
+  CHECK(timer._timed == timed + 4*AUTOTUNE_TRIALS);
+  launchStatus = tensileStatusSuccess;
+  CHECK(launch(failing) == tensileStatusSuccess);
+  CHECK(timer._launched == closest && timer._timed == timed + 4*AUTOTUNE_TRIALS);
+
+  // Loading a logic file drops the tuned entries: the problem is tuned again
+  const std::string logicPath = "test_autotune.tensile_logic";
+  CHECK(writeLogicFile(logicPath, {names, names+8}, entries));
+  CHECK(mapper.loadLogicFile(logicPath) == 8);
+  remove(logicPath.c_str());
+  CHECK(mapper.lookupCacheStats().preferred == 0);
+  timed = timer._timed;
+  CHECK(launch(problem) == tensileStatusSuccess);
+  CHECK(timer._timed == timed + 1 && timer._launched == candidateIdx[0]);
+
+  // Tuned entries are evicted once the cache is full of them
+  {
+    setenv("TENSILE_LOOKUP_CACHE_SIZE", "16", 1);
+    TestMapper small("small", solutions.data(), solutions.size(), exactTable.data(),
+                     testProblemType(), nullptr, 1);
+    small.materialize();
+    unsetenv("TENSILE_LOOKUP_CACHE_SIZE");
+    for (unsigned i=0; i<256; i++) {
+      CHECK(small.cacheSolution(testDims(101+i, 101, 1, 101), int(i % 8)) == small.getSolution(i % 8));
+    }
+    CHECK(small.lookupCacheStats().size <= 16);
+    CHECK(small.lookupCacheStats().evictions >= 256-16);
+  }
+
+  // Problems sharing a canonical bucket share the tuning and its result
+  {
+    setenv("TENSILE_AUTOTUNE", "4", 1);
+    setenv("TENSILE_CANONICALIZE", "free:pow2", 1);
+    TestMapper canonical("canonical", solutions.data(), solutions.size(), exactTable.data(),
+                         testProblemType(), nullptr, 1);
+    canonical.materialize();
+    unsetenv("TENSILE_AUTOTUNE");
+    unsetenv("TENSILE_CANONICALIZE");
+    // Both are in the bucket {512,512,1,350}
+    TestDims first = testDims(350, 350, 1, 350);
+    TestDims second = testDims(360, 360, 1, 350);
+    for (int call=0; call<4*AUTOTUNE_TRIALS; call++) {
+      TestDims pdims = call % 2 ? second : first;
+      TestMapper::AutotuneTrial trial;
+      auto solution = canonical.getSolutionForLaunch(pdims, &trial);
+      CHECK(trial.active() && trial._solutionIdx == candidateIdx[call % 4]);
+      canonical.reportTrial(pdims, trial, timer._durations[int(solution - canonical.getSolution(0))]);
+    }
+    TestDims third = testDims(400, 300, 1, 350);
+    for (auto pdims : {first, second, third}) {
+      TestMapper::AutotuneTrial trial;
+      CHECK(canonical.getSolutionForLaunch(pdims, &trial) == canonical.getSolution(candidateIdx[2]));
+      CHECK(!trial.active());
+    }
+    CHECK(canonical.lookupCacheStats().size == 0);
+  }
+
+  return testResult("test_autotune");
+}
@@ -0,0 +1,78 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// Batch lookups (SolutionMapper::findAlgorithmsStatic, getSolutions): the same solutions
+// as one lookup per problem, with duplicate shapes in a batch searched for once.
+
+#include "TestMapper.h"
+
+int main() {
+  // S1 needs a summation multiple of 8
+  static std::vector<SolutionInfo> solutions = {testSolutionInfo("S0"),
+                                                {(void*)testSolution, "S1", {8,1,1,1,0}},
+                                                testSolutionInfo("S2")};
+  static TestExactTable table({{{64, 64, 1, 64}, 1, 1.0f}, {{256, 256, 1, 256}, 0, 1.0f},
+                               {{1024, 1024, 1, 1024}, 2, 1.0f}});
+  TestMapper single("single", solutions.data(), solutions.size(), table.data(),
+                    testProblemType(), nullptr, 1);
+  single.materialize();
+  TestMapper batch("batch", solutions.data(), solutions.size(), table.data(),
+                   testProblemType(), nullptr, 1);
+  batch.materialize();
+
+  // 12 distinct shapes, each repeated, and an exact match
+  std::vector<TestDims> problems;
+  for (unsigned r=0; r<3; r++) {
+    for (unsigned i=0; i<12; i++) {
+      problems.push_back(testDims(48 + 80*i, 48 + 80*i, 1, 60 + i));
+    }
+  }
+  problems.push_back(testDims(64, 64, 1, 64));
+
+  std::vector<int> solutionIdxs(problems.size(), -2);
+  batch.findAlgorithmsStatic(problems.data(), problems.size(), solutionIdxs.data());
+  for (size_t i=0; i<problems.size(); i++) {
+    CHECK(solutionIdxs[i] == single.findAlgorithmStatic(problems[i]));
+  }
+
+  // Each shape was searched for once
+  TensileLookupStatsSnapshot stats;
+  batch.lookupStats().snapshot(&stats, nullptr, 0);
+  CHECK(stats._counters[TensileLookupCacheMisses] == 13);
+  CHECK(stats._counters[TensileLookupCacheHits] == 0);
+  CHECK(stats._counters[TensileLookupNearestMatches] == 12);
+  CHECK(stats._counters[TensileLookupExactHits] == 1);
+
+  // The second batch is served from the cache
+  std::vector<SolutionMapperRuntime::SolutionRuntime *> found(problems.size());
+  batch.getSolutions(problems.data(), problems.size(), found.data());
+  batch.lookupStats().snapshot(&stats, nullptr, 0);
+  CHECK(stats._counters[TensileLookupCacheHits] == 13);
+  CHECK(stats._counters[TensileLookupCacheMisses] == 13);
+  for (size_t i=0; i<problems.size(); i++) {
+    CHECK(found[i] == batch.getSolution(solutionIdxs[i]));
+  }
+
+  // Empty batch
+  batch.findAlgorithmsStatic(problems.data(), 0, solutionIdxs.data());
+
+  return testResult("test_batch_lookup");
+}
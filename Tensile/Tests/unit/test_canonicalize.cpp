@@ -0,0 +1,73 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// Problems that are not in the exact table share the lookup of their canonical key
+// (TENSILE_CANONICALIZE), as long as its solution is valid for them. A problem whose
+// sizes equal a canonical key is looked up with its own assertions.
+
+#include "TestMapper.h"
+
+int main() {
+  // Multiples must be powers of two
+  {
+    ShapeCanonicalizer canonicalizer;
+    CHECK(canonicalizer.parse("sum:mult64,batch:pow2"));
+    CHECK(canonicalizer.enabled());
+    CHECK(!canonicalizer.parse("sum:mult12"));
+    CHECK(!canonicalizer.parse("sum:mult0"));
+    CHECK(!canonicalizer.parse("sum:pow3"));
+    CHECK(!canonicalizer.parse("size:pow2"));
+  }
+
+  // S1 needs a free0 multiple of 8 ; with free:pow2 problems {5..8,64,1,64} share the
+  // canonical key {8,64,1,64}
+  static std::vector<SolutionInfo> solutions = {testSolutionInfo("S0"),
+                                                {(void*)testSolution, "S1", {1,8,1,1,0}}};
+  static TestExactTable table({{{16, 64, 1, 64}, 1, 1.0f}, {{128, 64, 1, 64}, 0, 1.0f}});
+
+  setenv("TENSILE_CANONICALIZE", "free:pow2", 1);
+  TestMapper mapper("canonicalize", solutions.data(), solutions.size(), table.data(),
+                    testProblemType(), nullptr, 1);
+  mapper.materialize();
+  unsetenv("TENSILE_CANONICALIZE");
+
+  // S1 is closer but not valid for free0=6: S0 is cached for the bucket and shared by 7
+  CHECK(mapper.findAlgorithmStatic(testDims(6, 64, 1, 64)) == 0);
+  TensileLookupStatsSnapshot before;
+  mapper.lookupStats().snapshot(&before, nullptr, 0);
+  CHECK(mapper.findAlgorithmStatic(testDims(7, 64, 1, 64)) == 0);
+  TensileLookupStatsSnapshot after;
+  mapper.lookupStats().snapshot(&after, nullptr, 0);
+  CHECK(after._counters[TensileLookupCanonicalHits] == before._counters[TensileLookupCanonicalHits] + 1);
+
+  // The canonical key itself meets the requirements of S1 and must not take the bucket entry
+  CHECK(mapper.findAlgorithmStatic(testDims(8, 64, 1, 64)) == 1);
+  CHECK(mapper.findAlgorithmStatic(testDims(8, 64, 1, 64)) == 1);
+
+  // The bucket entry is still served to the other problems of the bucket
+  CHECK(mapper.findAlgorithmStatic(testDims(5, 64, 1, 64)) == 0);
+
+  // Buckets holding an exact entry are not shared
+  CHECK(mapper.findAlgorithmStatic(testDims(16, 64, 1, 64)) == 1);
+  CHECK(mapper.findAlgorithmStatic(testDims(12, 64, 1, 64)) == 0);
+
+  return testResult("test_canonicalize");
+}
@@ -0,0 +1,173 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// Code object archive (TensileCreateLibrary --code-object-archive): modules are loaded
+// from the archive member of the device ISA, and from the separate files for kernels or
+// ISAs the archive does not have, or if the archive is missing or malformed.
+
+#include "TestUtils.h"
+#include "DeviceContext.h"
+#include "ModuleRegistry.h"
+
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Loader recording the path and first byte of the code of the last load
+class RecordingModuleLoader : public FakeModuleLoader {
+public:
+  TensileStatus load(int deviceId, const std::string &path, const unsigned char *code,
+                     hipModule_t *module) {
+    _path = path;
+    _tag = char(code[0]);
+    return FakeModuleLoader::load(deviceId, path, code, module);
+  }
+  std::string _path;
+  char        _tag;
+};
+
+struct ArchiveMember {
+  const char *name;
+  uint32_t    isa;
+  char        tag; // every byte of the code object
+};
+
+// Members must be sorted by name, then isa
+static void writeArchive(const std::string &path, const std::vector<ArchiveMember> &members) {
+  typedef TensileModuleRegistry::CodeObjectArchiveHeader Header;
+  typedef TensileModuleRegistry::CodeObjectArchiveEntry Entry;
+  std::string names;
+  std::vector<Entry> entries(members.size());
+  for (size_t i=0; i<members.size(); i++) {
+    entries[i].nameOffset = uint32_t(names.size());
+    entries[i].nameLength = uint32_t(strlen(members[i].name));
+    entries[i].isa = members[i].isa;
+    entries[i].reserved = 0;
+    names += std::string(members[i].name) + '\0';
+  }
+  Header header;
+  memcpy(header.magic, "TNSLCOBJ", 8);
+  header.version = 1;
+  header.numEntries = uint32_t(members.size());
+  header.namesOffset = sizeof(header) + members.size() * sizeof(Entry);
+  header.namesSize = names.size();
+
+  std::vector<char> data(4096);
+  for (size_t i=0; i<members.size(); i++) {
+    entries[i].offset = data.size();
+    entries[i].size = 1000;
+    data.resize(data.size() + 4096, 0);
+    memset(&data[entries[i].offset], members[i].tag, 1000);
+  }
+  memcpy(&data[0], &header, sizeof(header));
+  memcpy(&data[sizeof(header)], entries.data(), entries.size() * sizeof(Entry));
+  memcpy(&data[header.namesOffset], names.data(), names.size());
+
+  FILE *file = fopen(path.c_str(), "wb");
+  CHECK(file != nullptr);
+  if (file) {
+    fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+  }
+}
+
+static void writeCodeObject(const std::string &path, char tag) {
+  std::vector<char> code(1000, tag);
+  FILE *file = fopen(path.c_str(), "wb");
+  CHECK(file != nullptr);
+  if (file) {
+    fwrite(code.data(), 1, code.size(), file);
+    fclose(file);
+  }
+}
+
+int main() {
+  std::vector<TensileDeviceProperties> devices(2);
+  devices[0]._gcnArch = 900;
+  devices[1]._gcnArch = 906;
+  FakeDeviceRuntime runtime(devices);
+  TensileDeviceContext::instance().setRuntime(&runtime);
+
+  // K0 for both ISAs and K1 for 906 archived ; K1 and K2 also as files
+  const std::string dir = "test_code_object_archive_files";
+  mkdir(dir.c_str(), 0755);
+  writeArchive(dir + "/Kernels.coa", {{"K0", 900, 'a'}, {"K0", 906, 'b'}, {"K1", 906, 'c'}});
+  writeCodeObject(dir + "/K1.co", 'f');
+  writeCodeObject(dir + "/K2.co", 'g');
+  FILE *bad = fopen((dir + "/Bad.coa").c_str(), "wb");
+  CHECK(bad != nullptr);
+  if (bad) {
+    fwrite("TNSLCOBJ garbage", 1, 16, bad);
+    fclose(bad);
+  }
+
+  RecordingModuleLoader loader;
+  TensileModuleRegistry &registry = TensileModuleRegistry::instance();
+  registry.setLoader(&loader);
+  registry.setSearchPath(dir);
+  registry.setArchive("Kernels.coa");
+
+  struct Load { int deviceId; const char *fileName; std::string path; char tag; };
+  const std::string archive = dir + "/Kernels.coa";
+  std::vector<Load> loads = {{0, "K0.co", archive + "(K0)", 'a'},
+                             {1, "K0.co", archive + "(K0)", 'b'},
+                             {1, "K1.co", archive + "(K1)", 'c'},
+                             {0, "K1.co", dir + "/K1.co", 'f'},  // no 900 member
+                             {1, "K2.co", dir + "/K2.co", 'g'}}; // not archived
+  for (auto &load : loads) {
+    hipModule_t module;
+    CHECK(registry.acquire(load.deviceId, load.fileName, nullptr, &module) == tensileStatusSuccess);
+    CHECK(loader._path == load.path && loader._tag == load.tag);
+  }
+  TensileModuleRegistry::Stats stats = registry.stats();
+  CHECK(stats.loads == 5 && stats.archived == 3);
+  CHECK(stats.filesMapped == 3); // the archive, K1.co and K2.co
+
+  // Acquiring again shares the modules
+  hipModule_t module;
+  CHECK(registry.acquire(0, "K0.co", nullptr, &module) == tensileStatusSuccess);
+  CHECK(registry.stats().loads == 5 && registry.stats().shared == 1);
+  CHECK(registry.release(0, "K0.co", nullptr) == tensileStatusSuccess);
+  for (auto &load : loads) {
+    CHECK(registry.release(load.deviceId, load.fileName, nullptr) == tensileStatusSuccess);
+  }
+  CHECK(registry.stats().resident == 0);
+
+  // Kernels missing from the archive and the search path fail to load
+  CHECK(registry.acquire(0, "K3.co", nullptr, &module) == hipErrorFileNotFound);
+
+  // A malformed or missing archive falls back to the files
+  for (const char *name : {"Bad.coa", "None.coa", ""}) {
+    registry.setArchive(name);
+    CHECK(registry.acquire(1, "K1.co", nullptr, &module) == tensileStatusSuccess);
+    CHECK(loader._path == dir + "/K1.co" && loader._tag == 'f');
+    CHECK(registry.release(1, "K1.co", nullptr) == tensileStatusSuccess);
+    CHECK(registry.acquire(1, "K0.co", nullptr, &module) == hipErrorFileNotFound);
+  }
+  CHECK(registry.stats().archived == 3);
+
+  remove((dir + "/Kernels.coa").c_str());
+  remove((dir + "/Bad.coa").c_str());
+  remove((dir + "/K1.co").c_str());
+  remove((dir + "/K2.co").c_str());
+  rmdir(dir.c_str());
+  return testResult("test_code_object_archive");
+}
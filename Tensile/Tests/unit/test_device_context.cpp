@@ -0,0 +1,117 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// Current device of the device context on the fake runtime: queried on every call by
+// default, cached per thread when enabled until the application reports a change, and
+// used to pick the solution mapper of the device.
+
+#include "TestMapper.h"
+#include "DeviceContext.h"
+
+#include <thread>
+
+static TestMapper *mapperOf(MasterSolutionMapper<TestDims> &master) {
+  return static_cast<TestMapper *>(master.mapper());
+}
+
+int main() {
+  std::vector<TensileDeviceProperties> devices(2);
+  devices[0]._name = "gpuA";
+  devices[0]._multiProcessorCount = 60;
+  devices[1]._name = "gpuB";
+  devices[1]._multiProcessorCount = 64;
+  FakeDeviceRuntime runtime(devices);
+  TensileDeviceContext &context = TensileDeviceContext::instance();
+  context.setRuntime(&runtime);
+  CHECK(context.deviceCount() == 2);
+  CHECK(context.properties(1)._multiProcessorCount == 64);
+
+  // Default - every call reaches the runtime, so direct device changes are seen
+  CHECK(!context.cacheCurrentDevice());
+  uint64_t queries = runtime.currentDeviceQueries();
+  CHECK(context.currentDevice() == 0);
+  runtime.setDevice(1);
+  CHECK(context.currentDevice() == 1);
+  CHECK(runtime.currentDeviceQueries() == queries + 2);
+  runtime.setDevice(0);
+
+  // Cached - one query per thread until the device changes through the context
+  context.setCacheCurrentDevice(true);
+  queries = runtime.currentDeviceQueries();
+  for (int i=0; i<100; i++) {
+    CHECK(context.currentDevice() == 0);
+  }
+  CHECK(runtime.currentDeviceQueries() == queries + 1);
+
+  CHECK(tensileSetDevice(1) == tensileStatusSuccess);
+  CHECK(context.currentDevice() == 1);
+  CHECK(runtime.currentDeviceQueries() == queries + 1);
+  CHECK(tensileSetDevice(2) != tensileStatusSuccess); // no such device - cache dropped
+  CHECK(context.currentDevice() == 1);
+  CHECK(runtime.currentDeviceQueries() == queries + 2);
+
+  // Other threads query their own device
+  std::thread thread([&]() { CHECK(context.currentDevice() == 0); });
+  thread.join();
+  CHECK(runtime.currentDeviceQueries() == queries + 3);
+
+  // Changed directly: stale until reported with tensileDeviceChanged
+  runtime.setDevice(0);
+  CHECK(context.currentDevice() == 1);
+  tensileDeviceChanged();
+  CHECK(context.currentDevice() == 0);
+  CHECK(runtime.currentDeviceQueries() == queries + 4);
+
+  // Replacing the runtime drops the cached devices of every thread
+  FakeDeviceRuntime otherRuntime(devices);
+  otherRuntime.setDevice(1);
+  context.setRuntime(&otherRuntime);
+  CHECK(context.currentDevice() == 1);
+  CHECK(otherRuntime.currentDeviceQueries() == 1);
+  context.setRuntime(&runtime);
+
+  // Disabling the cache drops it too
+  runtime.setDevice(1);
+  context.setCacheCurrentDevice(false);
+  CHECK(context.currentDevice() == 1);
+  runtime.setDevice(0);
+
+  // Solution mappers are selected by the name of the current device
+  static std::vector<SolutionInfo> solutionsA = {testSolutionInfo("A0")};
+  static std::vector<SolutionInfo> solutionsB = {testSolutionInfo("B0")};
+  static TestExactTable exactTable({{{64, 64, 1, 64}, 0, 1.0f}});
+  static TestMapper mapperA("a", solutionsA.data(), 1, exactTable.data(), testProblemType(), nullptr, 1);
+  static TestMapper mapperB("b", solutionsB.data(), 1, exactTable.data(), testProblemType(), nullptr, 1);
+  static TestMapper mapperC("c", solutionsB.data(), 1, exactTable.data(), testProblemType(), nullptr, 1);
+  static MasterSolutionMapper<TestDims> master;
+  master.initialize();
+  mapperA.initializeMappers({"gpuA"}, &master);
+  mapperB.initializeMappers({"gpuB"}, &master);
+  mapperC.initializeMappers({"gpuC"}, &master);
+  CHECK(mapperA.isMaterialized() && mapperB.isMaterialized() && !mapperC.isMaterialized());
+
+  TestDims pdims = testDims(64, 64, 1, 64);
+  CHECK(!strcmp(mapperOf(master)->getSolutionWithFallback(pdims, &master)->_info->_name, "A0"));
+  runtime.setDevice(1);
+  CHECK(!strcmp(mapperOf(master)->getSolutionWithFallback(pdims, &master)->_info->_name, "B0"));
+
+  return testResult("test_device_context");
+}
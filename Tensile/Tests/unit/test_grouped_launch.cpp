@@ -0,0 +1,176 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// Grouped calls (SolutionMapper::launchGrouped, behind tensileGrouped_<ProblemType>) on the
+// fake runtime: problems sharing a solution are enqueued back-to-back in their original
+// order, groups in order of their first problem, every launch is planned before the first
+// one is enqueued, and the first failing status is returned.
+
+#include "TestMapper.h"
+#include "DeviceContext.h"
+
+#include <map>
+
+struct Call {
+  char         kind; // 'p'lan or 'e'nqueue
+  unsigned int problem;
+  int          solutionIdx;
+  bool         first;
+  bool         last;
+};
+
+class GroupedCalls {
+public:
+  GroupedCalls(TestMapper *mapper, MasterSolutionMapper<TestDims> *master)
+    : _mapper(mapper), _master(master) {};
+
+  // Launch the problems, failing the plan or enqueue of problem failProblem with failStatus
+  TensileStatus launch(const std::vector<TestDims> &problems, char failKind = 0,
+                       unsigned int failProblem = 0, TensileStatus failStatus = tensileStatusSuccess) {
+    _calls.clear();
+    return _mapper->launchGrouped(problems.data(), problems.size(), _master,
+      [&](unsigned int p, SolutionMapperRuntime::SolutionRuntime *solution,
+          SolutionLaunch *launch) -> TensileStatus {
+        Call call = {'p', p, solutionIdx(solution), false, false};
+        _calls.push_back(call);
+        launch->_args[0] = p;
+        return failKind == 'p' && p == failProblem ? failStatus : tensileStatusSuccess;
+      },
+      [&](unsigned int p, SolutionMapperRuntime::SolutionRuntime *solution,
+          SolutionLaunch *launch, bool first, bool last) -> TensileStatus {
+        Call call = {'e', p, solutionIdx(solution), first, last};
+        CHECK(launch->_args[0] == p); // the launch planned for p
+        _calls.push_back(call);
+        return failKind == 'e' && p == failProblem ? failStatus : tensileStatusSuccess;
+      });
+  }
+
+  int solutionIdx(SolutionMapperRuntime::SolutionRuntime *solution) const {
+    return int(solution - _mapper->getSolution(0));
+  }
+
+  // Calls of one kind
+  std::vector<Call> calls(char kind) const {
+    std::vector<Call> result;
+    for (const Call &call : _calls) {
+      if (call.kind == kind)
+        result.push_back(call);
+    }
+    return result;
+  }
+
+  const std::vector<Call> &all() const { return _calls; }
+
+private:
+  TestMapper                     *_mapper;
+  MasterSolutionMapper<TestDims> *_master;
+  std::vector<Call>               _calls;
+};
+
+int main() {
+  std::vector<TensileDeviceProperties> devices(1);
+  devices[0]._name = "gpu";
+  FakeDeviceRuntime runtime(devices);
+  TensileDeviceContext::instance().setRuntime(&runtime);
+
+  // S0..S2 are exact matches of problems of size 100, 200 and 300
+  static std::vector<SolutionInfo> solutions = {testSolutionInfo("S0"), testSolutionInfo("S1"),
+                                                testSolutionInfo("S2")};
+  static TestExactTable exactTable({{{100, 100, 1, 100}, 0, 1.0f},
+                                    {{200, 200, 1, 200}, 1, 1.0f},
+                                    {{300, 300, 1, 300}, 2, 1.0f}});
+  static TestMapper mapper("gpu", solutions.data(), solutions.size(), exactTable.data(),
+                           testProblemType(), nullptr, 1);
+  static MasterSolutionMapper<TestDims> master;
+  master.initialize();
+  CHECK(master.addMapper("gpu", &mapper) == 1);
+  CHECK(master.addMapper("fallback", &mapper) >= 1);
+
+  auto sized = [](unsigned size) { return testDims(size, size, 1, size); };
+  GroupedCalls grouped(&mapper, &master);
+
+  // Problems 0..6 use solutions 1 0 1 2 0 1 2
+  std::vector<TestDims> problems = {sized(200), sized(100), sized(200), sized(300),
+                                    sized(100), sized(200), sized(300)};
+  CHECK(grouped.launch(problems) == tensileStatusSuccess);
+  std::vector<Call> plans = grouped.calls('p');
+  std::vector<Call> enqueues = grouped.calls('e');
+  CHECK(plans.size() == problems.size() && enqueues.size() == problems.size());
+  // Every launch planned, in problem order, before the first enqueue
+  for (size_t i=0; i<plans.size(); i++) {
+    CHECK(grouped.all()[i].kind == 'p' && grouped.all()[i].problem == i);
+  }
+  // Grouped by solution: groups in order of their first problem, problems in order
+  const unsigned int expectedOrder[] = {0, 2, 5, 1, 4, 3, 6};
+  const int expectedSolution[] = {1, 1, 1, 0, 0, 2, 2};
+  for (size_t i=0; i<enqueues.size(); i++) {
+    CHECK(enqueues[i].problem == expectedOrder[i]);
+    CHECK(enqueues[i].solutionIdx == expectedSolution[i]);
+    CHECK(enqueues[i].first == (i == 0));
+    CHECK(enqueues[i].last == (i == enqueues.size()-1));
+  }
+
+  // Coalescing matches groupBySolution
+  std::vector<SolutionMapperRuntime::SolutionRuntime *> problemSolutions;
+  for (int solutionIdx : {1, 0, 1, 2, 0, 1, 2}) {
+    problemSolutions.push_back(mapper.getSolution(solutionIdx));
+  }
+  std::vector<unsigned int> order(problemSolutions.size());
+  groupBySolution(problemSolutions.size(), problemSolutions.data(), order.data());
+  for (size_t i=0; i<order.size(); i++) {
+    CHECK(order[i] == expectedOrder[i]);
+  }
+
+  // A failing plan: nothing is enqueued and its status is returned
+  CHECK(grouped.launch(problems, 'p', 3, hipErrorInvalidValue) == hipErrorInvalidValue);
+  CHECK(grouped.calls('e').empty());
+
+  // A failing launch: its status is returned and the later launches are not enqueued
+  CHECK(grouped.launch(problems, 'e', 4, hipErrorOutOfMemory) == hipErrorOutOfMemory);
+  enqueues = grouped.calls('e');
+  CHECK(enqueues.size() == 5 && enqueues.back().problem == 4);
+
+  // A problem without a solution: nothing is planned or enqueued. The only solution of
+  // this mapper needs a summation size multiple of 8.
+  {
+    static std::vector<SolutionInfo> strictSolutions = {{(void*)testSolution, "S8", {8,1,1,1,0}}};
+    static TestExactTable strictTable({{{64, 64, 1, 64}, 0, 1.0f}});
+    static TestMapper strictMapper("gpu", strictSolutions.data(), strictSolutions.size(),
+                                   strictTable.data(), testProblemType(), nullptr, 1);
+    static MasterSolutionMapper<TestDims> strictMaster;
+    strictMaster.initialize();
+    CHECK(strictMaster.addMapper("gpu", &strictMapper) == 1);
+    CHECK(strictMaster.addMapper("fallback", &strictMapper) >= 1);
+    GroupedCalls strict(&strictMapper, &strictMaster);
+    std::vector<TestDims> strictProblems = {sized(64), testDims(64, 64, 1, 63), sized(128)};
+    CHECK(strict.launch(strictProblems) == tensileStatusFailure);
+    CHECK(strict.all().empty());
+    strictProblems.erase(strictProblems.begin() + 1);
+    CHECK(strict.launch(strictProblems) == tensileStatusSuccess);
+    CHECK(strict.calls('e').size() == 2);
+  }
+
+  // Empty group
+  CHECK(grouped.launch(std::vector<TestDims>()) == tensileStatusSuccess);
+  CHECK(grouped.all().empty());
+
+  return testResult("test_grouped_launch");
+}
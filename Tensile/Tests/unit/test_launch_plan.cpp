@@ -0,0 +1,193 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// Launch plans (SolutionMapper::createPlan / executePlan, behind tensileCreatePlan_<ProblemType>
+// and tensileExecutePlan_<ProblemType>) on the fake runtime: the solution is looked up once,
+// with the fallback mapper, its launch is precomputed only if it has a plan function, and
+// execution goes through the precomputed launch or the solution function with the plan dims.
+
+#include "TestMapper.h"
+#include "DeviceContext.h"
+
+typedef TensilePlan<12> TestPlan; // 8 strides then 4 sizes, as TestDims
+
+static TensileStatus testPlanFunction() { return tensileStatusSuccess; }
+
+// Solution with a plan and execute function, see SolutionLaunch
+static SolutionInfo plannedSolutionInfo(const char *name) {
+  SolutionInfo info = {(void*)testSolution, name, {1,1,1,1,0}, 0, 0, nullptr, nullptr,
+                       (void*)testPlanFunction, (void*)testPlanFunction};
+  return info;
+}
+
+// Dims of pdims in the argument order of tensileCreatePlan: strides of D, C, A, B then sizes
+static std::vector<unsigned int> planDims(const TestDims &pdims) {
+  std::vector<unsigned int> dims;
+  for (int i=0; i<2; i++) dims.push_back(pdims.strideD(i));
+  for (int i=0; i<2; i++) dims.push_back(pdims.strideC(i));
+  for (int i=0; i<2; i++) dims.push_back(pdims.strideA(i));
+  for (int i=0; i<2; i++) dims.push_back(pdims.strideB(i));
+  for (int i=0; i<4; i++) dims.push_back(pdims.sizes(i));
+  return dims;
+}
+
+class PlanCalls {
+public:
+  PlanCalls(TestMapper *mapper, MasterSolutionMapper<TestDims> *master)
+    : _mapper(mapper), _master(master) {};
+
+  // Create a plan of pdims, failing its plan function with planStatus
+  TensileStatus create(TestDims pdims, TestPlan **plan,
+                       TensileStatus planStatus = tensileStatusSuccess) {
+    _planned.clear();
+    std::vector<unsigned int> dims = planDims(pdims);
+    return _mapper->createPlan(pdims, dims.data(), _master,
+      [&](SolutionMapperRuntime::SolutionRuntime *solution, SolutionLaunch *launch) -> TensileStatus {
+        _planned.push_back(solutionIdx(solution));
+        launch->_args[0] = 1000 + solutionIdx(solution);
+        return planStatus;
+      }, plan);
+  }
+
+  // Execute a plan, recording 'e'xecute or 'l'aunch and the solution
+  TensileStatus execute(const TestPlan *plan) {
+    _executed.clear();
+    _launchedDims.clear();
+    return TestMapper::executePlan(plan,
+      [&](SolutionMapperRuntime::SolutionRuntime *solution, const SolutionLaunch *launch) -> TensileStatus {
+        CHECK(launch->_args[0] == uint64_t(1000 + solutionIdx(solution))); // the planned launch
+        _executed.push_back('e');
+        return tensileStatusSuccess;
+      },
+      [&](SolutionMapperRuntime::SolutionRuntime *solution, const unsigned int *dims) -> TensileStatus {
+        CHECK(solution == plan->_solution);
+        _executed.push_back('l');
+        _launchedDims.assign(dims, dims+12);
+        return tensileStatusSuccess;
+      });
+  }
+
+  int solutionIdx(SolutionMapperRuntime::SolutionRuntime *solution) const {
+    return int(solution - _mapper->getSolution(0));
+  }
+
+  const std::vector<int>          &planned() const { return _planned; }
+  const std::string               &executed() const { return _executed; }
+  const std::vector<unsigned int> &launchedDims() const { return _launchedDims; }
+
+private:
+  TestMapper                     *_mapper;
+  MasterSolutionMapper<TestDims> *_master;
+  std::vector<int>                _planned;
+  std::string                     _executed;
+  std::vector<unsigned int>       _launchedDims;
+};
+
+int main() {
+  std::vector<TensileDeviceProperties> devices(1);
+  devices[0]._name = "gpu";
+  FakeDeviceRuntime runtime(devices);
+  TensileDeviceContext::instance().setRuntime(&runtime);
+
+  // P0 has a plan function and is the exact match of size 100, S1 of size 200 has none
+  static std::vector<SolutionInfo> solutions = {plannedSolutionInfo("P0"), testSolutionInfo("S1")};
+  static TestExactTable exactTable({{{100, 100, 1, 100}, 0, 1.0f},
+                                    {{200, 200, 1, 200}, 1, 1.0f}});
+  static TestMapper mapper("gpu", solutions.data(), solutions.size(), exactTable.data(),
+                           testProblemType(), nullptr, 1);
+  static MasterSolutionMapper<TestDims> master;
+  master.initialize();
+  CHECK(master.addMapper("gpu", &mapper) == 1);
+  CHECK(master.addMapper("fallback", &mapper) >= 1);
+
+  auto sized = [](unsigned size) { return testDims(size, size, 1, size); };
+  PlanCalls calls(&mapper, &master);
+
+  // Precomputed launch: planned once, every execution goes through it
+  {
+    TestPlan *plan = nullptr;
+    TestDims pdims = sized(100);
+    CHECK(calls.create(pdims, &plan) == tensileStatusSuccess);
+    CHECK(plan != nullptr);
+    CHECK(calls.planned() == std::vector<int>({0}));
+    CHECK(plan->_solution == mapper.getSolution(0));
+    CHECK(plan->_precomputed);
+    CHECK(std::vector<unsigned int>(plan->_dims, plan->_dims+12) == planDims(pdims));
+    for (int e=0; e<3; e++) {
+      CHECK(calls.execute(plan) == tensileStatusSuccess);
+      CHECK(calls.executed() == "e");
+    }
+    delete plan;
+  }
+
+  // No plan function: nothing is planned and execution calls the solution with the plan dims
+  {
+    TestPlan *plan = nullptr;
+    TestDims pdims = sized(200);
+    CHECK(calls.create(pdims, &plan) == tensileStatusSuccess);
+    CHECK(plan != nullptr);
+    CHECK(calls.planned().empty());
+    CHECK(plan->_solution == mapper.getSolution(1));
+    CHECK(!plan->_precomputed);
+    CHECK(calls.execute(plan) == tensileStatusSuccess);
+    CHECK(calls.executed() == "l");
+    CHECK(calls.launchedDims() == planDims(pdims));
+    delete plan;
+  }
+
+  // A failing plan function: its status is returned and no plan is created
+  {
+    TestPlan *plan = reinterpret_cast<TestPlan *>(&calls);
+    CHECK(calls.create(sized(100), &plan, hipErrorInvalidValue) == hipErrorInvalidValue);
+    CHECK(plan == nullptr);
+    CHECK(calls.planned() == std::vector<int>({0}));
+  }
+
+  // The device mapper has no solution for a summation size not a multiple of 8: the plan
+  // uses the solution of the fallback mapper, and fails if that has none either
+  {
+    static std::vector<SolutionInfo> strictSolutions = {{(void*)testSolution, "S8", {8,1,1,1,0}}};
+    static TestExactTable strictTable({{{64, 64, 1, 64}, 0, 1.0f}});
+    static TestMapper strictMapper("gpu", strictSolutions.data(), strictSolutions.size(),
+                                   strictTable.data(), testProblemType(), nullptr, 1);
+    static MasterSolutionMapper<TestDims> fallbackMaster;
+    fallbackMaster.initialize();
+    CHECK(fallbackMaster.addMapper("gpu", &strictMapper) == 1);
+    CHECK(fallbackMaster.addMapper("fallback", &mapper) >= 1);
+    PlanCalls fallback(&mapper, &fallbackMaster); // createPlan looks up through the master
+    TestPlan *plan = nullptr;
+    CHECK(fallback.create(testDims(100, 100, 1, 99), &plan) == tensileStatusSuccess);
+    CHECK(plan != nullptr && plan->_solution == mapper.getSolution(0));
+    delete plan;
+
+    static MasterSolutionMapper<TestDims> strictMaster;
+    strictMaster.initialize();
+    CHECK(strictMaster.addMapper("gpu", &strictMapper) == 1);
+    CHECK(strictMaster.addMapper("fallback", &strictMapper) >= 1);
+    PlanCalls strict(&strictMapper, &strictMaster);
+    plan = reinterpret_cast<TestPlan *>(&strict);
+    CHECK(strict.create(testDims(64, 64, 1, 63), &plan) == tensileStatusFailure);
+    CHECK(plan == nullptr);
+    CHECK(strict.planned().empty());
+  }
+
+  return testResult("test_launch_plan");
+}
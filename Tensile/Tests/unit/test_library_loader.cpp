@@ -0,0 +1,82 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// Problem type libraries of a split library (TensileLibraryLoader): a library found through
+// TENSILE_LIBRARY_PATH is loaded and its entry point called once, also when threads race
+// for it, and a library that is missing or has no entry point fails without being retried.
+// TEST_LIBRARY_DIR holds the libraries built from test_library_loader_lib.cpp.
+
+#include "TestUtils.h"
+#include "LibraryLoader.h"
+
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+static TensileLibraryLoader testLoader("TestProblem");
+static TensileLibraryLoader earlyLoader("TestProblem");
+static TensileLibraryLoader missingLoader("MissingProblem");
+static TensileLibraryLoader noEntryLoader("NoEntryProblem");
+
+int main() {
+  // Not in the directory of the executable nor the default search
+  unsetenv("TENSILE_LIBRARY_PATH");
+  CHECK(earlyLoader.library() == nullptr);
+  CHECK(TensileLibraryLoader::numLoaded() == 0);
+
+  // Empty and missing directories are skipped
+  std::string libraryPath = std::string("/nonexistent::") + TEST_LIBRARY_DIR;
+  setenv("TENSILE_LIBRARY_PATH", libraryPath.c_str(), 1);
+
+  // Loaded and initialized once by the first of several threads
+  CHECK(testLoader.loaded() == nullptr);
+  std::vector<const void *> tables(8);
+  std::vector<std::thread> threads;
+  for (size_t t=0; t<tables.size(); t++) {
+    threads.push_back(std::thread([&tables, t]() { tables[t] = testLoader.library(); }));
+  }
+  for (size_t t=0; t<threads.size(); t++) {
+    threads[t].join();
+  }
+  const void *table = testLoader.loaded();
+  CHECK(table != nullptr);
+  for (size_t t=0; t<tables.size(); t++) {
+    CHECK(tables[t] == table);
+  }
+  CHECK(testLoader.library() == table);
+  CHECK(*static_cast<const unsigned int *>(table) == 1); // calls of the entry point
+  CHECK(TensileLibraryLoader::numLoaded() == 1);
+
+  // A failed load is not retried, even though the library can be found now
+  CHECK(earlyLoader.library() == nullptr);
+  CHECK(earlyLoader.loaded() == nullptr);
+
+  // Missing library, library without entry point
+  CHECK(missingLoader.library() == nullptr);
+  CHECK(noEntryLoader.library() == nullptr);
+  CHECK(noEntryLoader.library() == nullptr);
+  CHECK(noEntryLoader.loaded() == nullptr);
+  CHECK(TensileLibraryLoader::numLoaded() == 1);
+
+  unsetenv("TENSILE_LIBRARY_PATH");
+  return testResult("test_library_loader");
+}
@@ -0,0 +1,110 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// Logic files reloaded while other threads look up problems: once the reloads stop
+// every lookup, including those served from the lookup cache, must use the last table.
+
+#include "TestMapper.h"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+// Alternate loads of pathS0 and pathS1 while threads run lookup(i), then check that
+// lookup(0..numProblems-1) returns solution 1 for all problems
+static void reloadWhileLookingUp(TestMapper &mapper, const std::string &pathS0,
+                                 const std::string &pathS1, unsigned numProblems,
+                                 std::function<int(unsigned)> lookup) {
+  std::atomic<bool> done(false);
+  std::vector<std::thread> threads;
+  for (unsigned t=0; t<4; t++) {
+    threads.push_back(std::thread([&, t]() {
+      for (unsigned i=t; !done; i++) {
+        int solutionIdx = lookup(i % numProblems);
+        CHECK(solutionIdx == 0 || solutionIdx == 1);
+      }
+    }));
+  }
+  for (int reload=0; reload<2000; reload++) {
+    CHECK(mapper.loadLogicFile(reload % 2 ? pathS1 : pathS0) == 8);
+  }
+  done = true;
+  for (auto &thread : threads)
+    thread.join();
+
+  // Last load was the S1 table
+  for (unsigned i=0; i<numProblems; i++) {
+    CHECK(lookup(i) == 1);
+  }
+}
+
+int main() {
+  static std::vector<SolutionInfo> solutions = {testSolutionInfo("S0"), testSolutionInfo("S1")};
+
+  // Tables mapping every problem to one solution: nearest matches return that solution
+  std::vector<TestExactEntry> entries;
+  for (unsigned i=1; i<=8; i++) {
+    TestExactEntry entry = {{64*i, 64*i, 1, 64*i}, 0, 1.0f};
+    entries.push_back(entry);
+  }
+  static TestExactTable embedded(entries);
+  const std::string pathS0 = "test_logic_reload_S0.tensile_logic";
+  const std::string pathS1 = "test_logic_reload_S1.tensile_logic";
+  CHECK(writeLogicFile(pathS0, {"S0", "S1"}, entries));
+  for (auto &entry : entries)
+    entry.solutionIdx = 1;
+  CHECK(writeLogicFile(pathS1, {"S0", "S1"}, entries));
+
+  // Nearest matches - few distinct problems so most lookups are cache hits and stale
+  // entries would stick
+  {
+    TestMapper mapper("reload", solutions.data(), solutions.size(), embedded.data(),
+                      testProblemType(), nullptr, 1);
+    mapper.materialize();
+    auto problem = [](unsigned i) { return testDims(32 + 16*(i%8), 48 + 16*(i/8%8), 1, 40); };
+    CHECK(mapper.findAlgorithmStatic(problem(0)) == 0);
+    reloadWhileLookingUp(mapper, pathS0, pathS1, 64, [&](unsigned i) {
+      return mapper.findAlgorithmStatic(problem(i));
+    });
+  }
+
+  // Exact matches found by the launch path when autotuning is enabled
+  {
+    setenv("TENSILE_AUTOTUNE", "2", 1);
+    TestMapper mapper("reloadAutotune", solutions.data(), solutions.size(), embedded.data(),
+                      testProblemType(), nullptr, 1);
+    mapper.materialize();
+    unsetenv("TENSILE_AUTOTUNE");
+    auto launch = [&](unsigned i) {
+      TestDims pdims = testDims(64*(i+1), 64*(i+1), 1, 64*(i+1));
+      TestMapper::AutotuneTrial trial;
+      auto solution = mapper.getSolutionForLaunch(pdims, &trial);
+      CHECK(!trial.active());
+      return int(solution - mapper.getSolution(0));
+    };
+    CHECK(launch(0) == 0);
+    reloadWhileLookingUp(mapper, pathS0, pathS1, 8, launch);
+  }
+
+  remove(pathS0.c_str());
+  remove(pathS1.c_str());
+  return testResult("test_logic_reload");
+}
@@ -0,0 +1,161 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// LookupCache: CLOCK eviction order, capacity limits, retention of preferred and pinned
+// entries, clear and batch lookups.
+
+#include "TestUtils.h"
+#include "LookupCache.h"
+
+#include <set>
+
+// Keys below 8192 with shard keys all land in shard 0, so eviction order is deterministic
+struct TestCacheKey {
+  TestCacheKey(unsigned value, bool shard=false) : _value(value), _shard(shard) {};
+  size_t hash() const { return _shard ? size_t(_value) * 16 : size_t(_value) * 2654435761u; };
+  bool operator==(const TestCacheKey &other) const { return _value == other._value; };
+  unsigned _value;
+  bool     _shard;
+};
+
+typedef LookupCache<TestCacheKey, int> TestCache;
+
+// Keys present, without touching their reference counts
+static std::set<unsigned> keysOf(const TestCache &cache) {
+  std::set<unsigned> keys;
+  cache.forEach([&](const TestCacheKey &key, int, TestCache::Retention) { keys.insert(key._value); });
+  return keys;
+}
+
+int main() {
+  // 3 entries per shard
+  {
+    TestCache cache(48);
+    for (unsigned k=1; k<=3; k++)
+      cache.insert(TestCacheKey(k, true), int(k));
+    int value = 0;
+    CHECK(cache.find(TestCacheKey(1, true), &value) && value == 1);
+    // 1 was hit so gets a second chance: 2 goes, then 3
+    cache.insert(TestCacheKey(4, true), 4);
+    CHECK(keysOf(cache) == std::set<unsigned>({1, 3, 4}));
+    cache.insert(TestCacheKey(5, true), 5);
+    CHECK(keysOf(cache) == std::set<unsigned>({1, 4, 5}));
+    // 1 used its chance
+    cache.insert(TestCacheKey(6, true), 6);
+    CHECK(keysOf(cache) == std::set<unsigned>({4, 5, 6}));
+    CHECK(!cache.find(TestCacheKey(2, true), &value));
+    TestCache::Stats stats = cache.stats();
+    CHECK(stats.size == 3 && stats.evictions == 3 && stats.capacity == 48);
+    CHECK(stats.hits == 1 && stats.misses == 1);
+  }
+
+  // Capacity is the sum of the shard capacities ; 0 is unbounded
+  {
+    TestCache bounded(32);
+    TestCache unbounded(0);
+    for (unsigned k=0; k<1000; k++) {
+      bounded.insert(TestCacheKey(k), int(k));
+      unbounded.insert(TestCacheKey(k), int(k));
+    }
+    CHECK(bounded.stats().size <= 32);
+    CHECK(bounded.stats().evictions == 1000 - bounded.stats().size);
+    CHECK(unbounded.stats().size == 1000 && unbounded.stats().evictions == 0);
+    // Overwrites do not evict
+    for (unsigned k=0; k<1000; k++)
+      unbounded.insert(TestCacheKey(k), -int(k));
+    int value = 0;
+    CHECK(unbounded.find(TestCacheKey(7), &value) && value == -7);
+  }
+
+  // Preferred entries outlive normal ones but are evicted eventually
+  {
+    TestCache cache(48);
+    cache.insert(TestCacheKey(1, true), 1, TestCache::Preferred);
+    for (unsigned k=2; k<8; k++)
+      cache.insert(TestCacheKey(k, true), int(k));
+    CHECK(keysOf(cache).count(1) == 1);
+    CHECK(cache.stats().preferred == 1);
+    for (unsigned k=8; k<100; k++)
+      cache.insert(TestCacheKey(k, true), int(k));
+    CHECK(keysOf(cache).count(1) == 0);
+    CHECK(cache.stats().size == 3);
+
+    // Only a preferred or pinned insert replaces a preferred entry
+    cache.insert(TestCacheKey(200, true), 1, TestCache::Preferred);
+    cache.insert(TestCacheKey(200, true), 2);
+    int value = 0;
+    CHECK(cache.find(TestCacheKey(200, true), &value) && value == 1);
+    cache.insert(TestCacheKey(200, true), 3, TestCache::Preferred);
+    CHECK(cache.find(TestCacheKey(200, true), &value) && value == 3);
+  }
+
+  // Pinned entries are never evicted or replaced by other inserts ; a shard of pinned
+  // entries grows past its capacity
+  {
+    TestCache cache(48);
+    for (unsigned k=1; k<=5; k++)
+      cache.insert(TestCacheKey(k, true), int(k), TestCache::Pinned);
+    CHECK(cache.stats().size == 5 && cache.stats().pinned == 5);
+    cache.insert(TestCacheKey(1, true), 10);
+    cache.insert(TestCacheKey(2, true), 20, TestCache::Preferred);
+    int value = 0;
+    CHECK(cache.find(TestCacheKey(1, true), &value) && value == 1);
+    CHECK(cache.find(TestCacheKey(2, true), &value) && value == 2);
+    for (unsigned k=6; k<100; k++)
+      cache.insert(TestCacheKey(k, true), int(k));
+    std::set<unsigned> keys = keysOf(cache);
+    for (unsigned k=1; k<=5; k++)
+      CHECK(keys.count(k) == 1);
+    CHECK(cache.stats().size == 6);
+
+    // clear(true) keeps the pinned entries, and eviction carries on after it
+    cache.insert(TestCacheKey(300, true), 300, TestCache::Preferred);
+    cache.clear(true);
+    CHECK(keysOf(cache) == std::set<unsigned>({1, 2, 3, 4, 5}));
+    cache.insert(TestCacheKey(6, true), 6);
+    cache.insert(TestCacheKey(7, true), 7);
+    CHECK(keysOf(cache) == std::set<unsigned>({1, 2, 3, 4, 5, 7}));
+    cache.clear();
+    CHECK(cache.stats().size == 0 && cache.stats().pinned == 0);
+    cache.insert(TestCacheKey(1, true), 1);
+    CHECK(cache.find(TestCacheKey(1, true), &value) && value == 1);
+  }
+
+  // Batch lookups
+  {
+    TestCache cache(0);
+    for (unsigned k=0; k<100; k+=2)
+      cache.insert(TestCacheKey(k), int(k));
+    std::vector<TestCacheKey> keys;
+    for (unsigned k=0; k<20; k++)
+      keys.push_back(TestCacheKey(k));
+    std::vector<int> values(keys.size(), -1);
+    bool found[20];
+    CHECK(cache.findBatch(keys.data(), keys.size(), values.data(), found) == 10);
+    for (unsigned k=0; k<20; k++) {
+      CHECK(found[k] == (k % 2 == 0));
+      CHECK(values[k] == (k % 2 == 0 ? int(k) : -1));
+    }
+    CHECK(cache.stats().hits == 10 && cache.stats().misses == 10);
+  }
+
+  return testResult("test_lookup_cache");
+}
@@ -0,0 +1,295 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// Module registry on FakeModuleLoader: code objects shared by the solutions and devices
+// using them, refcounted acquire/release, concurrent first use, load failures, and
+// eviction of resident modules to fit the memory budget, deferred until their launches ran.
+
+#include "TestMapper.h"
+#include "DeviceContext.h"
+#include "ModuleRegistry.h"
+
+#include <set>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Loader tracking the loaded handles, to check launches only see loaded modules
+class LiveModuleLoader : public FakeModuleLoader {
+public:
+  TensileStatus load(int deviceId, const std::string &path, const unsigned char *code,
+                     hipModule_t *module) {
+    TensileStatus status = FakeModuleLoader::load(deviceId, path, code, module);
+    if (status == tensileStatusSuccess) {
+      std::lock_guard<std::mutex> lockGuard(_liveMutex);
+      _live.insert(reinterpret_cast<uintptr_t>(*module));
+    }
+    return status;
+  }
+  TensileStatus unload(int deviceId, hipModule_t module) {
+    {
+      std::lock_guard<std::mutex> lockGuard(_liveMutex);
+      CHECK(_live.erase(reinterpret_cast<uintptr_t>(module)) == 1);
+    }
+    return FakeModuleLoader::unload(deviceId, module);
+  }
+  // Functions are module handles tagged in the low byte
+  bool isLive(hipFunction_t function) {
+    std::lock_guard<std::mutex> lockGuard(_liveMutex);
+    return _live.count(reinterpret_cast<uintptr_t>(function) & ~uintptr_t(0xff)) != 0;
+  }
+
+private:
+  std::mutex          _liveMutex;
+  std::set<uintptr_t> _live;
+};
+
+static void writeCodeObject(const std::string &path, size_t bytes) {
+  std::vector<char> code(bytes, 'c');
+  FILE *file = fopen(path.c_str(), "wb");
+  CHECK(file != nullptr);
+  if (file) {
+    fwrite(code.data(), 1, code.size(), file);
+    fclose(file);
+  }
+}
+
+static std::string kernel(int i) {
+  return "K" + std::to_string(i);
+}
+
+int main() {
+  std::vector<TensileDeviceProperties> devices(2);
+  FakeDeviceRuntime runtime(devices);
+  TensileDeviceContext::instance().setRuntime(&runtime);
+
+  // K0 in dirA, K0..K19 in dirB (1000 bytes each)
+  const std::string dirA = "test_module_registry_a";
+  const std::string dirB = "test_module_registry_b";
+  mkdir(dirA.c_str(), 0755);
+  mkdir(dirB.c_str(), 0755);
+  writeCodeObject(dirA + "/K0.co", 1000);
+  writeCodeObject(dirA + "/bad.co", 1000);
+  for (int i=0; i<20; i++) {
+    writeCodeObject(dirB + "/" + kernel(i) + ".co", 1000);
+  }
+
+  LiveModuleLoader loader;
+  TensileModuleRegistry &registry = TensileModuleRegistry::instance();
+  registry.setLoader(&loader);
+  registry.setSearchPath("test_module_registry_none:" + dirA + "::" + dirB);
+  registry.setArchive("");
+
+  // 16 solutions using 4 code objects on 2 devices, first used concurrently
+  {
+    loader.setLoadDelayUs(2000);
+    std::vector<SolutionLock> locks(16);
+    std::vector<hipFunction_t> functions(64, nullptr);
+    std::vector<std::thread> threads;
+    for (int t=0; t<64; t++) {
+      threads.push_back(std::thread([&, t]() {
+        int solution = t % 16, deviceId = t / 16 % 2;
+        CHECK(locks[solution].getFunction(&functions[t], deviceId, kernel(solution % 4), nullptr)
+              == tensileStatusSuccess);
+      }));
+    }
+    for (auto &thread : threads)
+      thread.join();
+    loader.setLoadDelayUs(0);
+
+    TensileModuleRegistry::Stats stats = registry.stats();
+    CHECK(loader.loads() == 8 && stats.loads == 8 && stats.resident == 8);
+    // Each file opened and mapped once: K0 found in dirA, K1..K3 in dirB after 2 misses
+    CHECK(stats.filesMapped == 4);
+    CHECK(stats.fileOpens == 4 + 3*2 + 1);
+    for (int t=0; t<64; t++) {
+      for (int u=0; u<64; u++) {
+        bool sameModule = t % 4 == u % 4 && t / 16 % 2 == u / 16 % 2;
+        CHECK((functions[t] == functions[u]) == sameModule);
+      }
+    }
+  }
+
+  // Embedded code is identified by its address, and refcounted
+  {
+    static const unsigned char code[4] = {1, 2, 3, 4};
+    hipModule_t module0, module1;
+    uint64_t unloads = loader.unloads();
+    CHECK(registry.acquire(0, "ignored", code, &module0) == tensileStatusSuccess);
+    CHECK(registry.acquire(0, "other", code, &module1) == tensileStatusSuccess);
+    CHECK(module0 == module1);
+    CHECK(registry.stats().shared >= 1);
+    CHECK(registry.release(0, "x", code) == tensileStatusSuccess);
+    CHECK(loader.unloads() == unloads);
+    CHECK(registry.release(0, "y", code) == tensileStatusSuccess);
+    CHECK(loader.unloads() == unloads + 1);
+    CHECK(registry.release(0, "y", code) != tensileStatusSuccess); // no reference left
+  }
+
+  // Failed loads are not cached
+  {
+    hipFunction_t function;
+    loader.setFailure(dirA + "/bad.co", hipErrorInvalidValue);
+    CHECK(registry.getFunction(0, "bad.co", nullptr, "k", &function) == hipErrorInvalidValue);
+    CHECK(function == nullptr);
+    loader.setFailure(dirA + "/bad.co", tensileStatusSuccess);
+    CHECK(registry.getFunction(0, "bad.co", nullptr, "k", &function) == tensileStatusSuccess);
+    CHECK(function != nullptr);
+    CHECK(registry.release(0, "bad.co", nullptr) == tensileStatusSuccess);
+    CHECK(registry.getFunction(0, "missing.co", nullptr, "k", &function) == hipErrorFileNotFound);
+  }
+
+  // Mappings are shared by the devices
+  {
+    hipModule_t module;
+    TensileModuleRegistry::Stats before = registry.stats();
+    CHECK(registry.acquire(1, "K2.co", nullptr, &module) == tensileStatusSuccess);
+    CHECK(registry.stats().fileOpens == before.fileOpens);
+    CHECK(registry.release(1, "K2.co", nullptr) == tensileStatusSuccess);
+  }
+
+  // Resident modules beyond the budget are evicted, least recently used first
+  {
+    registry.setSearchPath(dirB);
+    registry.setMemoryBudget(3500);
+    std::vector<SolutionLock> locks(20);
+    hipFunction_t function;
+    TensileModuleRegistry::Stats before = registry.stats();
+    for (int i=4; i<10; i++) {
+      CHECK(locks[i].getFunction(&function, 0, kernel(i), nullptr) == tensileStatusSuccess);
+    }
+    TensileModuleRegistry::Stats stats = registry.stats();
+    CHECK(stats.loads == before.loads + 6);
+    // Device 0 held K0..K3 ; K7..K9 are left
+    CHECK(stats.evictions == before.evictions + 7);
+
+    // K7 used again, so loading K10 evicts K8
+    CHECK(locks[7].getFunction(&function, 0, kernel(7), nullptr) == tensileStatusSuccess);
+    CHECK(registry.stats().hits == stats.hits + 1 && registry.stats().loads == stats.loads);
+    CHECK(locks[10].getFunction(&function, 0, kernel(10), nullptr) == tensileStatusSuccess);
+    CHECK(locks[7].getFunction(&function, 0, kernel(7), nullptr) == tensileStatusSuccess);
+    CHECK(locks[9].getFunction(&function, 0, kernel(9), nullptr) == tensileStatusSuccess);
+    CHECK(registry.stats().loads == stats.loads + 1);
+    CHECK(locks[8].getFunction(&function, 0, kernel(8), nullptr) == tensileStatusSuccess);
+    CHECK(registry.stats().loads == stats.loads + 2);
+
+    // A pinned module is not evicted under its launch
+    {
+      TensileModulePin pin;
+      hipFunction_t pinned;
+      CHECK(locks[4].getFunction(&pinned, 0, kernel(4), nullptr, &pin) == tensileStatusSuccess);
+      for (int i=11; i<20; i++) {
+        CHECK(locks[i].getFunction(&function, 0, kernel(i), nullptr) == tensileStatusSuccess);
+      }
+      CHECK(loader.isLive(pinned));
+    }
+
+    // An evicted module stays loaded until the launches recorded on it completed
+    {
+      const hipStream_t stream = reinterpret_cast<hipStream_t>(0x100);
+      TensileModulePin pin(stream);
+      hipFunction_t launched;
+      uint64_t recorded = loader.eventsRecorded();
+      CHECK(locks[4].getFunction(&launched, 0, kernel(4), nullptr, &pin) == tensileStatusSuccess);
+      pin.reset();
+      CHECK(loader.eventsRecorded() == recorded + 1);
+      TensileModuleRegistry::Stats before = registry.stats();
+      for (int i=11; i<20; i++) {
+        CHECK(locks[i].getFunction(&function, 0, kernel(i), nullptr) == tensileStatusSuccess);
+      }
+      CHECK(loader.isLive(launched));
+      CHECK(registry.stats().retired == 1);
+      CHECK(registry.stats().residentBytes <= before.residentBytes);
+      // Retired modules of other devices are left to their device
+      CHECK(locks[1].getFunction(&function, 1, kernel(1), nullptr) == tensileStatusSuccess);
+      CHECK(loader.isLive(launched));
+      loader.completeEvents();
+      CHECK(locks[11].getFunction(&function, 0, kernel(11), nullptr) == tensileStatusSuccess);
+      CHECK(!loader.isLive(launched));
+      CHECK(registry.stats().retired == 0);
+      CHECK(registry.stats().evictions > before.evictions);
+      CHECK(loader.events() == 0);
+    }
+
+    // Modules held by acquire are not evicted
+    hipModule_t module;
+    CHECK(registry.acquire(0, "K5.co", nullptr, &module) == tensileStatusSuccess);
+    for (int i=11; i<20; i++) {
+      CHECK(locks[i].getFunction(&function, 0, kernel(i), nullptr) == tensileStatusSuccess);
+    }
+    CHECK(loader.isLive(reinterpret_cast<hipFunction_t>(module)));
+    CHECK(registry.release(0, "K5.co", nullptr) == tensileStatusSuccess);
+
+    // Launches from many threads always see a loaded module
+    registry.setMemoryBudget(5000);
+    std::vector<std::thread> threads;
+    for (int t=0; t<8; t++) {
+      threads.push_back(std::thread([&, t]() {
+        unsigned int seed = t;
+        for (int n=0; n<5000; n++) {
+          seed = seed * 1103515245 + 12345;
+          int i = seed / 65536 % 20, deviceId = seed / 16 % 2;
+          TensileModulePin pin(reinterpret_cast<hipStream_t>(uintptr_t(t+1) << 8));
+          hipFunction_t launched;
+          CHECK(locks[i].getFunction(&launched, deviceId, kernel(i), nullptr, &pin) == tensileStatusSuccess);
+          CHECK(loader.isLive(launched));
+          if (n % 100 == 0)
+            loader.completeEvents();
+        }
+      }));
+    }
+    for (auto &thread : threads)
+      thread.join();
+    CHECK(registry.stats().residentBytes <= 2*5000);
+    loader.completeEvents();
+    registry.collectRetired(0);
+    registry.collectRetired(1);
+    CHECK(registry.stats().retired == 0);
+
+    // Launches without a budget are recorded too, so a budget set later evicts their module
+    registry.setMemoryBudget(0);
+    hipFunction_t unbudgeted;
+    {
+      TensileModulePin pin(reinterpret_cast<hipStream_t>(0x100));
+      uint64_t recorded = loader.eventsRecorded();
+      CHECK(locks[0].getFunction(&unbudgeted, 1, kernel(0), nullptr, &pin) == tensileStatusSuccess);
+      pin.reset();
+      CHECK(loader.eventsRecorded() == recorded + 1);
+    }
+    registry.setMemoryBudget(1000);
+    for (int i=1; i<20; i++) {
+      CHECK(locks[i].getFunction(&function, 1, kernel(i), nullptr) == tensileStatusSuccess);
+    }
+    loader.completeEvents();
+    registry.collectRetired(1);
+    CHECK(!loader.isLive(unbudgeted));
+    registry.setMemoryBudget(0);
+  }
+
+  for (int i=0; i<20; i++) {
+    remove((dirB + "/" + kernel(i) + ".co").c_str());
+  }
+  remove((dirA + "/K0.co").c_str());
+  remove((dirA + "/bad.co").c_str());
+  rmdir(dirA.c_str());
+  rmdir(dirB.c_str());
+  return testResult("test_module_registry");
+}
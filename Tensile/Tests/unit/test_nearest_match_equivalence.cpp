@@ -0,0 +1,121 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// The SoA nearest-match scan (SolutionMapper::findNearestMatchSoA, SIMD kernels where the
+// host has them) against the scalar distance functors: same solution for every problem,
+// on tables spanning several blocks, with ties and near ties and invalid solutions.
+// The first autotuning candidate (getCandidates) is the solution findAlgorithmStatic picks.
+
+#include "TestMapper.h"
+
+#include <math.h>
+#include <set>
+
+// The distance algorithms, protected in SolutionMapperRuntime
+struct Algo : SolutionMapperRuntime {
+  static const int Euclidean = EuclideanDistanceAlgo;
+  static const int Manhattan = ManhattanDistanceAlgo;
+  static const int Ratio     = RatioDistanceAlgo;
+};
+
+static unsigned int randomSize(unsigned int *seed) {
+  static const unsigned int sizes[] = {1, 2, 3, 7, 16, 31, 32, 33, 64, 96, 127, 128, 255, 256,
+                                       384, 511, 512, 1000, 1024, 2047, 2048, 4096, 65536,
+                                       1000000, 4000000000u};
+  *seed = *seed * 1103515245 + 12345;
+  return sizes[*seed / 65536 % (sizeof(sizes) / sizeof(sizes[0]))];
+}
+
+static void checkEquivalent(TestMapper &mapper, const TestDims &pdims, unsigned int problem) {
+  TestKey pkey(pdims);
+  ProblemProperties pa(pdims, testProblemType());
+  int euclidean = mapper.findNearestMatch(pa, pkey, EuclideanDistance<TestKey>());
+  int manhattan = mapper.findNearestMatch(pa, pkey, ManhattanDistance<TestKey>());
+  int ratio     = mapper.findNearestMatch(pa, pkey, RatioDistance<TestKey>());
+  CHECK(mapper.findNearestMatchSoA(pa, pkey, Algo::Euclidean) == euclidean);
+  CHECK(mapper.findNearestMatchSoA(pa, pkey, Algo::Manhattan) == manhattan);
+  int soaRatio  = mapper.findNearestMatchSoA(pa, pkey, Algo::Ratio);
+  CHECK(soaRatio == ratio);
+  if (soaRatio != ratio)
+    printf ("problem %u: ratio distance picks solution %d, the SoA scan %d\n", problem, ratio, soaRatio);
+
+  SolutionMapperRuntime::SolutionCandidate candidates[4];
+  size_t numCandidates = mapper.getCandidates(pdims, 4, candidates, false);
+  CHECK((numCandidates == 0) == (ratio == -1));
+  if (numCandidates) {
+    int first = int(candidates[0]._solution - mapper.getSolution(0));
+    int picked = mapper.findAlgorithmStatic(pdims);
+    CHECK(first == picked);
+    if (first != picked)
+      printf ("problem %u: findAlgorithmStatic picks solution %d, the first candidate is %d\n", problem, picked, first);
+    for (size_t i=1; i<numCandidates; i++) {
+      CHECK(candidates[i-1]._distance <= candidates[i]._distance);
+    }
+  }
+}
+
+int main() {
+  // Even solutions have no requirements, odd ones need a summation multiple of 8
+  static std::vector<SolutionInfo> solutions;
+  for (int s=0; s<64; s++) {
+    SolutionInfo info = {(void*)testSolution, "S", {s % 2 ? 8u : 1u, 1, 1, 1, 0}};
+    solutions.push_back(info);
+  }
+
+  // Sizes from a few values so that many entries tie or nearly tie
+  unsigned int seed = 1;
+  std::set<std::vector<unsigned int> > keys;
+  while (keys.size() < 3000) {
+    std::vector<unsigned int> key(4);
+    for (int si=0; si<4; si++)
+      key[si] = randomSize(&seed);
+    keys.insert(key);
+  }
+  std::vector<TestExactEntry> entries;
+  for (auto iter=keys.begin(); iter!=keys.end(); iter++) {
+    seed = seed * 1103515245 + 12345;
+    TestExactEntry entry = {{(*iter)[0], (*iter)[1], (*iter)[2], (*iter)[3]}, int(seed / 65536 % 64), 1.0f};
+    entries.push_back(entry);
+  }
+  static TestExactTable table(entries);
+  TestMapper mapper("equivalence", solutions.data(), solutions.size(), table.data(),
+                    testProblemType(), nullptr, 1);
+  mapper.materialize();
+
+  for (unsigned int p=0; p<500; p++) {
+    checkEquivalent(mapper, testDims(randomSize(&seed), randomSize(&seed), randomSize(&seed),
+                                     randomSize(&seed)), p);
+  }
+  // Problems between two entries: each size the geometric or arithmetic mean of two table sizes
+  for (unsigned int p=0; p<500; p++) {
+    const TestExactEntry &e0 = entries[seed / 65536 % entries.size()];
+    seed = seed * 1103515245 + 12345;
+    const TestExactEntry &e1 = entries[seed / 65536 % entries.size()];
+    seed = seed * 1103515245 + 12345;
+    unsigned int sizes[4];
+    for (int si=0; si<4; si++) {
+      double a = e0.sizes[si], b = e1.sizes[si];
+      sizes[si] = unsigned((p % 2) ? ::sqrt(a*b) : (a + b) / 2);
+    }
+    checkEquivalent(mapper, testDims(sizes[0], sizes[1], sizes[2], sizes[3]), p);
+  }
+  return testResult("test_nearest_match_equivalence");
+}
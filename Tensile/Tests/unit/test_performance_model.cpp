@@ -0,0 +1,55 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// Performance model nearest match (TENSILE_FIND_ALG=-7): the measured GFlops of the
+// closest entries of each solution, scaled by the tile efficiency of the problem, rank
+// the solutions.
+
+#include "TestMapper.h"
+
+int main() {
+  // S0 is faster on large problems, its large macro tile wastes more on small ones
+  static std::vector<SolutionInfo> solutions = {
+    {(void*)testSolution, "S0", {1,1,1,1,0}, 128, 128},
+    {(void*)testSolution, "S1", {1,1,1,1,0}, 32, 32}};
+  static TestExactTable table({{{1024, 1024, 1, 256}, 0, 1000.0f},
+                               {{1024, 1024, 1, 512}, 1, 800.0f}});
+
+  setenv("TENSILE_FIND_ALG", "-7", 1);
+  TestMapper mapper("perfModel", solutions.data(), solutions.size(), table.data(),
+                    testProblemType(), nullptr, 1);
+  mapper.materialize();
+  unsetenv("TENSILE_FIND_ALG");
+
+  CHECK(mapper.tileEfficiency(solutions[0], 1024, 1024) == 1.0);
+  CHECK(mapper.tileEfficiency(solutions[0], 64, 128) == 0.5);
+  CHECK(mapper.tileEfficiency(solutions[1], 0, 100) == 1.0);
+  CHECK(mapper.tileEfficiency(solutions[1], 100, 0) == 1.0);
+
+  // Closer to the S1 entry by ratio distance, but S0 is predicted faster
+  CHECK(mapper.findAlgorithmStatic(testDims(1024, 1024, 1, 384)) == 0);
+  // S0 covers 130x130 with 256x256 tiles, S1 with 160x160
+  CHECK(mapper.findAlgorithmStatic(testDims(130, 130, 1, 384)) == 1);
+  // Empty problems are ranked without tile efficiency rather than by NaN predictions
+  CHECK(mapper.findAlgorithmStatic(testDims(0, 1024, 1, 384)) == 0);
+
+  return testResult("test_performance_model");
+}
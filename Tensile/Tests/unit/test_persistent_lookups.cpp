@@ -0,0 +1,94 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// Persistent lookup cache (TENSILE_LOOKUP_CACHE_PATH): entries saved by one mapper are
+// loaded by the next one, unless the file was written with other canonicalization rules.
+
+#include "TestMapper.h"
+
+static std::vector<SolutionInfo> solutions = {testSolutionInfo("S0"), testSolutionInfo("S1")};
+static TestExactTable table({{{64, 64, 1, 64}, 0, 1.0f}, {{512, 512, 1, 512}, 1, 1.0f}});
+
+// Mapper using canonicalization rules, or the default rules if nullptr
+static TestMapper *newMapper(const char *rules) {
+  if (rules)
+    setenv("TENSILE_CANONICALIZE", rules, 1);
+  TestMapper *mapper = new TestMapper("persistent", solutions.data(), solutions.size(),
+                                      table.data(), testProblemType(), nullptr, 1);
+  mapper->materialize();
+  unsetenv("TENSILE_CANONICALIZE");
+  return mapper;
+}
+
+int main() {
+  const std::string path = "test_persistent_lookups.tensile_lookups";
+  remove(path.c_str());
+
+  // A plain, a canonical and a preferred entry
+  std::unique_ptr<TestMapper> saved(newMapper("sum:mult64,batch:pow2"));
+  CHECK(saved->findAlgorithmStatic(testDims(100, 100, 1, 128)) == 0);
+  CHECK(saved->findAlgorithmStatic(testDims(100, 100, 3, 100)) == 0); // bucket {100,100,4,128}
+  CHECK(saved->cacheSolution(testDims(200, 200, 1, 200), 1) == saved->getSolution(1));
+  CHECK(saved->saveLookupCache(path));
+
+  // Same rules, written in another order: every entry is loaded and served from the cache
+  {
+    std::unique_ptr<TestMapper> loaded(newMapper("batch:pow2,sum:mult64,free:none"));
+    CHECK(loaded->loadLookupCache(path) == 3);
+    CHECK(loaded->lookupCacheStats().size == 2);
+    CHECK(loaded->lookupCacheStats().preferred == 1);
+    TensileLookupStatsSnapshot before, after;
+    loaded->lookupStats().snapshot(&before, nullptr, 0);
+    CHECK(loaded->findAlgorithmStatic(testDims(100, 100, 1, 128)) == 0);
+    CHECK(loaded->findAlgorithmStatic(testDims(100, 100, 4, 100)) == 0);
+    CHECK(loaded->findAlgorithmStatic(testDims(200, 200, 1, 200)) == 1);
+    loaded->lookupStats().snapshot(&after, nullptr, 0);
+    CHECK(after._counters[TensileLookupCacheHits] - before._counters[TensileLookupCacheHits] == 2);
+    CHECK(after._counters[TensileLookupCanonicalHits] - before._counters[TensileLookupCanonicalHits] == 1);
+    CHECK(after._counters[TensileLookupNearestMatches] == before._counters[TensileLookupNearestMatches]);
+  }
+
+  // Other rules: the file is stale
+  {
+    std::unique_ptr<TestMapper> other(newMapper("sum:mult32,batch:pow2"));
+    CHECK(other->loadLookupCache(path) == -1);
+    CHECK(other->lookupCacheStats().size == 0);
+    std::unique_ptr<TestMapper> none(newMapper(nullptr));
+    CHECK(none->loadLookupCache(path) == -1);
+  }
+
+  // A truncated file is rejected
+  {
+    std::vector<char> data(4096);
+    FILE *file = fopen(path.c_str(), "rb");
+    CHECK(file != nullptr);
+    data.resize(fread(data.data(), 1, data.size(), file));
+    fclose(file);
+    file = fopen(path.c_str(), "wb");
+    fwrite(data.data(), 1, data.size() - 4, file);
+    fclose(file);
+    std::unique_ptr<TestMapper> truncated(newMapper("sum:mult64,batch:pow2"));
+    CHECK(truncated->loadLookupCache(path) == -1);
+  }
+
+  remove(path.c_str());
+  return testResult("test_persistent_lookups");
+}
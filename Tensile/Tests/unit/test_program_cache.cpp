@@ -0,0 +1,159 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// OpenCL program cache on FakeProgramBuilder: programs built once and shared by every
+// thread, binaries round-tripped through the disk cache when it is enabled, and
+// programs rebuilt from source when the cached binary is stale.
+
+#include "TestUtils.h"
+#include "ProgramCache.h"
+
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+
+// Binaries in the disk cache directory
+static std::vector<std::string> cachedBinaries(const std::string &cachePath) {
+  std::vector<std::string> files;
+  DIR *dir = opendir(cachePath.c_str());
+  if (dir) {
+    while (struct dirent *entry = readdir(dir)) {
+      std::string name = entry->d_name;
+      if (name.size() > 6 && name.substr(name.size() - 6) == ".clbin")
+        files.push_back(cachePath + "/" + name);
+    }
+    closedir(dir);
+  }
+  return files;
+}
+
+// The fake builder's devices are the queues
+static cl_command_queue device(uintptr_t i) {
+  return reinterpret_cast<cl_command_queue>(i << 12);
+}
+
+int main() {
+  unsetenv("TENSILE_OPENCL_CACHE_PATH");
+  FakeProgramBuilder builder;
+  builder.setSignature("gfx906 driver 1");
+  TensileProgramCache &cache = TensileProgramCache::instance();
+  cache.setBuilder(&builder);
+  const char *options = "-cl-std=CL2.0";
+  const char *sources[4] = {"kernel void A() {}", "kernel void B() {}",
+                            "kernel void C() {}", "kernel void D() {}"};
+
+  // Disk cache is off by default
+  cl_program program, other;
+  CHECK(cache.getProgram(device(1), sources[0], options, &program) == CL_SUCCESS);
+  CHECK(cache.stats().sourceBuilds == 1 && cache.stats().diskWrites == 0);
+
+  const std::string cachePath = "test_program_cache_dir/opencl";
+  cache.setCachePath(cachePath);
+
+  // 16 threads creating kernels of 4 programs on 2 devices: each program built once
+  {
+    TensileProgramCache::Stats before = cache.stats();
+    builder.setBuildDelayUs(3000);
+    std::vector<cl_kernel> kernels(16*8);
+    std::vector<std::thread> threads;
+    for (int t=0; t<16; t++) {
+      threads.push_back(std::thread([&, t]() {
+        for (int i=0; i<8; i++) {
+          CHECK(cache.createKernel(device(2 + i%2), sources[i/2], options, &kernels[t*8 + i]) == CL_SUCCESS);
+        }
+      }));
+    }
+    for (auto &thread : threads)
+      thread.join();
+    builder.setBuildDelayUs(0);
+
+    TensileProgramCache::Stats stats = cache.stats();
+    CHECK(stats.sourceBuilds + stats.diskHits == before.sourceBuilds + before.diskHits + 8);
+    CHECK(stats.hits == before.hits + 16*8 - 8);
+    CHECK(builder.kernels() >= 16*8);
+    // Both devices have the same signature, so the second device may load the binary of the first
+    CHECK(stats.diskWrites == stats.sourceBuilds - before.sourceBuilds);
+    CHECK(cachedBinaries(cachePath).size() == 4);
+    // Kernels are per thread
+    std::set<cl_kernel> uniqueKernels(kernels.begin(), kernels.end());
+    CHECK(uniqueKernels.size() == kernels.size());
+  }
+
+  // Build options are part of the key
+  CHECK(cache.getProgram(device(2), sources[0], options, &program) == CL_SUCCESS);
+  CHECK(cache.getProgram(device(2), sources[0], "-O0", &other) == CL_SUCCESS);
+  CHECK(program != other);
+  CHECK(cachedBinaries(cachePath).size() == 5);
+
+  // Disk round trip: a device that never built the program loads the binary
+  {
+    TensileProgramCache::Stats before = cache.stats();
+    CHECK(cache.getProgram(device(4), sources[1], options, &program) == CL_SUCCESS);
+    CHECK(cache.stats().diskHits == before.diskHits + 1);
+    CHECK(cache.stats().sourceBuilds == before.sourceBuilds);
+    CHECK(builder.binaryBuilds() >= 1);
+  }
+
+  // Driver update: binaries of the previous signature are not used
+  {
+    builder.setSignature("gfx906 driver 2");
+    TensileProgramCache::Stats before = cache.stats();
+    CHECK(cache.getProgram(device(5), sources[1], options, &program) == CL_SUCCESS);
+    CHECK(cache.stats().sourceBuilds == before.sourceBuilds + 1);
+    CHECK(cache.stats().diskWrites == before.diskWrites + 1);
+    CHECK(cache.getProgram(device(6), sources[1], options, &program) == CL_SUCCESS);
+    CHECK(cache.stats().diskHits == before.diskHits + 1);
+  }
+
+  // A binary that fails to load is rebuilt from source and replaced
+  {
+    for (const std::string &file : cachedBinaries(cachePath)) {
+      FILE *f = fopen(file.c_str(), "wb");
+      fputs("junk", f);
+      fclose(f);
+    }
+    TensileProgramCache::Stats before = cache.stats();
+    CHECK(cache.getProgram(device(7), sources[2], options, &program) == CL_SUCCESS);
+    CHECK(cache.stats().sourceBuilds == before.sourceBuilds + 1);
+    CHECK(cache.stats().diskWrites == before.diskWrites + 1);
+    CHECK(cache.getProgram(device(8), sources[2], options, &program) == CL_SUCCESS);
+    CHECK(cache.stats().diskHits == before.diskHits + 1);
+  }
+
+  // Disabled again
+  {
+    cache.setCachePath("");
+    TensileProgramCache::Stats before = cache.stats();
+    CHECK(cache.getProgram(device(9), sources[2], options, &program) == CL_SUCCESS);
+    CHECK(cache.stats().diskHits == before.diskHits);
+    CHECK(cache.stats().sourceBuilds == before.sourceBuilds + 1);
+  }
+
+  for (const std::string &file : cachedBinaries(cachePath)) {
+    remove(file.c_str());
+  }
+  remove(cachePath.c_str());
+  remove("test_program_cache_dir");
+
+  return testResult("test_program_cache");
+}
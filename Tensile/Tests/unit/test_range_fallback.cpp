@@ -0,0 +1,73 @@
+/*******************************************************************************
+* Copyright (C) 2016 Advanced Micro Devices, Inc. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell cop-
+* ies of the Software, and to permit persons to whom the Software is furnished
+* to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IM-
+* PLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+* FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+* COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+* IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNE-
+* CTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*******************************************************************************/
+
+// Range logic mappers fall back to the nearest-match algorithm of TENSILE_RANGE_FALLBACK_ALG
+// for problems whose range logic solution is not valid.
+
+#include "TestMapper.h"
+
+// Solution picked by the range logic algorithm of a new mapper for problem
+static int rangeMatch(const TestDims &problem) {
+  // S0 needs a summation multiple of 8 ; the range logic picks it for every problem
+  static std::vector<SolutionInfo> solutions = {{(void*)testSolution, "S0", {8,1,1,1,0}},
+                                                testSolutionInfo("S1"), testSolutionInfo("S2")};
+  static const unsigned int indexOrder[] = {0};
+  static const RangeRule rules[] = {{0xffffffffu, 0}};
+  static const RangeLogic rangeLogic = {indexOrder, 1, rules, 1};
+  // Closest entry to {100,100,1,44}: S1 by Euclidean distance, S2 by ratio distance
+  static TestExactTable table({{{100, 100, 1, 1}, 1, 1.0f}, {{150, 150, 1, 44}, 2, 1.0f}});
+
+  TestMapper mapper("range", solutions.data(), solutions.size(), table.data(),
+                    testProblemType(), &rangeLogic, 1);
+  mapper.materialize();
+  return mapper.findNearestMatchWithAlg(ProblemProperties(problem, testProblemType()),
+                                        TestKey(problem));
+}
+
+int main() {
+  const TestDims valid = testDims(100, 100, 1, 48);
+  const TestDims invalid = testDims(100, 100, 1, 44);
+
+  unsetenv("TENSILE_RANGE_FALLBACK_ALG");
+  CHECK(rangeMatch(valid) == 0);
+  CHECK(rangeMatch(invalid) == 1); // Euclidean by default
+
+  setenv("TENSILE_RANGE_FALLBACK_ALG", "-3", 1); // RatioDistanceAlgo
+  CHECK(rangeMatch(valid) == 0);
+  CHECK(rangeMatch(invalid) == 2);
+
+  setenv("TENSILE_RANGE_FALLBACK_ALG", "-5", 1); // ManhattanDistanceAlgo
+  CHECK(rangeMatch(invalid) == 1);
+
+  setenv("TENSILE_RANGE_FALLBACK_ALG", "2", 1); // a specific solution
+  CHECK(rangeMatch(invalid) == 2);
+
+  setenv("TENSILE_RANGE_FALLBACK_ALG", "-6", 1); // RangeLogicAlgo: no fallback
+  CHECK(rangeMatch(invalid) == -1);
+
+  // The debug prints use the scalar scans
+  setenv("TENSILE_DB", "0x2", 1);
+  setenv("TENSILE_RANGE_FALLBACK_ALG", "-3", 1);
+  CHECK(rangeMatch(invalid) == 2);
+  unsetenv("TENSILE_DB");
+  unsetenv("TENSILE_RANGE_FALLBACK_ALG");
+  return testResult("test_range_fallback");
+}
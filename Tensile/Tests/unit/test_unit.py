@@ -0,0 +1,15 @@
+import os, subprocess, pytest
+from distutils.spawn import find_executable
+
+# Build the runtime unit tests in Tensile/Tests/unit and run them with ctest.
+# They only need cmake and a host C++ compiler; skip if either is missing.
+def test_unit(tmpdir):
+ for tool in ["cmake", "make", "ctest"]:
+  if find_executable(tool) is None:
+   pytest.skip("%s not found" % tool)
+ if not any(find_executable(cxx) for cxx in [os.environ.get("CXX", "c++"), "c++", "g++", "clang++"]):
+  pytest.skip("no C++ compiler found")
+ sourceDir = os.path.dirname(os.path.realpath(__file__))
+ subprocess.check_call(["cmake", sourceDir], cwd=tmpdir.strpath)
+ subprocess.check_call(["make"], cwd=tmpdir.strpath)
+ subprocess.check_call(["ctest", "--output-on-failure"], cwd=tmpdir.strpath)